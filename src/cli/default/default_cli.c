@@ -9,12 +9,41 @@ CLIParser* defaultCLIParserCreate(int argc, char** argv) {
     cliParserAddNoValueFlag(parser, "assemble", "Assembles the input file. Will not run the emulator, and will produce a .bin with the same name as the .asm file", 'a');
     cliParserAddNoValueFlag(parser, "emulate", "Emulates a .bin file", 'e');
     cliParserAddNoValueFlag(parser, "debug", "Enables debug mode", 'd');
+    cliParserAddNoValueFlag(parser, "debugger", "Runs the program in an interactive debugger reading commands from stdin (breakpoints, watchpoints, stepping)", 'D');
+    cliParserAddValueFlag(parser, "time-travel", "Keeps checkpoints within the given MiB so the debugger can step and continue backwards", 't', "budget");
+    cliParserAddValueFlag(parser, "gdb", "Runs the program under a GDB remote protocol stub on the given localhost port or unix socket", 'g', "address");
 
     cliParserAddValueFlag(parser, "seed", "Sets the seed for the random number generator", 's', "seed");
     cliParserAddValueFlag(parser, "expect", "Sets the expectations file for the emulator", 'x', "file");
 
     cliParserAddValueFlag(parser, "max-cycles", "Sets the maximum number of cycles to run the emulator for", 'm', "cycles");
     cliParserAddNoValueFlag(parser, "benchmark", "Runs the emulator in benchmark mode (tells you how many cycles execution took)", 'b');
+    cliParserAddNoValueFlag(parser, "detect-loops", "Stops runs that are stuck in an infinite loop (exit code 98) instead of waiting for the cycle limit", 'L');
+    cliParserAddNoValueFlag(parser, "memoize", "Caches subroutine calls that only depend on the registers and memory they read, and replays them", 'M');
+    cliParserAddNoValueFlag(parser, "interrupts", "Enables the PSR, privilege modes, exceptions, RTI and a timer interrupt (xFE08/xFE0A, vector x81) through the vector table at x0100", 'I');
+    cliParserAddNoValueFlag(parser, "protect", "Stops user code that accesses system space (x0000-x2FFF, xFE00-xFFFF), or raises the ACV exception with --interrupts", 'A');
+    cliParserAddValueFlag(parser, "cores", "Runs the program on the given number of cores sharing memory, each on a host thread (TRAP x30 reads the core, TRAP x31 is compare-and-swap)", 'K', "count");
+    cliParserAddValueFlag(parser, "interleave", "Runs the cores in turn on one thread, the given number of instructions each, so runs repeat exactly", 'Q', "instructions");
+    cliParserAddNoValueFlag(parser, "fast-loops", "Computes counted ADD loops (multiplication by repeated addition) in closed form", 'F');
+
+    cliParserAddValueFlag(parser, "cache", "Caches assembled images in the given directory, shared safely between processes", 'c', "directory");
+
+    cliParserAddValueFlag(parser, "verdict-cache", "Caches emulation results (output, registers, expected memory, cycles) in the given directory", 'v', "directory");
+
+    cliParserAddValueFlag(parser, "batch", "Runs the program once per input file listed in the given file, writing each output to <input>.out", 'B', "file");
+
+    cliParserAddValueFlag(parser, "pair-profile", "Counts executed instruction pairs and merges them into the given file (accumulates over runs)", 'P', "file");
+    cliParserAddValueFlag(parser, "fuzz", "Mutates the input of the program to reach new branches, keeping the corpus, crashes and hangs in the given directory", 'z', "directory");
+    cliParserAddValueFlag(parser, "fuzz-executions", "Number of executions for --fuzz (default 100000)", 'N', "count");
+    cliParserAddNoValueFlag(parser, "host-counters", "Reads the host's hardware counters (perf_event_open) around emulation and prints them per emulated instruction", 'H');
+    cliParserAddValueFlag(parser, "coverage", "Merges executed instructions and branch directions into the given file (accumulates over runs) and prints a coverage report", 'O', "file");
+    cliParserAddNoValueFlag(parser, "check-uninitialized", "Reports registers and memory used before the program wrote them, with the address and label of the use", 'U');
+    cliParserAddValueFlag(parser, "icache", "Simulates an instruction cache, e.g. size=1024,ways=2,line=8,replace=lru|fifo|random,penalty=10 (sizes in words), and reports hits and stall cycles", 'J', "options");
+    cliParserAddValueFlag(parser, "dcache", "Simulates a data cache for loads and stores, with the --icache options and write=back|through", 'W', "options");
+    cliParserAddValueFlag(parser, "timing", "Counts modeled cycles from the given file of per-opcode, memory, branch-taken and TRAP costs, reported with the instruction count", 'R', "file");
+    cliParserAddValueFlag(parser, "call-profile", "Prints cycles and calls per subroutine and writes folded stacks (for flame graphs) to the given file", 'C', "file");
+
+    cliParserAddNoValueFlag(parser, "translate-c", "Translates the program (or the .bin given with --emulate) into a standalone C file written to the output", 'T');
 
     cliParserAddValueFlag(parser, "input", "Sets the input file (- for stdin)", 'i', "file");
     cliParserAddValueFlag(parser, "output", "Sets the output file (- for stdout)", 'o', "file");
@@ -15,6 +15,7 @@ LabelledInstructionList *labelledInstructions; // List of parsed instructions
 %}
 
 %define parse.trace
+%locations
 
 %code requires {
   #include <stdio.h>
@@ -128,6 +129,7 @@ Statement : Labels Instruction {
               LabelledInstruction labelledInstruction = {0};
               labelledInstruction.labels = $1;
               labelledInstruction.instruction = $2;
+              labelledInstruction.line = @2.first_line;
               addLabelledInstruction(labelledInstructions, labelledInstruction);
             };
 
@@ -0,0 +1,24 @@
+#include "hash.h"
+
+#include <string.h>
+
+#define HASH64_PRIME 0x100000001b3ULL
+
+Hash64 hashBytes(Hash64 hash, const void* data, size_t length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= HASH64_PRIME;
+    }
+
+    return hash;
+}
+
+Hash64 hashString(Hash64 hash, const char* string) {
+    // Include the terminator so that "ab" + "c" and "a" + "bc" hash differently
+    return hashBytes(hash, string, strlen(string) + 1);
+}
+
+Hash64 hashInt(Hash64 hash, long long value) {
+    return hashBytes(hash, &value, sizeof(value));
+}
@@ -0,0 +1,15 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+
+// 64-bit FNV-1a, used to key the on-disk caches and to fingerprint emulator state
+typedef unsigned long long Hash64;
+
+#define HASH64_INITIAL 0xcbf29ce484222325ULL
+
+Hash64 hashBytes(Hash64 hash, const void* data, size_t length);
+Hash64 hashString(Hash64 hash, const char* string);
+Hash64 hashInt(Hash64 hash, long long value);
+
+#endif // HASH_H
@@ -6,8 +6,11 @@
 
 #include "../../lexer/lexer.h"
 #include "../../map/string_map.h"
+#include "../cache/asmcache.h"
 #include "../emulator/lc3emulator.h"
+#include "../image/lc3image.h"
 #include "../instructions/lc3isa.h"
+#include "../random/lc3random.h"
 
 extern LabelledInstructionList* labelledInstructions;
 
@@ -81,7 +84,7 @@ int resolveInitialMemoryLayout() {
     return firstInstruction.instruction.dOrig.address;
 }
 
-ParsedInstructionList* resolveReferences() {
+ParsedInstructionList* resolveReferences(LC3Image* image) {
     StringMap* labelMap = stringMapCreate();
 
     // Go through all labels and add their locations ot the StringMap
@@ -97,6 +100,7 @@ ParsedInstructionList* resolveReferences() {
                 }
 
                 stringMapPut(labelMap, label, (void*)(long)(instruction.memoryLocation));
+                imageAddSymbol(image, label, instruction.memoryLocation);
             }
         }
     }
@@ -161,6 +165,7 @@ ParsedInstructionList* resolveReferences() {
         LabelledInstruction instruction = labelledInstructions->instructions[i];
         ParsedInstruction parsedInstruction = {0};
         parsedInstruction.memoryLocation = instruction.memoryLocation;
+        parsedInstruction.line = instruction.line;
 
         int currentAddress = instruction.memoryLocation;
         switch (instruction.instruction.type) {
@@ -360,11 +365,7 @@ MemoryCell* createMemoryLayout(LC3Context ctx) {
 
     // Fill up memory with junk values if randomized
     if (ctx.randomized) {
-        int seed = ctx.seed;
-        srand(seed);
-        for (int i = 0; i < 65536; i++) {
-            memory[i].rawNumber = rand() % 65536;
-        }
+        randomFillMemory(memory, ctx.seed);
     }
 
     return memory;
@@ -462,87 +463,92 @@ unsigned short assembleHalt() {
     return 0xF025;
 }
 
-void assembleInstructionsIntoMemory(MemoryCell* memory, ParsedInstructionList* instructionList) {
+void assembleInstructionsIntoImage(LC3Image* image, ParsedInstructionList* instructionList) {
     for (unsigned int i = 0; i < instructionList->count; i++) {
         ParsedInstruction instruction = instructionList->instructions[i];
+        if (instruction.type != D_ORIG && instruction.type != D_END) {
+            // Instructions and macros are listed before the directives
+            imageSetSource(image, instruction.memoryLocation, instruction.line, instruction.type < D_ORIG);
+        }
+
         switch (instruction.type) {
             case I_ADD:
-                memory[instruction.memoryLocation].rawNumber = assembleAdd(instruction.iAdd);
+                imageEmitWord(image, instruction.memoryLocation, assembleAdd(instruction.iAdd));
                 break;
             case I_AND:
-                memory[instruction.memoryLocation].rawNumber = assembleAnd(instruction.iAnd);
+                imageEmitWord(image, instruction.memoryLocation, assembleAnd(instruction.iAnd));
                 break;
             case I_BR:
-                memory[instruction.memoryLocation].rawNumber = assembleBranch(instruction.iBr);
+                imageEmitWord(image, instruction.memoryLocation, assembleBranch(instruction.iBr));
                 break;
             case I_JMP:
-                memory[instruction.memoryLocation].rawNumber = assembleJump(instruction.iJmp);
+                imageEmitWord(image, instruction.memoryLocation, assembleJump(instruction.iJmp));
                 break;
             case I_JSR:
-                memory[instruction.memoryLocation].rawNumber = assembleJumpSubroutine(instruction.iJsr);
+                imageEmitWord(image, instruction.memoryLocation, assembleJumpSubroutine(instruction.iJsr));
                 break;
             case I_JSRR:
-                memory[instruction.memoryLocation].rawNumber = assembleJumpSubroutineRegister(instruction.iJsrr);
+                imageEmitWord(image, instruction.memoryLocation, assembleJumpSubroutineRegister(instruction.iJsrr));
                 break;
             case I_LD:
-                memory[instruction.memoryLocation].rawNumber = assembleLoad(instruction.iLd);
+                imageEmitWord(image, instruction.memoryLocation, assembleLoad(instruction.iLd));
                 break;
             case I_LDI:
-                memory[instruction.memoryLocation].rawNumber = assembleLoadIndirect(instruction.iLdi);
+                imageEmitWord(image, instruction.memoryLocation, assembleLoadIndirect(instruction.iLdi));
                 break;
             case I_LDR:
-                memory[instruction.memoryLocation].rawNumber = assembleLoadBaseOffset(instruction.iLdr);
+                imageEmitWord(image, instruction.memoryLocation, assembleLoadBaseOffset(instruction.iLdr));
                 break;
             case I_LEA:
-                memory[instruction.memoryLocation].rawNumber = assembleLoadEffectiveAddress(instruction.iLea);
+                imageEmitWord(image, instruction.memoryLocation, assembleLoadEffectiveAddress(instruction.iLea));
                 break;
             case I_NOT:
-                memory[instruction.memoryLocation].rawNumber = assembleNot(instruction.iNot);
+                imageEmitWord(image, instruction.memoryLocation, assembleNot(instruction.iNot));
                 break;
             case I_RET:
-                memory[instruction.memoryLocation].rawNumber = assembleRet();
+                imageEmitWord(image, instruction.memoryLocation, assembleRet());
                 break;
             case I_RTI:
-                memory[instruction.memoryLocation].rawNumber = assembleRti();
+                imageEmitWord(image, instruction.memoryLocation, assembleRti());
                 break;
             case I_ST:
-                memory[instruction.memoryLocation].rawNumber = assembleStore(instruction.iSt);
+                imageEmitWord(image, instruction.memoryLocation, assembleStore(instruction.iSt));
                 break;
             case I_STI:
-                memory[instruction.memoryLocation].rawNumber = assembleStoreIndirect(instruction.iSti);
+                imageEmitWord(image, instruction.memoryLocation, assembleStoreIndirect(instruction.iSti));
                 break;
             case I_STR:
-                memory[instruction.memoryLocation].rawNumber = assembleStoreBaseOffset(instruction.iStr);
+                imageEmitWord(image, instruction.memoryLocation, assembleStoreBaseOffset(instruction.iStr));
                 break;
             case I_TRAP:
-                memory[instruction.memoryLocation].rawNumber = assembleTrap(instruction.iTrap);
+                imageEmitWord(image, instruction.memoryLocation, assembleTrap(instruction.iTrap));
                 break;
             case M_GETC:
-                memory[instruction.memoryLocation].rawNumber = assembleGetc();
+                imageEmitWord(image, instruction.memoryLocation, assembleGetc());
                 break;
             case M_OUT:
-                memory[instruction.memoryLocation].rawNumber = assembleOut();
+                imageEmitWord(image, instruction.memoryLocation, assembleOut());
                 break;
             case M_PUTS:
-                memory[instruction.memoryLocation].rawNumber = assemblePuts();
+                imageEmitWord(image, instruction.memoryLocation, assemblePuts());
                 break;
             case M_IN:
-                memory[instruction.memoryLocation].rawNumber = assembleIn();
+                imageEmitWord(image, instruction.memoryLocation, assembleIn());
                 break;
             case M_PUTSP:
-                memory[instruction.memoryLocation].rawNumber = assemblePutsp();
+                imageEmitWord(image, instruction.memoryLocation, assemblePutsp());
                 break;
             case M_HALT:
-                memory[instruction.memoryLocation].rawNumber = assembleHalt();
+                imageEmitWord(image, instruction.memoryLocation, assembleHalt());
                 break;
             case D_ORIG:
                 break;
             case D_FILL:
-                memory[instruction.memoryLocation].rawNumber = instruction.dFill.value;
+                imageEmitWord(image, instruction.memoryLocation, instruction.dFill.value);
                 break;
             case D_BLKW:
                 for (unsigned int j = 0; j < instruction.dBlkw.count; j++) {
-                    memory[instruction.memoryLocation + j].rawNumber = 0;
+                    imageEmitWord(image, instruction.memoryLocation + j, 0);
                 }
                 break;
             case D_STRINGZ: {
@@ -553,20 +559,20 @@ void assembleInstructionsIntoMemory(MemoryCell* memory, ParsedInstructionList* i
                     if (c == '\\' && j < len - 1) {
                         char c1 = instruction.dStringz.string[j + 1];
                         if (c1 == 'n') {
-                            memory[instruction.memoryLocation + j].rawNumber = '\n';
+                            imageEmitWord(image, instruction.memoryLocation + j, '\n');
                             j++;
                         } else if (c1 == 't') {
-                            memory[instruction.memoryLocation + j].rawNumber = '\t';
+                            imageEmitWord(image, instruction.memoryLocation + j, '\t');
                             j++;
                         } else {
-                            memory[instruction.memoryLocation + j].rawNumber = instruction.dStringz.string[j];
+                            imageEmitWord(image, instruction.memoryLocation + j, instruction.dStringz.string[j]);
                         }
                     } else {
-                        memory[instruction.memoryLocation + j].rawNumber = instruction.dStringz.string[j];
+                        imageEmitWord(image, instruction.memoryLocation + j, instruction.dStringz.string[j]);
                     }
                 }
                 // Add the null terminator
-                memory[instruction.memoryLocation + strlen(instruction.dStringz.string)].rawNumber = 0;
+                imageEmitWord(image, instruction.memoryLocation + strlen(instruction.dStringz.string), 0);
 
                 // Since we're done with this string we can free it
                 free(instruction.dStringz.string);
@@ -593,15 +599,13 @@ LC3EmulatorState prepareEmulatorState(LC3Context ctx, MemoryCell* memory, int in
 
     if (ctx.randomized) {
         // Set registers to random values
-        for (int i = 0; i < 8; i++) {
-            emulatorState.registers[i] = rand() % 65536;
-        }
+        randomFillRegisters(emulatorState.registers, ctx.seed);
     }
 
     return emulatorState;
 }
 
-LC3EmulatorState assemble(LC3Context ctx) {
+LC3Image* assembleImage(LC3Context ctx) {
     // Register parser cleanup
     atexit(freeLabelledInstructions);
 
@@ -614,20 +618,74 @@ LC3EmulatorState assemble(LC3Context ctx) {
     // Free the lexer resources.
     finalizeLexer();
 
+    LC3Image* image = createImage();
+
     // Resolve the initial memory layout
-    int initialPc = resolveInitialMemoryLayout();
+    image->initialPc = resolveInitialMemoryLayout();
 
     // Resolve labels
-    ParsedInstructionList* parsed = resolveReferences();
-    MemoryCell* memory = createMemoryLayout(ctx);
+    ParsedInstructionList* parsed = resolveReferences(image);
 
-    // Assemble the parsed instructions into the memory
-    assembleInstructionsIntoMemory(memory, parsed);
+    // Assemble the parsed instructions into the image
+    assembleInstructionsIntoImage(image, parsed);
 
     // Free the parsed instructions
     destroyParsedInstructionList(parsed);
 
-    LC3EmulatorState emulatorState = prepareEmulatorState(ctx, memory, initialPc);
+    return image;
+}
+
+int hashAssemblerInput(LC3Context ctx, Hash64* key) {
+    FILE* input = ctx.inputFile;
+
+    // Only regular files can be hashed up front, stdin is not seekable
+    if (fseek(input, 0, SEEK_END) != 0) {
+        return 0;
+    }
+
+    long length = ftell(input);
+    if (length < 0 || fseek(input, 0, SEEK_SET) != 0) {
+        return 0;
+    }
+
+    char* source = malloc(length + 1);
+    length = fread(source, 1, length, input);
+    fseek(input, 0, SEEK_SET);
+
+    Hash64 hash = hashString(HASH64_INITIAL, LC3_ASSEMBLER_VERSION);
+    hash = hashBytes(hash, source, length);
+    free(source);
+
+    // Memory randomization is applied when the image is loaded, so it is not part of the key
+
+    *key = hash;
+    return 1;
+}
+
+LC3EmulatorState assemble(LC3Context ctx) {
+    LC3Image* image = NULL;
+
+    Hash64 key = 0;
+    int useCache = ctx.cacheDirectory != NULL && hashAssemblerInput(ctx, &key);
+
+    // A cache hit skips lexing, parsing and label resolution entirely
+    if (useCache) {
+        image = assemblyCacheLoad(ctx.cacheDirectory, key);
+    }
+
+    if (image == NULL) {
+        image = assembleImage(ctx);
+
+        if (useCache) {
+            assemblyCacheStore(ctx.cacheDirectory, key, image);
+        }
+    }
+
+    MemoryCell* memory = createMemoryLayout(ctx);
+    imageApply(image, memory);
+
+    LC3EmulatorState emulatorState = prepareEmulatorState(ctx, memory, image->initialPc);
+    emulatorState.image = image;
 
     return emulatorState;
 }
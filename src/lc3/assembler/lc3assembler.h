@@ -4,7 +4,12 @@
 #include "../instructions/lc3isa.h"
 #include "../context/lc3context.h"
 #include "../emulator/lc3emulator.h"
+#include "../image/lc3image.h"
 
+// Part of the assembly cache key, bump whenever the generated images change
+#define LC3_ASSEMBLER_VERSION "1.0.2"
+
+LC3Image* assembleImage(LC3Context ctx);
 LC3EmulatorState assemble(LC3Context ctx);
 
 #endif // LC3_ASSEMBLER_H
\ No newline at end of file
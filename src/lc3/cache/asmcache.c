@@ -0,0 +1,78 @@
+#include "asmcache.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static AssemblyCacheStats stats = {0};
+
+static void getEntryPath(char* buffer, size_t size, const char* directory, Hash64 key) {
+    snprintf(buffer, size, "%s/%016llx.lc3c", directory, key);
+}
+
+LC3Image* assemblyCacheLoad(const char* directory, Hash64 key) {
+    char path[4096];
+    getEntryPath(path, sizeof(path), directory, key);
+
+    FILE* entry = fopen(path, "rb");
+    if (entry == NULL) {
+        stats.misses++;
+        return NULL;
+    }
+
+    // A corrupt or outdated entry is treated as a miss, it will be overwritten by the next store
+    LC3Image* image = imageRead(entry);
+    fclose(entry);
+
+    if (image == NULL) {
+        stats.misses++;
+        return NULL;
+    }
+
+    stats.hits++;
+    return image;
+}
+
+void assemblyCacheStore(const char* directory, Hash64 key, const LC3Image* image) {
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+        stats.failedStores++;
+        return;
+    }
+
+    char path[4096];
+    char temporaryPath[4096 + 32];
+    getEntryPath(path, sizeof(path), directory, key);
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp.%ld", path, (long)getpid());
+
+    FILE* entry = fopen(temporaryPath, "wb");
+    if (entry == NULL) {
+        stats.failedStores++;
+        return;
+    }
+
+    int ok = imageWrite(image, entry);
+    ok = fclose(entry) == 0 && ok;
+
+    // rename() is atomic, so concurrent readers either see the complete entry or no entry at all
+    if (!ok || rename(temporaryPath, path) != 0) {
+        unlink(temporaryPath);
+        stats.failedStores++;
+        return;
+    }
+
+    stats.stores++;
+}
+
+AssemblyCacheStats assemblyCacheGetStats(void) {
+    return stats;
+}
+
+void printAssemblyCacheStats(FILE* stream) {
+    fprintf(stream, "Assembly cache: %lu hits, %lu misses, %lu stores", stats.hits, stats.misses, stats.stores);
+    if (stats.failedStores > 0) {
+        fprintf(stream, ", %lu failed stores", stats.failedStores);
+    }
+    fprintf(stream, "\n");
+}
@@ -0,0 +1,27 @@
+#ifndef ASM_CACHE_H
+#define ASM_CACHE_H
+
+#include "../../hash/hash.h"
+#include "../image/lc3image.h"
+
+/*
+ * Content-addressed on-disk cache of assembled images.
+ *
+ * Entries are keyed by a hash of the assembler version and the source bytes (no option changes the image,
+ * memory randomization is applied when it is loaded), and are written to a temporary file and renamed into
+ * place so several processes can share one directory.
+ */
+typedef struct AssemblyCacheStats {
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long stores;
+    unsigned long failedStores;
+} AssemblyCacheStats;
+
+LC3Image* assemblyCacheLoad(const char* directory, Hash64 key);
+void assemblyCacheStore(const char* directory, Hash64 key, const LC3Image* image);
+
+AssemblyCacheStats assemblyCacheGetStats(void);
+void printAssemblyCacheStats(FILE* stream);
+
+#endif // ASM_CACHE_H
@@ -0,0 +1,184 @@
+#include "verdictcache.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define VERDICT_MAGIC 0x5643334cU  // "LC3V"
+#define VERDICT_FORMAT_VERSION 1
+
+static void getEntryPath(char *buffer, size_t size, const char *directory, Hash64 key) {
+    snprintf(buffer, size, "%s/%016llx.lc3v", directory, key);
+}
+
+Hash64 verdictKey(LC3Context ctx, const LC3EmulatorState *state, const short *selectedMemory) {
+    Hash64 hash = hashInt(HASH64_INITIAL, VERDICT_FORMAT_VERSION);
+
+    // The loaded image together with everything injected by the expectations
+    hash = hashBytes(hash, state->memory, 65536 * sizeof(MemoryCell));
+    hash = hashBytes(hash, state->registers, sizeof(state->registers));
+    hash = hashInt(hash, state->pc);
+    hash = hashInt(hash, state->cc);
+
+    // The whole input stream
+    hash = hashInt(hash, state->io.inputLength);
+    hash = hashBytes(hash, state->io.input, state->io.inputLength);
+
+    // Limits
+    hash = hashInt(hash, ctx.maxCycleCount);
+
+    // RTI and the reserved opcode trap into the program instead of ending the run, accesses to system space are checked
+    if (ctx.interrupts || ctx.protect) {
+        hash = hashInt(hash, ctx.interrupts);
+        hash = hashInt(hash, ctx.protect);
+    }
+
+    // Which memory locations end up in the verdict
+    if (selectedMemory != NULL) {
+        for (int i = 0; i < 65536; i++) {
+            if (selectedMemory[i]) {
+                hash = hashInt(hash, i);
+            }
+        }
+    }
+
+    return hash;
+}
+
+Verdict createVerdict(const LC3EmulatorState *state, const short *selectedMemory) {
+    Verdict verdict = {0};
+
+    verdict.outputLength = state->io.outputLength;
+    verdict.output = malloc(verdict.outputLength + 1);
+    memcpy(verdict.output, state->io.output, verdict.outputLength);
+
+    memcpy(verdict.registers, state->registers, sizeof(verdict.registers));
+    verdict.pc = state->pc;
+    verdict.cc = state->cc;
+    verdict.cycleCount = state->cycleCount;
+
+    if (selectedMemory != NULL) {
+        for (int i = 0; i < 65536; i++) {
+            verdict.memoryCount += selectedMemory[i] != 0;
+        }
+    }
+
+    verdict.memoryAddresses = calloc(verdict.memoryCount + 1, sizeof(unsigned short));
+    verdict.memoryValues = calloc(verdict.memoryCount + 1, sizeof(short));
+
+    unsigned int stored = 0;
+    for (int i = 0; i < 65536 && stored < verdict.memoryCount; i++) {
+        if (selectedMemory[i]) {
+            verdict.memoryAddresses[stored] = i;
+            verdict.memoryValues[stored] = state->memory[i].parsedNumber;
+            stored++;
+        }
+    }
+
+    return verdict;
+}
+
+void applyVerdict(const Verdict *verdict, LC3EmulatorState *state) {
+    memcpy(state->registers, verdict->registers, sizeof(state->registers));
+    state->pc = verdict->pc;
+    state->cc = verdict->cc;
+    state->cycleCount = verdict->cycleCount;
+    state->haltSignal = 1;
+
+    for (unsigned int i = 0; i < verdict->memoryCount; i++) {
+        emulatorWriteMemory(state, verdict->memoryAddresses[i], verdict->memoryValues[i]);
+    }
+}
+
+void destroyVerdict(Verdict *verdict) {
+    free(verdict->output);
+    free(verdict->memoryAddresses);
+    free(verdict->memoryValues);
+    *verdict = (Verdict){0};
+}
+
+int verdictCacheLoad(const char *directory, Hash64 key, Verdict *verdict) {
+    char path[4096];
+    getEntryPath(path, sizeof(path), directory, key);
+
+    FILE *entry = fopen(path, "rb");
+    if (entry == NULL) {
+        return 0;
+    }
+
+    Verdict loaded = {0};
+    unsigned int header[2] = {0};
+    unsigned long long outputLength = 0;
+
+    int ok = fread(header, sizeof(unsigned int), 2, entry) == 2 && header[0] == VERDICT_MAGIC && header[1] == VERDICT_FORMAT_VERSION;
+    ok = ok && fread(loaded.registers, sizeof(short), 8, entry) == 8;
+    ok = ok && fread(&loaded.pc, sizeof(unsigned short), 1, entry) == 1;
+    ok = ok && fread(&loaded.cc, sizeof(unsigned short), 1, entry) == 1;
+    ok = ok && fread(&loaded.cycleCount, sizeof(unsigned long long), 1, entry) == 1;
+    ok = ok && fread(&outputLength, sizeof(unsigned long long), 1, entry) == 1;
+
+    if (ok) {
+        loaded.outputLength = outputLength;
+        loaded.output = malloc(loaded.outputLength + 1);
+        ok = fread(loaded.output, 1, loaded.outputLength, entry) == loaded.outputLength;
+    }
+
+    ok = ok && fread(&loaded.memoryCount, sizeof(unsigned int), 1, entry) == 1 && loaded.memoryCount <= 65536;
+    if (ok) {
+        loaded.memoryAddresses = calloc(loaded.memoryCount + 1, sizeof(unsigned short));
+        loaded.memoryValues = calloc(loaded.memoryCount + 1, sizeof(short));
+        ok = fread(loaded.memoryAddresses, sizeof(unsigned short), loaded.memoryCount, entry) == loaded.memoryCount;
+        ok = ok && fread(loaded.memoryValues, sizeof(short), loaded.memoryCount, entry) == loaded.memoryCount;
+    }
+
+    fclose(entry);
+
+    if (!ok) {
+        destroyVerdict(&loaded);
+        return 0;
+    }
+
+    *verdict = loaded;
+    return 1;
+}
+
+void verdictCacheStore(const char *directory, Hash64 key, const Verdict *verdict) {
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+        return;
+    }
+
+    char path[4096];
+    char temporaryPath[4096 + 32];
+    getEntryPath(path, sizeof(path), directory, key);
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp.%ld", path, (long)getpid());
+
+    FILE *entry = fopen(temporaryPath, "wb");
+    if (entry == NULL) {
+        return;
+    }
+
+    unsigned int header[2] = {VERDICT_MAGIC, VERDICT_FORMAT_VERSION};
+    unsigned long long outputLength = verdict->outputLength;
+
+    fwrite(header, sizeof(unsigned int), 2, entry);
+    fwrite(verdict->registers, sizeof(short), 8, entry);
+    fwrite(&verdict->pc, sizeof(unsigned short), 1, entry);
+    fwrite(&verdict->cc, sizeof(unsigned short), 1, entry);
+    fwrite(&verdict->cycleCount, sizeof(unsigned long long), 1, entry);
+    fwrite(&outputLength, sizeof(unsigned long long), 1, entry);
+    fwrite(verdict->output, 1, verdict->outputLength, entry);
+    fwrite(&verdict->memoryCount, sizeof(unsigned int), 1, entry);
+    fwrite(verdict->memoryAddresses, sizeof(unsigned short), verdict->memoryCount, entry);
+    fwrite(verdict->memoryValues, sizeof(short), verdict->memoryCount, entry);
+
+    int ok = !ferror(entry);
+    ok = fclose(entry) == 0 && ok;
+
+    // Same atomic publish as the assembly cache, so concurrent graders can share the directory
+    if (!ok || rename(temporaryPath, path) != 0) {
+        unlink(temporaryPath);
+    }
+}
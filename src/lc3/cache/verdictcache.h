@@ -0,0 +1,39 @@
+#ifndef VERDICT_CACHE_H
+#define VERDICT_CACHE_H
+
+#include "../../hash/hash.h"
+#include "../context/lc3context.h"
+#include "../emulator/lc3emulator.h"
+
+/*
+ * Opt-in on-disk cache of emulation results.
+ *
+ * Execution is deterministic given the loaded memory, the registers, the input stream and the cycle limit,
+ * so a run with the same key will produce exactly the same output bytes, registers, memory and cycle count.
+ * Only the memory locations selected by the expectations are stored.
+ */
+typedef struct Verdict {
+    char *output;
+    size_t outputLength;
+
+    short registers[8];
+    unsigned short pc;
+    unsigned short cc;
+    unsigned long long cycleCount;
+
+    unsigned int memoryCount;
+    unsigned short *memoryAddresses;
+    short *memoryValues;
+} Verdict;
+
+Hash64 verdictKey(LC3Context ctx, const LC3EmulatorState *state, const short *selectedMemory);
+
+int verdictCacheLoad(const char *directory, Hash64 key, Verdict *verdict);
+void verdictCacheStore(const char *directory, Hash64 key, const Verdict *verdict);
+
+// selectedMemory has 65536 entries, non-zero entries are stored in the verdict (may be NULL)
+Verdict createVerdict(const LC3EmulatorState *state, const short *selectedMemory);
+void applyVerdict(const Verdict *verdict, LC3EmulatorState *state);
+void destroyVerdict(Verdict *verdict);
+
+#endif // VERDICT_CACHE_H
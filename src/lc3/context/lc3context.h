@@ -3,6 +3,16 @@
 
 #include <stdio.h>
 
+typedef struct PairProfile PairProfile;
+typedef struct CallProfile CallProfile;
+typedef struct HostCounters HostCounters;
+typedef struct Coverage Coverage;
+typedef struct ShadowMemory ShadowMemory;
+typedef struct MemoTable MemoTable;
+typedef struct LC3Debugger LC3Debugger;
+typedef struct LC3MemoryObserver LC3MemoryObserver;
+typedef struct TimingModel TimingModel;
+
 typedef struct LC3Context {
     FILE* inputFile;
     FILE* outputFile;
@@ -12,6 +22,25 @@ typedef struct LC3Context {
     int maxCycleCount;
     int debugMode;
     int benchmarkMode;
+    int detectLoops;  // Ends runs whose whole state repeats instead of waiting for the cycle limit
+    int fastLoops;    // Runs counted ADD loops in closed form
+    int interrupts;   // Privilege, exceptions and the timer interrupt (see lc3interrupt.h)
+    int protect;      // Access control violations on system space (see lc3protect.h)
+    int cores;        // Cores sharing the memory (see lc3multicore.h), 0 for the usual single core
+    int interleave;   // Instructions per turn when the cores take turns on one thread, 0 when they run free
+
+    const char* cacheDirectory;         // Assembly cache, NULL when disabled
+    const char* verdictCacheDirectory;  // Emulation result cache, NULL when disabled
+
+    PairProfile* pairProfile;  // Records executed instruction pairs (and disables fusion), NULL when disabled
+    CallProfile* callProfile;  // Attributes cycles to subroutines (and disables fusion), NULL when disabled
+    Coverage* coverage;        // Marks executed instructions and branch directions (and disables fusion), NULL when disabled
+    ShadowMemory* shadow;      // Reports uses of uninitialized registers and memory (and disables fusion), NULL when disabled
+    HostCounters* hostCounters;  // Host hardware counters read around emulation, NULL when disabled
+    MemoTable* memo;           // Replays pure subroutine calls (and disables fusion), NULL when disabled
+    const LC3MemoryObserver* observer;  // Sees every fetch, load and store (and disables fusion), NULL when disabled
+    TimingModel* timing;       // Charges modeled cycles per instruction (and disables fusion), NULL when disabled
+    LC3Debugger* debugger;     // Interactive debugger, NULL when disabled
 } LC3Context;
 
 #endif // LC3_CONTEXT_H
\ No newline at end of file
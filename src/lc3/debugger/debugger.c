@@ -0,0 +1,559 @@
+#include "debugger.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "../emulator/lc3decode.h"
+#include "gdbstub.h"
+#include "timetravel.h"
+#include "../image/lc3image.h"
+
+static inline void setBit(unsigned char* bitmap, unsigned short address, int value) {
+    if (value) {
+        bitmap[address >> 3] |= 1 << (address & 7);
+    } else {
+        bitmap[address >> 3] &= ~(1 << (address & 7));
+    }
+}
+
+LC3Debugger* createDebugger(FILE* commands, FILE* output) {
+    LC3Debugger* debugger = calloc(1, sizeof(LC3Debugger));
+    debugger->commands = commands;
+    debugger->output = output;
+    return debugger;
+}
+
+void destroyDebugger(LC3Debugger* debugger) {
+    if (debugger->gdb != NULL) {
+        gdbClose(debugger->gdb);
+    }
+    if (debugger->timeTravel != NULL) {
+        destroyTimeTravel(debugger->timeTravel);
+    }
+    free(debugger);
+}
+
+// Fused groups are decoded again, so breakpoints that were set or removed take effect
+static void resetDispatch(LC3EmulatorState* state) {
+    if (state->fusion != NULL) {
+        memset(state->fusion, 0, 65536);
+    }
+}
+
+static void printLocation(LC3Debugger* debugger, LC3EmulatorState* state, unsigned short address) {
+    fprintf(debugger->output, "x%04x", address);
+
+    // Only words of the program are named after the label before them
+    const LC3Symbol* symbol = NULL;
+    if (state->image != NULL && imageIsEmitted(state->image, address)) {
+        symbol = imageSymbolAt(state->image, address);
+    }
+
+    if (symbol != NULL) {
+        if (symbol->address == address) {
+            fprintf(debugger->output, " (%s)", symbol->name);
+        } else {
+            fprintf(debugger->output, " (%s+%d)", symbol->name, address - symbol->address);
+        }
+    }
+}
+
+static void printInstructionAt(LC3Debugger* debugger, LC3EmulatorState* state, unsigned short address) {
+    printLocation(debugger, state, address);
+    fprintf(debugger->output, ": x%04x  ", state->memory[address].rawNumber);
+    printHexInstruction(debugger->output, state->memory[address].rawNumber);
+    fprintf(debugger->output, "\n");
+}
+
+static void printRegisters(LC3Debugger* debugger, LC3EmulatorState* state) {
+    fprintf(debugger->output, "PC: ");
+    printLocation(debugger, state, state->pc);
+    fprintf(debugger->output, "  CC: %c  Cycle: %llu\n", state->cc == 4 ? 'n' : state->cc == 2 ? 'z'
+                                                                               : 'p',
+            debugger->cycle);
+
+    for (int i = 0; i < 8; i++) {
+        fprintf(debugger->output, "R%d: x%04x %6d%s", i, (unsigned short)state->registers[i], state->registers[i],
+                i % 4 == 3 ? "\n" : "  ");
+    }
+}
+
+// Parses x-prefixed hex, #-prefixed or plain decimal, returns 0 when the token is not a number
+static int parseNumber(const char* token, int* value) {
+    char* end = NULL;
+    long parsed;
+    if (token[0] == 'x' || token[0] == 'X') {
+        parsed = strtol(token + 1, &end, 16);
+        token++;
+    } else if (token[0] == '#') {
+        parsed = strtol(token + 1, &end, 10);
+        token++;
+    } else {
+        parsed = strtol(token, &end, 10);
+    }
+
+    if (end == token || *end != '\0' || parsed < SHRT_MIN || parsed > USHRT_MAX) {
+        return 0;
+    }
+
+    *value = (int)parsed;
+    return 1;
+}
+
+// Step counts and cycles, which go beyond a word
+static int parseCount(const char* token, unsigned long long* count) {
+    char* end = NULL;
+    if (token[0] < '0' || token[0] > '9') {
+        return 0;
+    }
+
+    *count = strtoull(token, &end, 10);
+    return *end == '\0';
+}
+
+// A number or a label, reports unknown ones
+static int parseLocation(LC3Debugger* debugger, LC3EmulatorState* state, const char* token, int* value) {
+    if (token == NULL) {
+        fprintf(debugger->output, "Missing location\n");
+        return 0;
+    }
+
+    if (parseNumber(token, value)) {
+        return 1;
+    }
+
+    const LC3Symbol* symbol = state->image != NULL ? imageFindSymbol(state->image, token) : NULL;
+    if (symbol == NULL) {
+        fprintf(debugger->output, "Unknown location: %s\n", token);
+        return 0;
+    }
+
+    *value = symbol->address;
+    return 1;
+}
+
+// Addresses read and written by the instruction at the pc, -1 when none
+static void instructionAccesses(LC3EmulatorState* state, int* readAddress, int* secondRead, int* writeAddress) {
+    LC3DataAccess access = decodeDataAccess(state, state->memory[state->pc].rawNumber);
+
+    *readAddress = access.indirect ? access.pointer : -1;
+    *secondRead = -1;
+    *writeAddress = -1;
+
+    if (access.kind == LC3_DATA_STORE) {
+        *writeAddress = access.address;
+    } else if (access.kind == LC3_DATA_LOAD && access.indirect) {
+        *secondRead = access.address;
+    } else if (access.kind == LC3_DATA_LOAD) {
+        *readAddress = access.address;
+    }
+}
+
+// Records the first watched access of the instruction at the pc, returns 0 when there is none
+static int checkWatchpoints(LC3Debugger* debugger, LC3EmulatorState* state) {
+    int reads[2];
+    int writeAddress;
+    instructionAccesses(state, &reads[0], &reads[1], &writeAddress);
+
+    for (int i = 0; i < 2; i++) {
+        if (reads[i] >= 0 && debuggerWatchesReads(debugger, reads[i])) {
+            debugger->watchHit = reads[i];
+            debugger->watchHitWrites = 0;
+            return 1;
+        }
+    }
+
+    if (writeAddress >= 0 && debuggerWatchesWrites(debugger, writeAddress)) {
+        debugger->watchHit = writeAddress;
+        debugger->watchHitWrites = 1;
+        return 1;
+    }
+
+    return 0;
+}
+
+static void printWatchHit(LC3Debugger* debugger, LC3EmulatorState* state) {
+    unsigned short address = debugger->watchHit;
+
+    fprintf(debugger->output, "Watchpoint: ");
+    printLocation(debugger, state, state->pc);
+    if (debugger->watchHitWrites) {
+        unsigned short instruction = state->memory[state->pc].rawNumber;
+        fprintf(debugger->output, " writes ");
+        printLocation(debugger, state, address);
+        fprintf(debugger->output, " = %d -> %d\n", state->memory[address].parsedNumber,
+                state->registers[getRaw(instruction, 9, 3)]);
+    } else {
+        fprintf(debugger->output, " reads ");
+        printLocation(debugger, state, address);
+        fprintf(debugger->output, " = %d\n", state->memory[address].parsedNumber);
+    }
+}
+
+// Steps like debuggerRun(), stops at breakpoints and watchpoints only when asked to
+static DebuggerRunResult runFor(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state, unsigned long long count,
+                                int stops) {
+    TimeTravel* travel = debugger->timeTravel;
+    int quiet = state->io.suppressStdout;
+    DebuggerRunResult result = DEBUGGER_DONE;
+
+    for (unsigned long long i = 0; i < count; i++) {
+        if (debugger->cycle >= debugger->cycleLimit) {
+            result = DEBUGGER_LIMIT;
+            break;
+        }
+
+        if (stops && i > 0 && debuggerHasBreakpoint(debugger, state->pc)) {
+            result = DEBUGGER_BREAKPOINT;
+            break;
+        }
+
+        if (stops && i > 0 && debugger->watchCount > 0 && checkWatchpoints(debugger, state)) {
+            result = DEBUGGER_WATCHPOINT;
+            break;
+        }
+
+        // Output of cycles that ran before the run was rewound has been printed already
+        state->io.suppressStdout = quiet || debugger->cycle < debugger->furthestCycle;
+        step(ctx, state);
+        debugger->cycle++;
+
+        if (debugger->cycle > debugger->furthestCycle) {
+            debugger->furthestCycle = debugger->cycle;
+        }
+
+        if (travel != NULL && debugger->cycle >= travel->nextCheckpoint) {
+            timeTravelCheckpoint(travel, state, debugger->cycle);
+        }
+
+        if (state->haltSignal) {
+            result = DEBUGGER_HALTED;
+            break;
+        }
+    }
+
+    state->io.suppressStdout = quiet;
+    return result;
+}
+
+DebuggerRunResult debuggerRun(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state, unsigned long long count) {
+    return runFor(debugger, ctx, state, count, 1);
+}
+
+DebuggerRunResult debuggerContinue(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state, int* resumed) {
+    *resumed = 0;
+    if (debugger->watchCount > 0) {
+        return runFor(debugger, ctx, state, ULLONG_MAX, 1);
+    }
+
+    // A rewound run is stepped quietly up to where it was, the rest runs in the emulator at full speed
+    unsigned long long count = debugger->cycle < debugger->furthestCycle ? debugger->furthestCycle - debugger->cycle : 1;
+    DebuggerRunResult result = runFor(debugger, ctx, state, count, 1);
+    *resumed = result == DEBUGGER_DONE;
+    return result;
+}
+
+DebuggerRunResult debuggerTravelTo(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state, unsigned long long cycle) {
+    if (cycle < debugger->cycle) {
+        debugger->cycle = timeTravelRestore(debugger->timeTravel, state, cycle);
+        resetDispatch(state);
+    }
+
+    return runFor(debugger, ctx, state, cycle - debugger->cycle, 0);
+}
+
+DebuggerRunResult debuggerReverseContinue(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state) {
+    unsigned long long end = debugger->cycle;
+
+    // Each checkpoint interval is replayed to find its last stop, going back one interval at a time
+    while (end > 0) {
+        unsigned long long start = timeTravelRestore(debugger->timeTravel, state, end - 1);
+        resetDispatch(state);
+        debugger->cycle = start;
+
+        unsigned long long found = ULLONG_MAX;
+        DebuggerRunResult reason = DEBUGGER_DONE;
+        while (debugger->cycle < end) {
+            if (debuggerHasBreakpoint(debugger, state->pc)) {
+                found = debugger->cycle;
+                reason = DEBUGGER_BREAKPOINT;
+            } else if (debugger->watchCount > 0 && checkWatchpoints(debugger, state)) {
+                found = debugger->cycle;
+                reason = DEBUGGER_WATCHPOINT;
+            }
+
+            runFor(debugger, ctx, state, 1, 0);
+        }
+
+        if (found != ULLONG_MAX) {
+            debuggerTravelTo(debugger, ctx, state, found);
+            if (reason == DEBUGGER_WATCHPOINT) {
+                checkWatchpoints(debugger, state);
+            }
+            return reason;
+        }
+
+        end = start;
+    }
+
+    // Nothing stops before, the run is back at its beginning
+    debuggerTravelTo(debugger, ctx, state, 0);
+    return DEBUGGER_DONE;
+}
+
+void debuggerSetBreakpoint(LC3Debugger* debugger, LC3EmulatorState* state, unsigned short address, int enabled) {
+    setBit(debugger->breakpoints, address, enabled);
+    resetDispatch(state);
+}
+
+void debuggerSetWatchpoint(LC3Debugger* debugger, unsigned short address, int reads, int writes) {
+    int before = debuggerWatchesReads(debugger, address) | debuggerWatchesWrites(debugger, address);
+    setBit(debugger->readWatches, address, reads);
+    setBit(debugger->writeWatches, address, writes);
+    int after = reads | writes;
+
+    debugger->watchCount += after - before;
+}
+
+void debuggerClear(LC3Debugger* debugger, LC3EmulatorState* state) {
+    memset(debugger->breakpoints, 0, sizeof(debugger->breakpoints));
+    memset(debugger->readWatches, 0, sizeof(debugger->readWatches));
+    memset(debugger->writeWatches, 0, sizeof(debugger->writeWatches));
+    debugger->watchCount = 0;
+    resetDispatch(state);
+}
+
+static void listPoints(LC3Debugger* debugger, LC3EmulatorState* state) {
+    for (int address = 0; address < 65536; address++) {
+        if (debuggerHasBreakpoint(debugger, address)) {
+            fprintf(debugger->output, "Breakpoint at ");
+            printLocation(debugger, state, address);
+            fprintf(debugger->output, "\n");
+        }
+
+        int reads = debuggerWatchesReads(debugger, address);
+        int writes = debuggerWatchesWrites(debugger, address);
+        if (reads || writes) {
+            fprintf(debugger->output, "Watchpoint (%s) at ", reads && writes ? "access" : reads ? "read"
+                                                                                               : "write");
+            printLocation(debugger, state, address);
+            fprintf(debugger->output, "\n");
+        }
+    }
+}
+
+static void printHelp(LC3Debugger* debugger) {
+    fprintf(debugger->output,
+            "break|b <loc>        Stops before the instruction at the location\n"
+            "delete|d <loc>       Removes a breakpoint\n"
+            "watch|w <loc>        Stops before writes to the location\n"
+            "rwatch <loc>         Stops before reads of the location\n"
+            "awatch <loc>         Stops before reads and writes of the location\n"
+            "unwatch <loc>        Removes a watchpoint\n"
+            "info|i               Lists breakpoints and watchpoints\n"
+            "step|s [n]           Executes n instructions (1 by default)\n"
+            "continue|c           Runs until a breakpoint, a watchpoint or the end\n"
+            "reverse-step|rs [n]  Goes back n instructions (1 by default), with --time-travel\n"
+            "reverse-continue|rc  Goes back to the last breakpoint or watchpoint, with --time-travel\n"
+            "goto <cycle>         Goes back or forward to the given cycle, with --time-travel\n"
+            "regs|r               Prints the registers\n"
+            "mem|x <loc> [n]      Prints n words of memory (1 by default)\n"
+            "set <reg|loc> <val>  Sets R0-R7, pc, cc (n, z or p) or a memory word\n"
+            "quit|q               Ends the run\n"
+            "Locations and values are x-prefixed hex, decimal (optionally #-prefixed) or labels\n");
+}
+
+static void setValue(LC3Debugger* debugger, LC3EmulatorState* state, char* target, char* valueToken) {
+    if (target == NULL || valueToken == NULL) {
+        fprintf(debugger->output, "Usage: set <reg|loc> <value>\n");
+        return;
+    }
+
+    if (strcasecmp(target, "cc") == 0) {
+        if (strcasecmp(valueToken, "n") == 0) {
+            state->cc = 4;
+        } else if (strcasecmp(valueToken, "z") == 0) {
+            state->cc = 2;
+        } else if (strcasecmp(valueToken, "p") == 0) {
+            state->cc = 1;
+        } else {
+            fprintf(debugger->output, "The cc is one of n, z or p\n");
+        }
+        return;
+    }
+
+    int value;
+    if (!parseLocation(debugger, state, valueToken, &value)) {
+        return;
+    }
+
+    if (strcasecmp(target, "pc") == 0) {
+        state->pc = value;
+    } else if ((target[0] == 'r' || target[0] == 'R') && target[1] >= '0' && target[1] <= '7' && target[2] == '\0') {
+        state->registers[target[1] - '0'] = value;
+    } else {
+        int address;
+        if (parseLocation(debugger, state, target, &address)) {
+            emulatorWriteMemory(state, address, value);
+        }
+    }
+}
+
+unsigned long long debuggerStop(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state, unsigned long long cycle) {
+    debugger->cycle = cycle;
+    debugger->cycleLimit = ctx->maxCycleCount > 0 ? (unsigned long long)ctx->maxCycleCount : ULLONG_MAX;
+    if (cycle > debugger->furthestCycle) {
+        debugger->furthestCycle = cycle;
+    }
+
+    if (debugger->timeTravel != NULL && debugger->timeTravel->count == 0) {
+        timeTravelStart(debugger->timeTravel, state);
+    }
+
+    state->haltSignal = 0;
+    if (debugger->gdb != NULL) {
+        gdbStop(debugger, ctx, state);
+        return debugger->cycle;
+    }
+
+    fprintf(debugger->output, "Stopped at ");
+    printInstructionAt(debugger, state, state->pc);
+
+    char line[256];
+    for (;;) {
+        fprintf(debugger->output, "(lc3db) ");
+        fflush(debugger->output);
+
+        if (fgets(line, sizeof(line), debugger->commands) == NULL) {
+            // Nobody is left to stop for
+            debuggerClear(debugger, state);
+
+            fprintf(debugger->output, "\n");
+            return debugger->cycle;
+        }
+
+        char* command = strtok(line, " \t\r\n");
+        char* first = strtok(NULL, " \t\r\n");
+        char* second = strtok(NULL, " \t\r\n");
+        if (command == NULL) {
+            continue;
+        }
+
+        int address;
+        if (strcmp(command, "break") == 0 || strcmp(command, "b") == 0) {
+            if (parseLocation(debugger, state, first, &address)) {
+                debuggerSetBreakpoint(debugger, state, address, 1);
+            }
+        } else if (strcmp(command, "delete") == 0 || strcmp(command, "d") == 0) {
+            if (parseLocation(debugger, state, first, &address)) {
+                debuggerSetBreakpoint(debugger, state, address, 0);
+            }
+        } else if (strcmp(command, "watch") == 0 || strcmp(command, "w") == 0) {
+            if (parseLocation(debugger, state, first, &address)) {
+                debuggerSetWatchpoint(debugger, address, debuggerWatchesReads(debugger, address), 1);
+            }
+        } else if (strcmp(command, "rwatch") == 0) {
+            if (parseLocation(debugger, state, first, &address)) {
+                debuggerSetWatchpoint(debugger, address, 1, debuggerWatchesWrites(debugger, address));
+            }
+        } else if (strcmp(command, "awatch") == 0) {
+            if (parseLocation(debugger, state, first, &address)) {
+                debuggerSetWatchpoint(debugger, address, 1, 1);
+            }
+        } else if (strcmp(command, "unwatch") == 0) {
+            if (parseLocation(debugger, state, first, &address)) {
+                debuggerSetWatchpoint(debugger, address, 0, 0);
+            }
+        } else if (strcmp(command, "info") == 0 || strcmp(command, "i") == 0) {
+            listPoints(debugger, state);
+        } else if (strcmp(command, "regs") == 0 || strcmp(command, "r") == 0) {
+            printRegisters(debugger, state);
+        } else if (strcmp(command, "mem") == 0 || strcmp(command, "x") == 0) {
+            int count = 1;
+            if (parseLocation(debugger, state, first, &address) && (second == NULL || parseNumber(second, &count))) {
+                for (int i = 0; i < count; i++) {
+                    printInstructionAt(debugger, state, address + i);
+                }
+            }
+        } else if (strcmp(command, "set") == 0) {
+            setValue(debugger, state, first, second);
+        } else if (strcmp(command, "step") == 0 || strcmp(command, "s") == 0) {
+            unsigned long long count = 1;
+            if (first != NULL && (!parseCount(first, &count) || count == 0)) {
+                fprintf(debugger->output, "Invalid step count: %s\n", first);
+                continue;
+            }
+
+            DebuggerRunResult run = debuggerRun(debugger, ctx, state, count);
+            if (run == DEBUGGER_HALTED || run == DEBUGGER_LIMIT) {
+                return debugger->cycle;
+            }
+            if (run == DEBUGGER_WATCHPOINT) {
+                printWatchHit(debugger, state);
+            }
+            printInstructionAt(debugger, state, state->pc);
+        } else if (strcmp(command, "continue") == 0 || strcmp(command, "c") == 0) {
+            int resumed;
+            DebuggerRunResult run = debuggerContinue(debugger, ctx, state, &resumed);
+            if (resumed || run == DEBUGGER_HALTED || run == DEBUGGER_LIMIT) {
+                return debugger->cycle;
+            }
+            if (run == DEBUGGER_WATCHPOINT) {
+                printWatchHit(debugger, state);
+            }
+            fprintf(debugger->output, "Stopped at ");
+            printInstructionAt(debugger, state, state->pc);
+        } else if (strcmp(command, "reverse-step") == 0 || strcmp(command, "rs") == 0 || strcmp(command, "goto") == 0 ||
+                   strcmp(command, "reverse-continue") == 0 || strcmp(command, "rc") == 0) {
+            if (debugger->timeTravel == NULL) {
+                fprintf(debugger->output, "Going back needs --time-travel\n");
+                continue;
+            }
+
+            DebuggerRunResult run;
+            unsigned long long count = 1;
+            if (strcmp(command, "goto") == 0) {
+                unsigned long long target;
+                if (first == NULL || !parseCount(first, &target)) {
+                    fprintf(debugger->output, "Usage: goto <cycle>\n");
+                    continue;
+                }
+                run = debuggerTravelTo(debugger, ctx, state, target);
+            } else if (strcmp(command, "reverse-step") == 0 || strcmp(command, "rs") == 0) {
+                if (first != NULL && (!parseCount(first, &count) || count == 0)) {
+                    fprintf(debugger->output, "Invalid step count: %s\n", first);
+                    continue;
+                }
+                run = debuggerTravelTo(debugger, ctx, state, debugger->cycle > count ? debugger->cycle - count : 0);
+            } else {
+                run = debuggerReverseContinue(debugger, ctx, state);
+                if (run == DEBUGGER_DONE) {
+                    fprintf(debugger->output, "Reached the beginning of the run\n");
+                }
+            }
+
+            if (run == DEBUGGER_HALTED || run == DEBUGGER_LIMIT) {
+                return debugger->cycle;
+            }
+            if (run == DEBUGGER_WATCHPOINT) {
+                printWatchHit(debugger, state);
+            }
+            fprintf(debugger->output, "Stopped at ");
+            printInstructionAt(debugger, state, state->pc);
+        } else if (strcmp(command, "quit") == 0 || strcmp(command, "q") == 0) {
+            exit(0);
+        } else if (strcmp(command, "help") == 0 || strcmp(command, "h") == 0) {
+            printHelp(debugger);
+        } else {
+            fprintf(debugger->output, "Unknown command: %s (help lists the commands)\n", command);
+        }
+    }
+}
+
+void debuggerExited(LC3Debugger* debugger, int exitCode) {
+    if (debugger->gdb != NULL) {
+        gdbExited(debugger->gdb, exitCode);
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef LC3_DEBUGGER_H
+#define LC3_DEBUGGER_H
+
+#include <stdio.h>
+
+#include "../context/lc3context.h"
+#include "../emulator/lc3emulator.h"
+
+/*
+ * Interactive debugger (--debugger).
+ *
+ * Breakpoints are a bitmap that the emulator only reads while decoding its fused dispatch table: the
+ * address of a breakpoint decodes to a stop instead of a group, and no group is formed across one. Between
+ * breakpoints the run is the normal fused loop, with no check per cycle. A stop ends that loop like a halt
+ * (haltSignal is LC3_BREAK_SIGNAL) and emulate() hands the state to debuggerStop().
+ *
+ * Watchpoints need the address of every load and store, so while any is set the debugger steps the run
+ * itself and checks each access before executing it.
+ *
+ * Commands come from the command line front-end (locations are addresses such as x3000, #12 or 12, or
+ * labels of the assembled image) or from a GDB client (see gdbstub.h).
+ */
+typedef struct GdbConnection GdbConnection;
+typedef struct TimeTravel TimeTravel;
+
+typedef enum {
+    DEBUGGER_DONE,  // Executed the requested number of instructions
+    DEBUGGER_HALTED,
+    DEBUGGER_LIMIT,  // Reached the cycle limit
+    DEBUGGER_BREAKPOINT,
+    DEBUGGER_WATCHPOINT,
+} DebuggerRunResult;
+
+typedef struct LC3Debugger {
+    FILE* commands;
+    FILE* output;
+    GdbConnection* gdb;      // Replaces the command line front-end when set
+    TimeTravel* timeTravel;  // Checkpoints to go back to, NULL when disabled
+
+    unsigned long long cycle;  // Of the stopped run
+    unsigned long long cycleLimit;
+    unsigned long long furthestCycle;  // Cycles before it are re-executed after going back, without output
+
+    unsigned char breakpoints[65536 / 8];
+    unsigned char readWatches[65536 / 8];
+    unsigned char writeWatches[65536 / 8];
+    unsigned int watchCount;
+
+    unsigned short watchHit;  // Access that stopped the last run at a watchpoint
+    int watchHitWrites;
+} LC3Debugger;
+
+LC3Debugger* createDebugger(FILE* commands, FILE* output);
+void destroyDebugger(LC3Debugger* debugger);
+
+static inline int debuggerHasBreakpoint(const LC3Debugger* debugger, unsigned short address) {
+    return (debugger->breakpoints[address >> 3] >> (address & 7)) & 1;
+}
+
+static inline int debuggerWatchesReads(const LC3Debugger* debugger, unsigned short address) {
+    return (debugger->readWatches[address >> 3] >> (address & 7)) & 1;
+}
+
+static inline int debuggerWatchesWrites(const LC3Debugger* debugger, unsigned short address) {
+    return (debugger->writeWatches[address >> 3] >> (address & 7)) & 1;
+}
+
+void debuggerSetBreakpoint(LC3Debugger* debugger, LC3EmulatorState* state, unsigned short address, int enabled);
+void debuggerSetWatchpoint(LC3Debugger* debugger, unsigned short address, int reads, int writes);
+void debuggerClear(LC3Debugger* debugger, LC3EmulatorState* state);
+
+/*
+ * Steps at most count instructions, stopping at breakpoints and watched accesses, without passing the
+ * cycle limit. The first instruction is the one the run stopped at, it always executes.
+ */
+DebuggerRunResult debuggerRun(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state, unsigned long long count);
+
+// Continues the run, resumed is set when the rest is left to the emulator (it stops at the next breakpoint)
+DebuggerRunResult debuggerContinue(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state, int* resumed);
+
+// With time travel: goes to the given cycle, restoring a checkpoint when it lies in the past
+DebuggerRunResult debuggerTravelTo(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state, unsigned long long cycle);
+
+// With time travel: goes back to the last breakpoint or watchpoint, DEBUGGER_DONE when the run is back at its start
+DebuggerRunResult debuggerReverseContinue(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state);
+
+/*
+ * Reads commands for a stopped run (before its first instruction, or at a breakpoint) until it is
+ * continued, never running past the cycle limit. Returns the cycle the run continues from, earlier than
+ * the given one after going back in time. When the commands run out, every breakpoint and watchpoint is
+ * dropped and the run continues.
+ */
+unsigned long long debuggerStop(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state, unsigned long long cycle);
+
+// Called when the run ends (halt, cycle limit or stuck loop) with the exit code of the process
+void debuggerExited(LC3Debugger* debugger, int exitCode);
+
+#endif // LC3_DEBUGGER_H
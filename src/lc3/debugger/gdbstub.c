@@ -0,0 +1,571 @@
+#include "gdbstub.h"
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define GDB_PACKET_SIZE 4096
+#define GDB_REGISTER_COUNT 10  // r0-r7, pc, psr
+
+static const char* targetDescription =
+    "<?xml version=\"1.0\"?>\n"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">\n"
+    "<target version=\"1.0\">\n"
+    "  <feature name=\"org.lc3.core\">\n"
+    "    <reg name=\"r0\" bitsize=\"16\" type=\"int16\" regnum=\"0\"/>\n"
+    "    <reg name=\"r1\" bitsize=\"16\" type=\"int16\"/>\n"
+    "    <reg name=\"r2\" bitsize=\"16\" type=\"int16\"/>\n"
+    "    <reg name=\"r3\" bitsize=\"16\" type=\"int16\"/>\n"
+    "    <reg name=\"r4\" bitsize=\"16\" type=\"int16\"/>\n"
+    "    <reg name=\"r5\" bitsize=\"16\" type=\"int16\"/>\n"
+    "    <reg name=\"r6\" bitsize=\"16\" type=\"data_ptr\"/>\n"
+    "    <reg name=\"r7\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+    "    <reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>\n"
+    "    <reg name=\"psr\" bitsize=\"16\" type=\"int16\"/>\n"
+    "  </feature>\n"
+    "</target>\n";
+
+struct GdbConnection {
+    int socket;  // -1 once closed
+
+    unsigned char input[GDB_PACKET_SIZE];
+    size_t inputLength;
+    size_t inputPosition;
+
+    int running;  // A continue is waiting for its stop reply
+};
+
+static GdbConnection* listenTcp(int port, int* listener) {
+    *listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (*listener < 0) {
+        return NULL;
+    }
+
+    int reuse = 1;
+    setsockopt(*listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Only local clients, the stub can read and write the whole machine
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (bind(*listener, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        return NULL;
+    }
+
+    return calloc(1, sizeof(GdbConnection));
+}
+
+static GdbConnection* listenUnix(const char* path, int* listener) {
+    struct sockaddr_un address = {0};
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return NULL;
+    }
+
+    *listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (*listener < 0) {
+        return NULL;
+    }
+
+    // A stale socket of a previous session is replaced, any other file is left alone
+    struct stat existing;
+    if (stat(path, &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        unlink(path);
+    }
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    if (bind(*listener, (struct sockaddr*)&address, sizeof(address)) != 0) {
+        return NULL;
+    }
+
+    return calloc(1, sizeof(GdbConnection));
+}
+
+GdbConnection* gdbAccept(const char* address) {
+    char* end = NULL;
+    long port = strtol(address, &end, 10);
+    int isPort = *address != '\0' && *end == '\0';
+
+    int listener = -1;
+    GdbConnection* gdb = NULL;
+    if (isPort && port > 0 && port < 65536) {
+        gdb = listenTcp(port, &listener);
+    } else if (!isPort) {
+        gdb = listenUnix(address, &listener);
+    }
+
+    if (gdb == NULL || listen(listener, 1) != 0) {
+        if (listener >= 0) {
+            close(listener);
+        }
+        free(gdb);
+        return NULL;
+    }
+
+    fprintf(stderr, "Waiting for GDB on %s\n", address);
+    gdb->socket = accept(listener, NULL, NULL);
+    close(listener);
+
+    if (!isPort) {
+        unlink(address);
+    }
+
+    if (gdb->socket < 0) {
+        free(gdb);
+        return NULL;
+    }
+
+    return gdb;
+}
+
+void gdbClose(GdbConnection* gdb) {
+    if (gdb->socket >= 0) {
+        close(gdb->socket);
+    }
+    free(gdb);
+}
+
+static void disconnect(GdbConnection* gdb) {
+    if (gdb->socket >= 0) {
+        close(gdb->socket);
+        gdb->socket = -1;
+    }
+}
+
+// Next byte from the client, -1 once it is gone
+static int readByte(GdbConnection* gdb) {
+    if (gdb->inputPosition == gdb->inputLength) {
+        if (gdb->socket < 0) {
+            return -1;
+        }
+
+        ssize_t received = recv(gdb->socket, gdb->input, sizeof(gdb->input), 0);
+        if (received <= 0) {
+            disconnect(gdb);
+            return -1;
+        }
+
+        gdb->inputLength = received;
+        gdb->inputPosition = 0;
+    }
+
+    return gdb->input[gdb->inputPosition++];
+}
+
+static void sendAll(GdbConnection* gdb, const char* data, size_t length) {
+    while (length > 0 && gdb->socket >= 0) {
+        ssize_t sent = send(gdb->socket, data, length, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            disconnect(gdb);
+            return;
+        }
+
+        data += sent;
+        length -= sent;
+    }
+}
+
+static void sendPacket(GdbConnection* gdb, const char* data) {
+    size_t length = strlen(data);
+    char* packet = malloc(length + 5);
+
+    unsigned char checksum = 0;
+    for (size_t i = 0; i < length; i++) {
+        checksum += (unsigned char)data[i];
+    }
+
+    packet[0] = '$';
+    memcpy(packet + 1, data, length);
+    snprintf(packet + 1 + length, 4, "#%02x", checksum);
+
+    sendAll(gdb, packet, length + 4);
+    free(packet);
+}
+
+// Reads the next packet into buffer and acknowledges it, returns its length or -1 once the client is gone
+static int readPacket(GdbConnection* gdb, char* buffer, int capacity) {
+    for (;;) {
+        // Acknowledgements and interrupts outside of a packet are skipped
+        int c;
+        do {
+            c = readByte(gdb);
+        } while (c != '$' && c != -1);
+
+        if (c == -1) {
+            return -1;
+        }
+
+        int length = 0;
+        unsigned char checksum = 0;
+        while ((c = readByte(gdb)) != '#') {
+            if (c == -1) {
+                return -1;
+            }
+
+            checksum += c;
+            if (length < capacity - 1) {
+                buffer[length++] = c;
+            }
+        }
+        buffer[length] = '\0';
+
+        char expected[3] = {0};
+        for (int i = 0; i < 2; i++) {
+            c = readByte(gdb);
+            if (c == -1) {
+                return -1;
+            }
+            expected[i] = c;
+        }
+
+        if (strtol(expected, NULL, 16) == checksum) {
+            sendAll(gdb, "+", 1);
+            return length;
+        }
+
+        sendAll(gdb, "-", 1);
+    }
+}
+
+static unsigned short readRegister(LC3EmulatorState* state, int number) {
+    if (number < 8) {
+        return state->registers[number];
+    }
+
+    return number == 8 ? state->pc : state->cc;
+}
+
+static void writeRegister(LC3EmulatorState* state, int number, unsigned short value) {
+    if (number < 8) {
+        state->registers[number] = value;
+    } else if (number == 8) {
+        state->pc = value;
+    } else {
+        state->cc = value & 7;
+    }
+}
+
+// Parses the 4 hex digits of a word, returns 0 when they are not there
+static int parseWord(const char* text, unsigned short* value) {
+    char digits[5] = {0};
+    for (int i = 0; i < 4; i++) {
+        if (!isxdigit((unsigned char)text[i])) {
+            return 0;
+        }
+        digits[i] = text[i];
+    }
+
+    *value = strtol(digits, NULL, 16);
+    return 1;
+}
+
+static void sendStopReply(GdbConnection* gdb, LC3Debugger* debugger, DebuggerRunResult run) {
+    if (run != DEBUGGER_WATCHPOINT) {
+        sendPacket(gdb, "S05");
+        return;
+    }
+
+    unsigned short address = debugger->watchHit;
+    const char* kind = "watch";
+    if (debuggerWatchesReads(debugger, address) && debuggerWatchesWrites(debugger, address)) {
+        kind = "awatch";
+    } else if (debuggerWatchesReads(debugger, address)) {
+        kind = "rwatch";
+    }
+
+    char reply[32];
+    snprintf(reply, sizeof(reply), "T05%s:%x;", kind, address);
+    sendPacket(gdb, reply);
+}
+
+static void readMemory(GdbConnection* gdb, LC3EmulatorState* state, const char* arguments) {
+    unsigned long address;
+    unsigned long length;
+    if (sscanf(arguments, "%lx,%lx", &address, &length) != 2 || address > 0xFFFF) {
+        sendPacket(gdb, "E01");
+        return;
+    }
+
+    // Longer reads are answered partially, the client asks for the rest
+    if (length > (GDB_PACKET_SIZE - 16) / 4) {
+        length = (GDB_PACKET_SIZE - 16) / 4;
+    }
+
+    char reply[GDB_PACKET_SIZE];
+    for (unsigned long i = 0; i < length; i++) {
+        snprintf(reply + i * 4, 5, "%04x", state->memory[(unsigned short)(address + i)].rawNumber);
+    }
+    reply[length * 4] = '\0';
+
+    sendPacket(gdb, reply);
+}
+
+static void writeMemory(GdbConnection* gdb, LC3EmulatorState* state, const char* arguments) {
+    unsigned long address;
+    unsigned long length;
+    const char* data = strchr(arguments, ':');
+    if (sscanf(arguments, "%lx,%lx", &address, &length) != 2 || address > 0xFFFF || data == NULL ||
+        strlen(data + 1) != length * 4) {
+        sendPacket(gdb, "E01");
+        return;
+    }
+
+    for (unsigned long i = 0; i < length; i++) {
+        unsigned short value;
+        if (!parseWord(data + 1 + i * 4, &value)) {
+            sendPacket(gdb, "E01");
+            return;
+        }
+        emulatorWriteMemory(state, address + i, value);
+    }
+
+    sendPacket(gdb, "OK");
+}
+
+static void readRegisters(GdbConnection* gdb, LC3EmulatorState* state) {
+    char reply[GDB_REGISTER_COUNT * 4 + 1];
+    for (int i = 0; i < GDB_REGISTER_COUNT; i++) {
+        snprintf(reply + i * 4, 5, "%04x", readRegister(state, i));
+    }
+
+    sendPacket(gdb, reply);
+}
+
+static void writeRegisters(GdbConnection* gdb, LC3EmulatorState* state, const char* data) {
+    unsigned short values[GDB_REGISTER_COUNT];
+    for (int i = 0; i < GDB_REGISTER_COUNT; i++) {
+        if (!parseWord(data + i * 4, &values[i])) {
+            sendPacket(gdb, "E01");
+            return;
+        }
+    }
+
+    for (int i = 0; i < GDB_REGISTER_COUNT; i++) {
+        writeRegister(state, i, values[i]);
+    }
+    sendPacket(gdb, "OK");
+}
+
+static void accessRegister(GdbConnection* gdb, LC3EmulatorState* state, const char* packet) {
+    char* end = NULL;
+    long number = strtol(packet + 1, &end, 16);
+    if (number < 0 || number >= GDB_REGISTER_COUNT) {
+        sendPacket(gdb, "E01");
+        return;
+    }
+
+    if (packet[0] == 'p') {
+        char reply[5];
+        snprintf(reply, sizeof(reply), "%04x", readRegister(state, number));
+        sendPacket(gdb, reply);
+        return;
+    }
+
+    unsigned short value;
+    if (*end != '=' || !parseWord(end + 1, &value)) {
+        sendPacket(gdb, "E01");
+        return;
+    }
+
+    writeRegister(state, number, value);
+    sendPacket(gdb, "OK");
+}
+
+// Z and z packets: type 0 and 1 are breakpoints, 2-4 are write, read and access watchpoints of length words
+static void updatePoint(GdbConnection* gdb, LC3Debugger* debugger, LC3EmulatorState* state, const char* packet) {
+    int type;
+    unsigned long address;
+    unsigned long length;
+    if (sscanf(packet + 1, "%d,%lx,%lx", &type, &address, &length) != 3 || type < 0 || type > 4 || address > 0xFFFF) {
+        sendPacket(gdb, "");
+        return;
+    }
+
+    int enabled = packet[0] == 'Z';
+    if (type <= 1) {
+        debuggerSetBreakpoint(debugger, state, address, enabled);
+        sendPacket(gdb, "OK");
+        return;
+    }
+
+    if (length == 0) {
+        length = 1;
+    }
+
+    for (unsigned long i = 0; i < length && i < 65536; i++) {
+        unsigned short word = address + i;
+        int reads = debuggerWatchesReads(debugger, word);
+        int writes = debuggerWatchesWrites(debugger, word);
+
+        if (type == 2 || type == 4) {
+            writes = enabled;
+        }
+        if (type == 3 || type == 4) {
+            reads = enabled;
+        }
+        debuggerSetWatchpoint(debugger, word, reads, writes);
+    }
+
+    sendPacket(gdb, "OK");
+}
+
+static void sendTargetDescription(GdbConnection* gdb, const char* arguments) {
+    unsigned long offset;
+    unsigned long length;
+    if (sscanf(arguments, "target.xml:%lx,%lx", &offset, &length) != 2) {
+        sendPacket(gdb, "E00");
+        return;
+    }
+
+    size_t total = strlen(targetDescription);
+    if (offset > total) {
+        offset = total;
+    }
+    if (length > GDB_PACKET_SIZE - 16) {
+        length = GDB_PACKET_SIZE - 16;
+    }
+
+    size_t remaining = total - offset;
+    size_t chunk = remaining < length ? remaining : length;
+
+    char reply[GDB_PACKET_SIZE];
+    reply[0] = chunk < remaining ? 'm' : 'l';
+    memcpy(reply + 1, targetDescription + offset, chunk);
+    reply[chunk + 1] = '\0';
+
+    sendPacket(gdb, reply);
+}
+
+static void sendQueryReply(GdbConnection* gdb, LC3Debugger* debugger, const char* packet) {
+    if (strncmp(packet, "qSupported", 10) == 0) {
+        char reply[96];
+        snprintf(reply, sizeof(reply), "PacketSize=%x;qXfer:features:read+%s", GDB_PACKET_SIZE,
+                 debugger->timeTravel != NULL ? ";ReverseStep+;ReverseContinue+" : "");
+        sendPacket(gdb, reply);
+    } else if (strncmp(packet, "qXfer:features:read:", 20) == 0) {
+        sendTargetDescription(gdb, packet + 20);
+    } else if (strcmp(packet, "qAttached") == 0) {
+        sendPacket(gdb, "1");
+    } else if (strncmp(packet, "qSymbol", 7) == 0) {
+        sendPacket(gdb, "OK");
+    } else {
+        sendPacket(gdb, "");
+    }
+}
+
+void gdbStop(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state) {
+    GdbConnection* gdb = debugger->gdb;
+
+    // The run was continued at full speed and reached a breakpoint
+    if (gdb->running) {
+        gdb->running = 0;
+        sendStopReply(gdb, debugger, DEBUGGER_BREAKPOINT);
+    }
+
+    char packet[GDB_PACKET_SIZE];
+    for (;;) {
+        if (readPacket(gdb, packet, sizeof(packet)) < 0) {
+            // The client is gone, the program runs to its end
+            debuggerClear(debugger, state);
+            return;
+        }
+
+        DebuggerRunResult run;
+        switch (packet[0]) {
+            case '?':
+                sendStopReply(gdb, debugger, DEBUGGER_BREAKPOINT);
+                break;
+            case 'g':
+                readRegisters(gdb, state);
+                break;
+            case 'G':
+                writeRegisters(gdb, state, packet + 1);
+                break;
+            case 'p':
+            case 'P':
+                accessRegister(gdb, state, packet);
+                break;
+            case 'm':
+                readMemory(gdb, state, packet + 1);
+                break;
+            case 'M':
+                writeMemory(gdb, state, packet + 1);
+                break;
+            case 'Z':
+            case 'z':
+                updatePoint(gdb, debugger, state, packet);
+                break;
+            case 'q':
+                sendQueryReply(gdb, debugger, packet);
+                break;
+            case 'H':
+                sendPacket(gdb, "OK");
+                break;
+            case 's':
+            case 'c':
+                if (packet[1] != '\0') {
+                    state->pc = strtol(packet + 1, NULL, 16);
+                }
+
+                if (packet[0] == 'c') {
+                    // Once resumed, the stop reply is sent at the next breakpoint (or the exit code at the end)
+                    int resumed;
+                    run = debuggerContinue(debugger, ctx, state, &resumed);
+                    gdb->running = resumed;
+                } else {
+                    run = debuggerRun(debugger, ctx, state, 1);
+                }
+
+                if (gdb->running || run == DEBUGGER_HALTED || run == DEBUGGER_LIMIT) {
+                    return;
+                }
+                sendStopReply(gdb, debugger, run);
+                break;
+            case 'b':
+                if (debugger->timeTravel == NULL || (packet[1] != 's' && packet[1] != 'c')) {
+                    sendPacket(gdb, "");
+                    break;
+                }
+
+                if (packet[1] == 's') {
+                    run = debuggerTravelTo(debugger, ctx, state, debugger->cycle > 0 ? debugger->cycle - 1 : 0);
+                } else {
+                    run = debuggerReverseContinue(debugger, ctx, state);
+                }
+
+                if (debugger->cycle == 0 && run != DEBUGGER_BREAKPOINT && run != DEBUGGER_WATCHPOINT) {
+                    sendPacket(gdb, "T05replaylog:begin;");
+                } else {
+                    sendStopReply(gdb, debugger, run);
+                }
+                break;
+            case 'D':
+                sendPacket(gdb, "OK");
+                disconnect(gdb);
+                debuggerClear(debugger, state);
+                return;
+            case 'k':
+                exit(0);
+            default:
+                sendPacket(gdb, "");
+                break;
+        }
+    }
+}
+
+void gdbExited(GdbConnection* gdb, int exitCode) {
+    char reply[8];
+    snprintf(reply, sizeof(reply), "W%02x", exitCode & 0xFF);
+    sendPacket(gdb, reply);
+    disconnect(gdb);
+}
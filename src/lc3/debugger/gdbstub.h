@@ -0,0 +1,28 @@
+#ifndef LC3_GDBSTUB_H
+#define LC3_GDBSTUB_H
+
+#include "debugger.h"
+
+/*
+ * GDB remote serial protocol front-end of the debugger (--gdb).
+ *
+ * The target is word addressed: the addressable unit is one 16-bit word, so m/M lengths count words,
+ * and every word (like every register) is 4 hex digits, most significant byte first. The registers are
+ * r0-r7, pc and psr (the cc in its low 3 bits), as described by the target.xml served through qXfer.
+ *
+ * Z0/Z1 set the debugger's breakpoints and Z2-Z4 its watchpoints, so a continue runs at full speed up to
+ * the next breakpoint. With --time-travel, bs and bc step and continue backwards. The socket is not read
+ * while the program runs, it can only be stopped by its breakpoints, watchpoints or its end.
+ */
+
+// Listens on a localhost TCP port (when the address is a number) or a unix socket, until a client connects
+GdbConnection* gdbAccept(const char* address);
+void gdbClose(GdbConnection* gdb);
+
+// Serves the client while the run is stopped, moving debugger->cycle like debuggerStop()
+void gdbStop(LC3Debugger* debugger, LC3Context* ctx, LC3EmulatorState* state);
+
+// Reports the end of the run and closes the connection
+void gdbExited(GdbConnection* gdb, int exitCode);
+
+#endif // LC3_GDBSTUB_H
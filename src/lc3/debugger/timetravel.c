@@ -0,0 +1,199 @@
+#include "timetravel.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define PAGE_BYTES (LC3_PAGE_SIZE * sizeof(MemoryCell))
+
+static int hasPage(const unsigned long long* pages, int page) {
+    return (pages[page >> 6] >> (page & 63)) & 1;
+}
+
+static int countPages(const unsigned long long* pages) {
+    int count = 0;
+    for (int word = 0; word < LC3_PAGE_COUNT / 64; word++) {
+        count += __builtin_popcountll(pages[word]);
+    }
+    return count;
+}
+
+// Position of a stored page in the contents of its checkpoint
+static int pageIndex(const unsigned long long* pages, int page) {
+    int index = 0;
+    for (int word = 0; word < page >> 6; word++) {
+        index += __builtin_popcountll(pages[word]);
+    }
+    return index + __builtin_popcountll(pages[page >> 6] & ((1ULL << (page & 63)) - 1));
+}
+
+static size_t checkpointSize(const LC3Checkpoint* checkpoint) {
+    return sizeof(LC3Checkpoint) + countPages(checkpoint->pages) * PAGE_BYTES;
+}
+
+static void updateUsage(TimeTravel* travel) {
+    travel->used = 65536 * sizeof(MemoryCell);
+    for (unsigned int i = 0; i < travel->count; i++) {
+        travel->used += checkpointSize(&travel->checkpoints[i]);
+    }
+}
+
+TimeTravel* createTimeTravel(size_t budget) {
+    TimeTravel* travel = calloc(1, sizeof(TimeTravel));
+    travel->budget = budget;
+    travel->interval = TIME_TRAVEL_INTERVAL;
+    return travel;
+}
+
+void destroyTimeTravel(TimeTravel* travel) {
+    for (unsigned int i = 0; i < travel->count; i++) {
+        free(travel->checkpoints[i].contents);
+    }
+
+    free(travel->checkpoints);
+    free(travel->memory);
+    free(travel);
+}
+
+static LC3Checkpoint* appendCheckpoint(TimeTravel* travel, LC3EmulatorState* state, unsigned long long cycle) {
+    if (travel->count == travel->capacity) {
+        travel->capacity = travel->capacity == 0 ? 64 : travel->capacity * 2;
+        travel->checkpoints = realloc(travel->checkpoints, travel->capacity * sizeof(LC3Checkpoint));
+    }
+
+    LC3Checkpoint* checkpoint = &travel->checkpoints[travel->count++];
+    memset(checkpoint, 0, sizeof(LC3Checkpoint));
+
+    checkpoint->cycle = cycle;
+    memcpy(checkpoint->registers, state->registers, sizeof(checkpoint->registers));
+    checkpoint->pc = state->pc;
+    checkpoint->cc = state->cc;
+    checkpoint->inputPosition = state->io.inputPosition;
+
+    return checkpoint;
+}
+
+void timeTravelStart(TimeTravel* travel, LC3EmulatorState* state) {
+    travel->memory = malloc(65536 * sizeof(MemoryCell));
+    memcpy(travel->memory, state->memory, 65536 * sizeof(MemoryCell));
+
+    appendCheckpoint(travel, state, 0);
+    memset(state->dirtyPages, 0, sizeof(state->dirtyPages));
+    state->io.logInput = 1;
+
+    travel->nextCheckpoint = travel->interval;
+    updateUsage(travel);
+}
+
+// A page stored by the dropped checkpoint but not by its successor was not written in between
+static void mergeIntoNext(LC3Checkpoint* dropped, LC3Checkpoint* next) {
+    unsigned long long pages[LC3_PAGE_COUNT / 64];
+    for (int word = 0; word < LC3_PAGE_COUNT / 64; word++) {
+        pages[word] = dropped->pages[word] | next->pages[word];
+    }
+
+    MemoryCell* contents = malloc(countPages(pages) * PAGE_BYTES + 1);
+    int index = 0;
+    for (int page = 0; page < LC3_PAGE_COUNT; page++) {
+        if (!hasPage(pages, page)) {
+            continue;
+        }
+
+        LC3Checkpoint* source = hasPage(next->pages, page) ? next : dropped;
+        memcpy(&contents[index * LC3_PAGE_SIZE], &source->contents[pageIndex(source->pages, page) * LC3_PAGE_SIZE], PAGE_BYTES);
+        index++;
+    }
+
+    free(dropped->contents);
+    free(next->contents);
+    memcpy(next->pages, pages, sizeof(pages));
+    next->contents = contents;
+}
+
+// Halves the checkpoints (keeping the first and the last) until they fit the budget
+static void thin(TimeTravel* travel) {
+    while (travel->used > travel->budget && travel->count > 2) {
+        unsigned int kept = 1;
+        for (unsigned int i = 1; i < travel->count; i++) {
+            if (i % 2 == 1 && i < travel->count - 1) {
+                mergeIntoNext(&travel->checkpoints[i], &travel->checkpoints[i + 1]);
+            } else {
+                travel->checkpoints[kept++] = travel->checkpoints[i];
+            }
+        }
+
+        travel->count = kept;
+        travel->interval *= 2;
+        updateUsage(travel);
+    }
+}
+
+void timeTravelCheckpoint(TimeTravel* travel, LC3EmulatorState* state, unsigned long long cycle) {
+    LC3Checkpoint* checkpoint = appendCheckpoint(travel, state, cycle);
+    memcpy(checkpoint->pages, state->dirtyPages, sizeof(checkpoint->pages));
+    memset(state->dirtyPages, 0, sizeof(state->dirtyPages));
+
+    checkpoint->contents = malloc(countPages(checkpoint->pages) * PAGE_BYTES + 1);
+    int index = 0;
+    for (int page = 0; page < LC3_PAGE_COUNT; page++) {
+        if (hasPage(checkpoint->pages, page)) {
+            memcpy(&checkpoint->contents[index * LC3_PAGE_SIZE], &state->memory[page * LC3_PAGE_SIZE], PAGE_BYTES);
+            index++;
+        }
+    }
+
+    travel->used += checkpointSize(checkpoint);
+    thin(travel);
+
+    travel->nextCheckpoint = cycle + travel->interval;
+}
+
+unsigned long long timeTravelRestore(TimeTravel* travel, LC3EmulatorState* state, unsigned long long cycle) {
+    unsigned int target = travel->count - 1;
+    while (target > 0 && travel->checkpoints[target].cycle > cycle) {
+        target--;
+    }
+
+    // Every page written since the target, restored from the last copy at or before it
+    unsigned long long changed[LC3_PAGE_COUNT / 64];
+    memcpy(changed, state->dirtyPages, sizeof(changed));
+    for (unsigned int i = target + 1; i < travel->count; i++) {
+        for (int word = 0; word < LC3_PAGE_COUNT / 64; word++) {
+            changed[word] |= travel->checkpoints[i].pages[word];
+        }
+    }
+
+    for (int page = 0; page < LC3_PAGE_COUNT; page++) {
+        if (!hasPage(changed, page)) {
+            continue;
+        }
+
+        const MemoryCell* source = &travel->memory[page * LC3_PAGE_SIZE];
+        for (unsigned int i = target; i > 0; i--) {
+            LC3Checkpoint* checkpoint = &travel->checkpoints[i];
+            if (hasPage(checkpoint->pages, page)) {
+                source = &checkpoint->contents[pageIndex(checkpoint->pages, page) * LC3_PAGE_SIZE];
+                break;
+            }
+        }
+
+        memcpy(&state->memory[page * LC3_PAGE_SIZE], source, PAGE_BYTES);
+    }
+
+    for (unsigned int i = target + 1; i < travel->count; i++) {
+        free(travel->checkpoints[i].contents);
+    }
+    travel->count = target + 1;
+    updateUsage(travel);
+
+    LC3Checkpoint* checkpoint = &travel->checkpoints[target];
+    memset(state->dirtyPages, 0, sizeof(state->dirtyPages));
+    memcpy(state->registers, checkpoint->registers, sizeof(state->registers));
+    state->pc = checkpoint->pc;
+    state->cc = checkpoint->cc;
+    state->io.inputPosition = checkpoint->inputPosition;
+    state->haltSignal = 0;
+    state->fault = LC3_FAULT_NONE;
+
+    travel->nextCheckpoint = checkpoint->cycle + travel->interval;
+    return checkpoint->cycle;
+}
@@ -0,0 +1,57 @@
+#ifndef LC3_TIMETRAVEL_H
+#define LC3_TIMETRAVEL_H
+
+#include <stddef.h>
+
+#include "../emulator/lc3emulator.h"
+
+/*
+ * Checkpoints of a debugged run, so earlier cycles can be reached by restoring the closest checkpoint
+ * before them and executing forward again.
+ *
+ * The first checkpoint holds the whole memory, every later one the registers, pc, cc, input position and
+ * only the pages written since the previous checkpoint (the state's dirty page bitmap), as they were at
+ * its cycle. Characters read from stdin are logged (see LC3IO) so re-executed GETCs read the same input.
+ *
+ * When the checkpoints outgrow the memory budget, every other one is merged into its successor and the
+ * interval doubles, so the run is always covered at an even spacing.
+ */
+#define TIME_TRAVEL_INTERVAL (1 << 16)
+
+typedef struct LC3Checkpoint {
+    unsigned long long cycle;
+    short registers[8];
+    unsigned short pc;
+    unsigned short cc;
+    size_t inputPosition;
+
+    unsigned long long pages[LC3_PAGE_COUNT / 64];  // Pages stored, in the order of their numbers
+    MemoryCell* contents;
+} LC3Checkpoint;
+
+typedef struct TimeTravel {
+    size_t budget;  // Bytes
+    size_t used;
+
+    unsigned long long interval;
+    unsigned long long nextCheckpoint;
+
+    MemoryCell* memory;  // Memory at the first checkpoint
+    LC3Checkpoint* checkpoints;
+    unsigned int count;
+    unsigned int capacity;
+} TimeTravel;
+
+TimeTravel* createTimeTravel(size_t budget);
+void destroyTimeTravel(TimeTravel* travel);
+
+// Takes the first checkpoint and starts logging input
+void timeTravelStart(TimeTravel* travel, LC3EmulatorState* state);
+
+// Called once the run reaches nextCheckpoint
+void timeTravelCheckpoint(TimeTravel* travel, LC3EmulatorState* state, unsigned long long cycle);
+
+// Restores the last checkpoint at or before the cycle and drops the later ones, returns its cycle
+unsigned long long timeTravelRestore(TimeTravel* travel, LC3EmulatorState* state, unsigned long long cycle);
+
+#endif // LC3_TIMETRAVEL_H
@@ -0,0 +1,41 @@
+#ifndef LC3_ACCESS_H
+#define LC3_ACCESS_H
+
+#include "lc3decode.h"
+#include "lc3emulator.h"
+
+/*
+ * Memory access observers (context.observer), told about every instruction fetch and every load and
+ * store of LD/LDR/LDI/ST/STR/STI, in the order the instruction makes them (LDI/STI read the pointer
+ * before the target).
+ *
+ * Like the profiles, observers are called by the stepped engine before each instruction, so setting
+ * one turns fusion off and the default engine is left without a check. Memory touched by the emulated
+ * traps (PUTS strings) and by interrupt entry is not reported.
+ */
+typedef enum {
+    LC3_ACCESS_FETCH,
+    LC3_ACCESS_READ,
+    LC3_ACCESS_WRITE,
+} LC3AccessKind;
+
+typedef struct LC3MemoryObserver {
+    void (*access)(void *data, unsigned short address, LC3AccessKind kind);
+    void *data;
+} LC3MemoryObserver;
+
+// Reports the accesses of the instruction at the pc, which is about to run
+static inline void observeAccesses(const LC3MemoryObserver *observer, const LC3EmulatorState *state) {
+    LC3DataAccess access = decodeDataAccess(state, state->memory[state->pc].rawNumber);
+
+    observer->access(observer->data, state->pc, LC3_ACCESS_FETCH);
+
+    if (access.indirect) {
+        observer->access(observer->data, access.pointer, LC3_ACCESS_READ);
+    }
+    if (access.kind != LC3_DATA_NONE) {
+        observer->access(observer->data, access.address, access.kind == LC3_DATA_STORE ? LC3_ACCESS_WRITE : LC3_ACCESS_READ);
+    }
+}
+
+#endif // LC3_ACCESS_H
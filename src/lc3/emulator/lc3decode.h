@@ -0,0 +1,62 @@
+#ifndef LC3_DECODE_H
+#define LC3_DECODE_H
+
+#include "lc3emulator.h"
+
+// Extracts count bits starting at bit at
+static inline unsigned short getRaw(unsigned short instruction, short at, short count) {
+    return (instruction >> at) & ((1 << count) - 1);
+}
+
+// Extracts count bits starting at bit at, sign extended
+static inline short getAsNumber(unsigned short instruction, short at, short count) {
+    unsigned short raw = getRaw(instruction, at, count);
+    return raw & (1 << (count - 1)) ? raw - (1 << count) : raw;
+}
+
+/*
+ * Data accesses of LD/LDR/LDI/ST/STR/STI, decoded from the state before the instruction runs. LDI/STI
+ * read their pointer word before the target. Protection, the memory observers, the debugger's
+ * watchpoints, memoization and the uninitialized-read checks all take their addresses from here.
+ */
+typedef enum {
+    LC3_DATA_NONE,
+    LC3_DATA_LOAD,
+    LC3_DATA_STORE,
+} LC3DataKind;
+
+typedef struct LC3DataAccess {
+    LC3DataKind kind;
+    int indirect;            // LDI/STI
+    unsigned short pointer;  // The word holding the address, when indirect
+    unsigned short address;  // The word loaded or stored
+} LC3DataAccess;
+
+static inline LC3DataAccess decodeDataAccess(const LC3EmulatorState *state, unsigned short instruction) {
+    LC3DataAccess access = {LC3_DATA_NONE, 0, 0, 0};
+    unsigned short opcode = instruction >> 12;
+
+    switch (opcode) {
+        case 2:  // LD
+        case 3:  // ST
+            access.address = state->pc + 1 + getAsNumber(instruction, 0, 9);
+            break;
+        case 6:  // LDR
+        case 7:  // STR
+            access.address = state->registers[getRaw(instruction, 6, 3)] + getAsNumber(instruction, 0, 6);
+            break;
+        case 10:  // LDI
+        case 11:  // STI
+            access.indirect = 1;
+            access.pointer = state->pc + 1 + getAsNumber(instruction, 0, 9);
+            access.address = state->memory[access.pointer].rawNumber;
+            break;
+        default:
+            return access;
+    }
+
+    access.kind = opcode == 3 || opcode == 7 || opcode == 11 ? LC3_DATA_STORE : LC3_DATA_LOAD;
+    return access;
+}
+
+#endif // LC3_DECODE_H
@@ -1,17 +1,26 @@
 #include "lc3emulator.h"
 
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 
-static inline unsigned short getRaw(unsigned short instruction, short at, short count) {
-    return (instruction >> at) & ((1 << count) - 1);
-}
-
-static inline short getAsNumber(unsigned short instruction, short at, short count) {
-    unsigned short raw = getRaw(instruction, at, count);
-    return raw & (1 << (count - 1)) ? raw - (1 << count) : raw;
-}
+#include "../debugger/debugger.h"
+#include "../debugger/timetravel.h"
+#include "../image/lc3image.h"
+#include "../memo/memo.h"
+#include "../profile/callprofile.h"
+#include "../profile/coverage.h"
+#include "../profile/hostcounters.h"
+#include "../profile/pairprofile.h"
+#include "../profile/timing.h"
+#include "../shadow/shadow.h"
+#include "lc3access.h"
+#include "lc3decode.h"
+#include "lc3interrupt.h"
+#include "lc3loop.h"
+#include "lc3multicore.h"
+#include "lc3protect.h"
 
 // typedef struct {
 //     unsigned short opcode : 4;  // Opcode always takes up the first 4 bits
@@ -74,6 +83,68 @@ static inline short getAsNumber(unsigned short instruction, short at, short coun
 //     } __attribute__((packed));
 // } __attribute__((packed)) EmulatorInstruction;
 
+// Longest fused group in words, a store invalidates the groups starting this many words before it
+#define FUSION_WINDOW 8
+
+// Bijective mix of an address and value, XORed into the loop detector's memory digest
+static inline unsigned long long digestWord(unsigned short address, unsigned short value) {
+    unsigned long long x = ((unsigned long long)address << 16 | value) * 0x9E3779B97F4A7C15ULL;
+    return x ^ (x >> 29);
+}
+
+/*
+ * The instruction loop of emulate() is written once and instantiated for every combination of features
+ * (EMULATE_VARIANT), emulate() picks the instance matching the context. The features are passed down to
+ * the step functions as well, so a run without debug output, profiling or loop detection tests nothing
+ * per instruction but the halt signal and the cycle limit, and nothing per store but the dirty page.
+ */
+enum {
+    EMULATE_FUSED = 0,     // Superinstructions (stepFused), stores invalidate fused groups
+    EMULATE_MEMOIZED = 1,  // memoStep
+    EMULATE_STEPPED = 2,   // One instruction at a time
+    EMULATE_DISPATCH = 3,
+    EMULATE_TRACE = 4,   // printState before every instruction (--debug), stepped only
+    EMULATE_LIMIT = 8,   // --max-cycles
+    EMULATE_EVENTS = 16, // Interrupts, loop detector samples (and the memory digest) and time travel checkpoints
+    EMULATE_HOOKS = 32,  // Access control and the profiling and checking hooks, stepped only
+};
+
+// Features of a step or store made outside the instruction loop (debugger, loop detector, other engines)
+static inline int anyFeatures(const LC3EmulatorState *state) {
+    return (state->fusion != NULL ? EMULATE_FUSED : EMULATE_STEPPED) | EMULATE_EVENTS;
+}
+
+// Everything a store changes besides the word, once memory holds it
+static inline void trackStore(LC3EmulatorState *state, unsigned short address, const int features) {
+    markPageDirty(state, address);
+
+    // Device registers are followed at the next dispatch, runs with interrupts always have EMULATE_EVENTS
+    if ((features & EMULATE_EVENTS) && address >= LC3_DEVICE_BASE && state->interrupts.enabled) {
+        state->nextEvent = 0;
+    }
+
+    // Any fused group covering the address has to be decoded again
+    if ((features & EMULATE_DISPATCH) == EMULATE_FUSED) {
+        for (int i = 0; i < FUSION_WINDOW; i++) {
+            state->fusion[(unsigned short)(address - i)] = 0;
+        }
+    }
+}
+
+// Memory is shared by the cores of --cores, words are accessed atomically (but unordered, see lc3multicore.h)
+static inline short readMemory(const LC3EmulatorState *state, unsigned short address) {
+    return __atomic_load_n(&state->memory[address].parsedNumber, __ATOMIC_RELAXED);
+}
+
+static inline void writeMemory(LC3EmulatorState *state, unsigned short address, short value, const int features) {
+    if ((features & EMULATE_EVENTS) && state->loop.enabled) {
+        state->loop.memoryDigest ^= digestWord(address, state->memory[address].rawNumber) ^ digestWord(address, value);
+    }
+
+    __atomic_store_n(&state->memory[address].parsedNumber, value, __ATOMIC_RELAXED);
+    trackStore(state, address, features);
+}
+
 static inline void stepBr(LC3EmulatorState *state, unsigned short instruction) {
     unsigned short nzp = getRaw(instruction, 9, 3);
     short pcOffset9 = getAsNumber(instruction, 0, 9);
@@ -106,17 +177,18 @@ static inline void stepLd(LC3EmulatorState *state, unsigned short instruction) {
     // state->cc = state->memory[address].parsedNumber == 0 ? 2 : state->memory[address].parsedNumber < 0 ? 4 : 1;
 
     unsigned short address = state->pc + getAsNumber(instruction, 0, 9);
-    state->registers[getRaw(instruction, 9, 3)] = state->memory[address].parsedNumber;
-    state->cc = state->memory[address].parsedNumber == 0 ? 2 : state->memory[address].parsedNumber < 0 ? 4
-                                                                                                       : 1;
+    short value = readMemory(state, address);
+    state->registers[getRaw(instruction, 9, 3)] = value;
+    state->cc = value == 0 ? 2 : value < 0 ? 4
+                                           : 1;
 }
 
-static inline void stepSt(LC3EmulatorState *state, unsigned short instruction) {
+static inline void stepSt(LC3EmulatorState *state, unsigned short instruction, const int features) {
     // unsigned short address = state->pc + instruction->st_sti.pcOffset9;
     // state->memory[address].parsedNumber = state->registers[instruction->st_sti.sourceRegister];
 
     unsigned short address = state->pc + getAsNumber(instruction, 0, 9);
-    state->memory[address].parsedNumber = state->registers[getRaw(instruction, 9, 3)];
+    writeMemory(state, address, state->registers[getRaw(instruction, 9, 3)], features);
 }
 
 static inline void stepJsrJsrr(LC3EmulatorState *state, unsigned short instruction) {
@@ -160,11 +232,12 @@ static inline void stepLdr(LC3EmulatorState *state, unsigned short instruction)
     unsigned short offset = getAsNumber(instruction, 0, 6);
     unsigned short address = base + offset;
 
-    state->registers[getRaw(instruction, 9, 3)] = state->memory[address].parsedNumber;
-    state->cc = state->memory[address].parsedNumber == 0 ? 2 : state->memory[address].parsedNumber < 0 ? 4
-                                                                                                       : 1;
+    short value = readMemory(state, address);
+    state->registers[getRaw(instruction, 9, 3)] = value;
+    state->cc = value == 0 ? 2 : value < 0 ? 4
+                                           : 1;
 }
-static inline void stepStr(LC3EmulatorState *state, unsigned short instruction) {
+static inline void stepStr(LC3EmulatorState *state, unsigned short instruction, const int features) {
     // unsigned short base = state->registers[instruction->str.baseRegister];
     // unsigned short offset = instruction->str.offset6;
     // unsigned short address = base + offset;
@@ -175,12 +248,21 @@ static inline void stepStr(LC3EmulatorState *state, unsigned short instruction)
     unsigned short offset = getAsNumber(instruction, 0, 6);
     unsigned short address = base + offset;
 
-    state->memory[address].parsedNumber = state->registers[getRaw(instruction, 9, 3)];
+    writeMemory(state, address, state->registers[getRaw(instruction, 9, 3)], features);
+}
+
+static inline void fault(LC3EmulatorState *state, LC3Fault fault) {
+    state->fault = fault;
+    state->haltSignal = LC3_FAULT_SIGNAL;
 }
 
 static inline void stepRti(LC3EmulatorState *state, unsigned short instruction) {
-    fprintf(stderr, "RTI encountered!\n");
-    exit(1);
+    if (state->interrupts.enabled) {
+        interruptReturn(state);
+        return;
+    }
+
+    fault(state, LC3_FAULT_RTI);
 }
 
 static inline void stepNot(LC3EmulatorState *state, unsigned short instruction) {
@@ -207,20 +289,21 @@ static inline void stepLdi(LC3EmulatorState *state, unsigned short instruction)
     // state->cc = state->memory[indirectAddress].parsedNumber == 0 ? 2 : state->memory[indirectAddress].parsedNumber < 0 ? 4 : 1;
 
     unsigned short address = state->pc + getAsNumber(instruction, 0, 9);
-    unsigned short indirectAddress = state->memory[address].parsedNumber;
-    state->registers[getRaw(instruction, 9, 3)] = state->memory[indirectAddress].parsedNumber;
-    state->cc = state->memory[indirectAddress].parsedNumber == 0 ? 2 : state->memory[indirectAddress].parsedNumber < 0 ? 4
-                                                                                                                       : 1;
+    unsigned short indirectAddress = readMemory(state, address);
+    short value = readMemory(state, indirectAddress);
+    state->registers[getRaw(instruction, 9, 3)] = value;
+    state->cc = value == 0 ? 2 : value < 0 ? 4
+                                           : 1;
 }
 
-static inline void stepSti(LC3EmulatorState *state, unsigned short instruction) {
+static inline void stepSti(LC3EmulatorState *state, unsigned short instruction, const int features) {
     // unsigned short address = state->pc + instruction->st_sti.pcOffset9;
     // unsigned short indirectAddress = state->memory[address].parsedNumber;
     // state->memory[indirectAddress].parsedNumber = state->registers[instruction->st_sti.sourceRegister];
 
     unsigned short address = state->pc + getAsNumber(instruction, 0, 9);
-    unsigned short indirectAddress = state->memory[address].parsedNumber;
-    state->memory[indirectAddress].parsedNumber = state->registers[getRaw(instruction, 9, 3)];
+    unsigned short indirectAddress = readMemory(state, address);
+    writeMemory(state, indirectAddress, state->registers[getRaw(instruction, 9, 3)], features);
 }
 
 static inline void stepJmp(LC3EmulatorState *state, unsigned short instruction) {
@@ -232,8 +315,12 @@ static inline void stepJmp(LC3EmulatorState *state, unsigned short instruction)
 }
 
 static inline void stepRes(LC3EmulatorState *state, unsigned short instruction) {
-    fprintf(stderr, "Reserved opcode encountered!\n");
-    exit(1);
+    if (state->interrupts.enabled) {
+        interruptEnter(state, LC3_VECTOR_ILLEGAL_OPCODE, -1);
+        return;
+    }
+
+    fault(state, LC3_FAULT_RESERVED_OPCODE);
 }
 
 static inline void stepLea(LC3EmulatorState *state, unsigned short instruction) {
@@ -244,48 +331,102 @@ static inline void stepLea(LC3EmulatorState *state, unsigned short instruction)
     state->registers[getRaw(instruction, 9, 3)] = address;
 }
 
-static inline void stepTrap(LC3EmulatorState *state, unsigned short instruction) {
+static void captureOutput(LC3IO *io, char c) {
+    if (io->outputLength == io->outputCapacity) {
+        io->outputCapacity = io->outputCapacity == 0 ? 256 : io->outputCapacity * 2;
+        io->output = realloc(io->output, io->outputCapacity);
+    }
+
+    io->output[io->outputLength++] = c;
+}
+
+static void logInput(LC3IO *io, unsigned char c) {
+    if (io->inputLogLength == io->inputLogCapacity) {
+        io->inputLogCapacity = io->inputLogCapacity == 0 ? 256 : io->inputLogCapacity * 2;
+        io->inputLog = realloc(io->inputLog, io->inputLogCapacity);
+    }
+
+    io->inputLog[io->inputLogLength++] = c;
+}
+
+static inline int readInput(LC3EmulatorState *state) {
+    LC3IO *io = &state->io;
+    if (io->input == NULL) {
+        // Input read before the run was rewound
+        if (io->inputPosition < io->inputLogLength) {
+            return io->inputLog[io->inputPosition++];
+        }
+
+        io->inputPosition++;
+        int c = getchar();
+        if (io->logInput && c != EOF) {
+            logInput(io, c);
+        }
+        return c;
+    }
+
+    if (io->inputPosition >= io->inputLength) {
+        return -1;
+    }
+
+    return io->input[io->inputPosition++];
+}
+
+static inline void writeOutput(LC3EmulatorState *state, char c) {
+    if (!state->io.suppressStdout) {
+        putchar(c);
+    }
+
+    if (state->io.captureOutput) {
+        captureOutput(&state->io, c);
+    }
+}
+
+static inline void stepTrap(LC3EmulatorState *state, unsigned short instruction, const int features) {
     short trapVector = getAsNumber(instruction, 0, 8);
 
     if (trapVector == 0x20) {
         // GETC
-        int c = getchar();
+        int c = readInput(state);
         if (c == -1) {
-            perror("\n\nGETC called after end of input!");
-            exit(1);
+            fault(state, LC3_FAULT_END_OF_INPUT);
+            return;
         }
         state->registers[0] = (char)c;
     } else if (trapVector == 0x21) {
         // OUT
-        putchar(state->registers[0]);
+        writeOutput(state, state->registers[0]);
         fflush(stdout);
     } else if (trapVector == 0x22) {
         // PUTS
-        unsigned short registerValue = state->registers[0];
-        unsigned short *address = &state->memory[registerValue].rawNumber;
-        while (*address) {
-            putchar(*address);
+        unsigned short address = state->registers[0];
+        unsigned short word;
+        while ((word = readMemory(state, address)) != 0) {
+            writeOutput(state, word);
             address++;
         }
         fflush(stdout);
     } else if (trapVector == 0x23) {
         // IN
-        printf("Input a character> ");
-        char c = getchar();
+        const char *prompt = "Input a character> ";
+        while (*prompt) {
+            writeOutput(state, *prompt++);
+        }
+        char c = readInput(state);
         state->registers[0] = c;
-        putchar(c);
+        writeOutput(state, c);
         fflush(stdout);
     } else if (trapVector == 0x24) {
         // PUTSP
-        unsigned short registerValue = state->registers[0];
-        unsigned short *address = &state->memory[registerValue].rawNumber;
-        while (*address) {
-            char c = (*address) & 0xFF;
-            putchar(c);
+        unsigned short address = state->registers[0];
+        unsigned short word;
+        while ((word = readMemory(state, address)) != 0) {
+            char c = word & 0xFF;
+            writeOutput(state, c);
 
-            c = (*address) >> 8;
+            c = word >> 8;
             if (c == 0) break;
-            putchar(c);
+            writeOutput(state, c);
 
             address++;
         }
@@ -294,105 +435,124 @@ static inline void stepTrap(LC3EmulatorState *state, unsigned short instruction)
     } else if (trapVector == 0x25) {
         // HALT
         state->haltSignal = 1;
+    } else if (trapVector == LC3_TRAP_CORE) {
+        state->registers[0] = state->core;
+        state->registers[1] = state->coreCount != 0 ? state->coreCount : 1;
+    } else if (trapVector == LC3_TRAP_CAS) {
+        unsigned short address = state->registers[0];
+        unsigned short previous = state->registers[1];
+        unsigned short value = state->registers[2];
+
+        // Other cores may store to the word between a plain load and store
+        if (__atomic_compare_exchange_n(&state->memory[address].rawNumber, &previous, value, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            if ((features & EMULATE_EVENTS) && state->loop.enabled) {
+                state->loop.memoryDigest ^= digestWord(address, previous) ^ digestWord(address, value);
+            }
+            trackStore(state, address, features);
+        }
+        state->registers[1] = previous;
     }
 }
 
-void printHexInstruction(unsigned short instruction) {
+void printHexInstruction(FILE *stream, unsigned short instruction) {
     unsigned short opcode = getRaw(instruction, 12, 4);
     unsigned short dr = getRaw(instruction, 9, 3);
     unsigned short sr1 = getRaw(instruction, 6, 3);
     unsigned short sr2 = getRaw(instruction, 0, 3);
-    unsigned short imm5 = getAsNumber(instruction, 0, 5);
+    short imm5 = getAsNumber(instruction, 0, 5);
     unsigned short nzp = getRaw(instruction, 9, 3);
     short pcOffset9 = getAsNumber(instruction, 0, 9);
     unsigned short baseRegister = getRaw(instruction, 6, 3);
-    unsigned short offset6 = getAsNumber(instruction, 0, 6);
-    unsigned short trapVector = getAsNumber(instruction, 0, 8);
-    unsigned short pcOffset11 = getAsNumber(instruction, 0, 11);
+    short offset6 = getAsNumber(instruction, 0, 6);
+    unsigned short trapVector = getRaw(instruction, 0, 8);
+    short pcOffset11 = getAsNumber(instruction, 0, 11);
 
     switch (opcode) {
         case 0:
-            printf("BR");
-            if (nzp & 4) printf("n");
-            if (nzp & 2) printf("z");
-            if (nzp & 1) printf("p");
-            printf(" #%d", pcOffset9);
+            fprintf(stream, "BR");
+            if (nzp & 4) fprintf(stream, "n");
+            if (nzp & 2) fprintf(stream, "z");
+            if (nzp & 1) fprintf(stream, "p");
+            fprintf(stream, " #%d", pcOffset9);
             break;
         case 1:
-            printf("ADD R%d, R%d, ", dr, sr1);
+            fprintf(stream, "ADD R%d, R%d, ", dr, sr1);
             if (instruction & (1 << 5)) {
-                printf("#%d", imm5);
+                fprintf(stream, "#%d", imm5);
             } else {
-                printf("R%d", sr2);
+                fprintf(stream, "R%d", sr2);
             }
             break;
         case 2:
-            printf("LD R%d, %d", dr, pcOffset9);
+            fprintf(stream, "LD R%d, %d", dr, pcOffset9);
             break;
         case 3:
-            printf("ST R%d, %d", dr, pcOffset9);
+            fprintf(stream, "ST R%d, %d", dr, pcOffset9);
             break;
         case 4:
             if (instruction & (1 << 11)) {
-                printf("JSR %d", pcOffset11);
+                fprintf(stream, "JSR %d", pcOffset11);
             } else {
-                printf("JSRR R%d", baseRegister);
+                fprintf(stream, "JSRR R%d", baseRegister);
             }
             break;
         case 5:
-            printf("AND R%d, R%d, ", dr, sr1);
+            fprintf(stream, "AND R%d, R%d, ", dr, sr1);
             if (instruction & (1 << 5)) {
-                printf("#%d", imm5);
+                fprintf(stream, "#%d", imm5);
             } else {
-                printf("R%d", sr2);
+                fprintf(stream, "R%d", sr2);
             }
             break;
         case 6:
-            printf("LDR R%d, R%d, %d", dr, baseRegister, offset6);
+            fprintf(stream, "LDR R%d, R%d, %d", dr, baseRegister, offset6);
             break;
         case 7:
-            printf("STR R%d, R%d, %d", sr1, baseRegister, offset6);
+            fprintf(stream, "STR R%d, R%d, %d", dr, baseRegister, offset6);
             break;
         case 8:
-            printf("RTI");
+            fprintf(stream, "RTI");
             break;
         case 9:
-            printf("NOT R%d, R%d", dr, sr1);
+            fprintf(stream, "NOT R%d, R%d", dr, sr1);
             break;
         case 10:
-            printf("LDI R%d, %d", dr, pcOffset9);
+            fprintf(stream, "LDI R%d, %d", dr, pcOffset9);
             break;
         case 11:
-            printf("STI R%d, %d", sr1, pcOffset9);
+            fprintf(stream, "STI R%d, %d", dr, pcOffset9);
             break;
         case 12:
-            printf("JMP R%d", baseRegister);
+            fprintf(stream, "JMP R%d", baseRegister);
             break;
         case 13:
-            printf("RESERVED");
+            fprintf(stream, "RESERVED");
             break;
         case 14:
-            printf("LEA R%d, %d", dr, pcOffset9);
+            fprintf(stream, "LEA R%d, %d", dr, pcOffset9);
             break;
         case 15:
             switch (trapVector) {
                 case 0x20:
-                    printf("GETC");
+                    fprintf(stream, "GETC");
                     break;
                 case 0x21:
-                    printf("OUT");
+                    fprintf(stream, "OUT");
                     break;
                 case 0x22:
-                    printf("PUTS");
+                    fprintf(stream, "PUTS");
                     break;
                 case 0x23:
-                    printf("IN");
+                    fprintf(stream, "IN");
                     break;
                 case 0x24:
-                    printf("PUTSP");
+                    fprintf(stream, "PUTSP");
                     break;
                 case 0x25:
-                    printf("HALT");
+                    fprintf(stream, "HALT");
+                    break;
+                default:
+                    fprintf(stream, "TRAP x%02x", trapVector);
                     break;
             }
             break;
@@ -412,15 +572,15 @@ void printState(LC3EmulatorState *state) {
     }
 
     printf(" -> ISTR: ");
-    printHexInstruction(state->memory[state->pc].rawNumber);
+    printHexInstruction(stdout, state->memory[state->pc].rawNumber);
     printf(" (x%04x)\n", state->memory[state->pc].rawNumber);
 }
 
-void step(LC3Context *ctx, LC3EmulatorState *state) {
+static inline __attribute__((always_inline)) void stepInstruction(LC3Context *ctx, LC3EmulatorState *state, const int features) {
     unsigned short pc = state->pc;
     state->pc++;
 
-    unsigned short instruction = state->memory[pc].rawNumber;
+    unsigned short instruction = readMemory(state, pc);
     unsigned short opcode = getRaw(instruction, 12, 4);
 
     switch (opcode) {
@@ -434,7 +594,7 @@ void step(LC3Context *ctx, LC3EmulatorState *state) {
             stepLd(state, instruction);
             break;
         case 3:
-            stepSt(state, instruction);
+            stepSt(state, instruction, features);
             break;
         case 4:
             stepJsrJsrr(state, instruction);
@@ -446,7 +606,7 @@ void step(LC3Context *ctx, LC3EmulatorState *state) {
             stepLdr(state, instruction);
             break;
         case 7:
-            stepStr(state, instruction);
+            stepStr(state, instruction, features);
             break;
         case 8:
             stepRti(state, instruction);
@@ -458,7 +618,7 @@ void step(LC3Context *ctx, LC3EmulatorState *state) {
             stepLdi(state, instruction);
             break;
         case 11:
-            stepSti(state, instruction);
+            stepSti(state, instruction, features);
             break;
         case 12:
             stepJmp(state, instruction);
@@ -470,30 +630,630 @@ void step(LC3Context *ctx, LC3EmulatorState *state) {
             stepLea(state, instruction);
             break;
         case 15:
-            stepTrap(state, instruction);
+            stepTrap(state, instruction, features);
             break;
     }
 }
 
-void emulate(LC3Context ctx, LC3EmulatorState *state) {
-    int currentCycle = 0;
+// Access control or a profile, check or model that has to see every instruction
+static inline int hasHooks(const LC3Context *ctx) {
+    return ctx->protect || ctx->pairProfile != NULL || ctx->callProfile != NULL || ctx->coverage != NULL || ctx->shadow != NULL ||
+           ctx->observer != NULL || ctx->timing != NULL;
+}
+
+// Runs the instruction at the pc past the access check and the hooks
+static inline __attribute__((always_inline)) void stepHooked(LC3Context *ctx, LC3EmulatorState *state, const int features) {
+    if (ctx->protect && checkAccess(state)) {
+        // Not executed, the run faults or the exception handler takes over
+        return;
+    }
+
+    if (ctx->pairProfile != NULL) {
+        pairProfileRecord(ctx->pairProfile, state->memory[state->pc].rawNumber);
+    }
+
+    if (ctx->coverage != NULL) {
+        coverageRecord(ctx->coverage, state->pc, state->memory[state->pc].rawNumber, state->cc);
+    }
+
+    if (ctx->shadow != NULL) {
+        shadowCheck(ctx->shadow, state, state->memory[state->pc].rawNumber);
+    }
+
+    if (ctx->observer != NULL) {
+        observeAccesses(ctx->observer, state);
+    }
+
+    if (ctx->timing != NULL) {
+        timingRecord(ctx->timing, state);
+    }
+
+    if (ctx->callProfile != NULL) {
+        unsigned short pc = state->pc;
+        unsigned short instruction = state->memory[pc].rawNumber;
+        stepInstruction(ctx, state, features);
+        callProfileRecord(ctx->callProfile, state, pc, instruction);
+    } else {
+        stepInstruction(ctx, state, features);
+    }
+}
+
+void step(LC3Context *ctx, LC3EmulatorState *state) {
+    // The loop detector confirms by stepping, the hooks see those instructions too
+    if (hasHooks(ctx)) {
+        stepHooked(ctx, state, anyFeatures(state));
+    } else {
+        stepInstruction(ctx, state, anyFeatures(state));
+    }
+}
+
+/*
+ * Superinstructions: frequent adjacent instructions (see --pair-profile) are dispatched as one handler.
+ *
+ * The kind of group starting at each address is decoded on first execution and kept in state->fusion
+ * until a store touches one of its words. Handlers run the same step functions back to back, so every
+ * register, cc and memory result is the one of the separate instructions, only the fetch and dispatch of
+ * the following ones is skipped. No group contains a trap or changes the pc before its last instruction.
+ * A group spans at most FUSION_WINDOW words.
+ */
+enum {
+    FUSION_UNKNOWN = 0,
+    FUSION_NONE,
+    FUSION_CLEAR_ADD,    // AND Rx, Rx, #0; ADD Rx, Rx, #imm
+    FUSION_ADD_BR,       // ADD; BR (loop counters)
+    FUSION_ADD_STR,      // ADD; STR (pushes such as ADD R6, R6, #-1; STR R7, R6, #0 in subroutine prologues)
+    FUSION_LDR_ADD_STR,  // LDR; ADD; STR (read-modify-write of a variable)
+    FUSION_COUNTED_LOOP, // A whole counted ADD loop, with --fast-loops
+    FUSION_BREAK,        // A debugger breakpoint, stops the run before the instruction
+};
+
+/*
+ * Counted loops: a loop head followed only by ADDs and a conditional back-edge to the head, such as
+ *
+ *     LOOP ADD R3, R3, R1   ; accumulators: A = A + invariant register or immediate, once per register
+ *          ADD R2, R2, #-1  ; the counter, stepped by an immediate right before the back-edge
+ *          BRp LOOP         ; BRp/BRzp when counting down, BRn/BRnz when counting up
+ *
+ * has no memory side effects, so the number of iterations follows from the counter alone and every
+ * register is stepped in closed form. The cycle count is the one of running all iterations.
+ */
+typedef struct CountedLoop {
+    unsigned short branch;  // Address of the back-edge
+    int length;             // Instructions per iteration, including the back-edge
+    unsigned short nzp;
+
+    unsigned short counter;
+    short counterStep;
+
+    int accumulatorCount;
+    unsigned short accumulators[FUSION_WINDOW];
+    int sources[FUSION_WINDOW];  // Register added every iteration, -1 for an immediate
+    short immediates[FUSION_WINDOW];
+} CountedLoop;
+
+static int recognizeCountedLoop(MemoryCell *memory, unsigned short head, CountedLoop *loop) {
+    unsigned short written = 0;  // Registers written by the loop
+    int addCount = 0;
+
+    for (int offset = 0; offset < FUSION_WINDOW; offset++) {
+        unsigned short address = head + offset;
+        unsigned short instruction = memory[address].rawNumber;
+        unsigned short opcode = getRaw(instruction, 12, 4);
+
+        if (opcode == 0) {
+            unsigned short nzp = getRaw(instruction, 9, 3);
+            if (addCount == 0 || (unsigned short)(address + 1 + getAsNumber(instruction, 0, 9)) != head) {
+                return 0;
+            }
+
+            // The counter is the last ADD, it sets the cc the back-edge tests
+            if (loop->sources[addCount - 1] != -1 || loop->immediates[addCount - 1] == 0) {
+                return 0;
+            }
+            loop->accumulatorCount = addCount - 1;
+            loop->counter = loop->accumulators[addCount - 1];
+            loop->counterStep = loop->immediates[addCount - 1];
+
+            int countsDown = loop->counterStep < 0 && (nzp == 1 || nzp == 3);
+            int countsUp = loop->counterStep > 0 && (nzp == 4 || nzp == 6);
+            if (!countsDown && !countsUp) {
+                return 0;
+            }
+
+            // Added registers must not change inside the loop
+            for (int i = 0; i < loop->accumulatorCount; i++) {
+                if (loop->sources[i] >= 0 && (written >> loop->sources[i]) & 1) {
+                    return 0;
+                }
+            }
+
+            loop->branch = address;
+            loop->length = addCount + 1;
+            loop->nzp = nzp;
+            return 1;
+        }
+
+        if (opcode != 1) {
+            return 0;
+        }
+
+        unsigned short dr = getRaw(instruction, 9, 3);
+        unsigned short sr1 = getRaw(instruction, 6, 3);
+        if ((written >> dr) & 1) {
+            return 0;
+        }
+        written |= 1 << dr;
+
+        loop->accumulators[addCount] = dr;
+        if (instruction & (1 << 5)) {
+            if (sr1 != dr) {
+                return 0;
+            }
+            loop->sources[addCount] = -1;
+            loop->immediates[addCount] = getAsNumber(instruction, 0, 5);
+        } else {
+            unsigned short sr2 = getRaw(instruction, 0, 3);
+            if (sr1 != dr && sr2 != dr) {
+                return 0;
+            }
+            loop->sources[addCount] = sr1 == dr ? sr2 : sr1;
+        }
+
+        addCount++;
+    }
+
+    return 0;
+}
+
+// Runs the iterations of the counted loop at the pc that fit in the budget (at least one), returns the number of
+// instructions retired
+static int runCountedLoop(LC3EmulatorState *state, unsigned long long budget) {
+    CountedLoop loop;
+    recognizeCountedLoop(state->memory, state->pc, &loop);
+
+    // The first iteration always runs, the counter does not wrap after it
+    short first = state->registers[loop.counter] + loop.counterStep;
+    int iterations = 1;
+    if (loop.counterStep < 0) {
+        int lowest = loop.nzp == 1 ? 1 : 0;  // BRp continues while the counter is at least 1, BRzp at least 0
+        if (first >= lowest) {
+            iterations = (first - lowest) / -loop.counterStep + 2;
+        }
+    } else {
+        int highest = loop.nzp == 4 ? -1 : 0;  // BRn continues while the counter is at most -1, BRnz at most 0
+        if (first <= highest) {
+            iterations = (highest - first) / loop.counterStep + 2;
+        }
+    }
+
+    // Cut short by the cycle limit the loop stays on its head, the stepped path runs what is left
+    int finished = 1;
+    if ((unsigned long long)iterations * loop.length > budget) {
+        iterations = budget / loop.length;
+        finished = 0;
+    }
+
+    for (int i = 0; i < loop.accumulatorCount; i++) {
+        unsigned short added = loop.sources[i] >= 0 ? state->registers[loop.sources[i]] : loop.immediates[i];
+        unsigned short *accumulator = (unsigned short *)&state->registers[loop.accumulators[i]];
+        *accumulator += (unsigned int)iterations * added;
+    }
+
+    short counter = (unsigned short)state->registers[loop.counter] + (unsigned int)iterations * (unsigned short)loop.counterStep;
+    state->registers[loop.counter] = counter;
+    state->cc = counter == 0 ? 2 : counter < 0 ? 4
+                                               : 1;
+    state->pc = finished ? loop.branch + 1 : state->pc;
+
+    return iterations * loop.length;
+}
+
+static unsigned char decodeGroup(LC3Context *ctx, MemoryCell *memory, unsigned short pc) {
+    unsigned short first = memory[pc].rawNumber;
+    unsigned short second = memory[(unsigned short)(pc + 1)].rawNumber;
+    unsigned short third = memory[(unsigned short)(pc + 2)].rawNumber;
+
+    unsigned short firstOpcode = getRaw(first, 12, 4);
+    unsigned short secondOpcode = getRaw(second, 12, 4);
+    unsigned short thirdOpcode = getRaw(third, 12, 4);
+
+    CountedLoop loop;
+    if (ctx->fastLoops && recognizeCountedLoop(memory, pc, &loop)) {
+        return FUSION_COUNTED_LOOP;
+    }
+
+    if (firstOpcode == 6 && secondOpcode == 1 && thirdOpcode == 7) {
+        return FUSION_LDR_ADD_STR;
+    }
+
+    if (firstOpcode == 5 && secondOpcode == 1 && (first & (1 << 5)) && getRaw(first, 0, 5) == 0 && (second & (1 << 5)) &&
+        getRaw(first, 9, 3) == getRaw(second, 9, 3) && getRaw(second, 9, 3) == getRaw(second, 6, 3)) {
+        return FUSION_CLEAR_ADD;
+    }
+
+    if (firstOpcode == 1 && secondOpcode == 0) {
+        return FUSION_ADD_BR;
+    }
+
+    if (firstOpcode == 1 && secondOpcode == 7) {
+        return FUSION_ADD_STR;
+    }
+
+    return FUSION_NONE;
+}
+
+// Words executed by a group of the given kind starting at the pc
+static int groupLength(unsigned char kind, MemoryCell *memory, unsigned short pc) {
+    CountedLoop loop;
+    switch (kind) {
+        case FUSION_CLEAR_ADD:
+        case FUSION_ADD_BR:
+        case FUSION_ADD_STR:
+            return 2;
+        case FUSION_LDR_ADD_STR:
+            return 3;
+        case FUSION_COUNTED_LOOP:
+            recognizeCountedLoop(memory, pc, &loop);
+            return loop.length;
+        default:
+            return 1;
+    }
+}
+
+static unsigned char decodeFusion(LC3Context *ctx, MemoryCell *memory, unsigned short pc) {
+    if (ctx->debugger == NULL) {
+        return decodeGroup(ctx, memory, pc);
+    }
+
+    // Breakpoints are only looked up here, a group never runs over one (nor loops back to it)
+    if (debuggerHasBreakpoint(ctx->debugger, pc)) {
+        return FUSION_BREAK;
+    }
+
+    unsigned char kind = decodeGroup(ctx, memory, pc);
+    int length = groupLength(kind, memory, pc);
+    for (int i = 1; i < length; i++) {
+        if (debuggerHasBreakpoint(ctx->debugger, pc + i)) {
+            return FUSION_NONE;
+        }
+    }
+
+    return kind;
+}
+
+// Cycles left before the limit, unbounded without one
+static inline unsigned long long remainingCycles(LC3Context *ctx, unsigned long long currentCycle) {
+    if (ctx->maxCycleCount <= 0) {
+        return ULLONG_MAX;
+    }
+
+    unsigned long long limit = ctx->maxCycleCount;
+    return currentCycle < limit ? limit - currentCycle : 0;
+}
+
+// Runs the group (or single instruction) at the pc, returns the number of instructions retired
+static inline int stepFused(LC3Context *ctx, LC3EmulatorState *state, unsigned long long currentCycle, const int features) {
+    unsigned short pc = state->pc;
+    unsigned char kind = state->fusion[pc];
+    if (kind == FUSION_UNKNOWN) {
+        kind = decodeFusion(ctx, state->memory, pc);
+        state->fusion[pc] = kind;
+    }
+
+    MemoryCell *memory = state->memory;
+
+    // A group that would cross the cycle limit is stepped, so the run stops on the same instruction
+    unsigned long long budget = ULLONG_MAX;
+    if (features & EMULATE_LIMIT) {
+        budget = remainingCycles(ctx, currentCycle);
+        if (kind != FUSION_BREAK && budget < (unsigned long long)groupLength(kind, memory, pc)) {
+            kind = FUSION_NONE;
+        }
+    }
+
+    unsigned short first = memory[pc].rawNumber;
+    unsigned short second = memory[(unsigned short)(pc + 1)].rawNumber;
+
+    switch (kind) {
+        case FUSION_CLEAR_ADD: {
+            short result = getAsNumber(second, 0, 5);
+            state->registers[getRaw(second, 9, 3)] = result;
+            state->cc = result == 0 ? 2 : result < 0 ? 4
+                                                     : 1;
+            state->pc = pc + 2;
+            return 2;
+        }
+        case FUSION_ADD_BR:
+            state->pc = pc + 2;
+            stepAdd(state, first);
+            stepBr(state, second);
+            return 2;
+        case FUSION_ADD_STR:
+            state->pc = pc + 2;
+            stepAdd(state, first);
+            stepStr(state, second, features);
+            return 2;
+        case FUSION_LDR_ADD_STR:
+            state->pc = pc + 3;
+            stepLdr(state, first);
+            stepAdd(state, second);
+            stepStr(state, memory[(unsigned short)(pc + 2)].rawNumber, features);
+            return 3;
+        case FUSION_COUNTED_LOOP:
+            return runCountedLoop(state, budget);
+        case FUSION_BREAK:
+            // Ends the loop in emulate() like a halt, nothing is executed
+            state->haltSignal = LC3_BREAK_SIGNAL;
+            return 0;
+        default:
+            stepInstruction(ctx, state, features);
+            return 1;
+    }
+}
+
+void emulatorWriteMemory(LC3EmulatorState *state, unsigned short address, short value) {
+    writeMemory(state, address, value, anyFeatures(state));
+}
+
+void printBenchmarkReport(LC3EmulatorState *state) {
+    printf("\n===========\nExecution took %llu cycles.\n===========\n", state->cycleCount);
+}
+
+void printFault(const LC3EmulatorState *state, FILE *stream) {
+    switch (state->fault) {
+        case LC3_FAULT_RTI:
+            fprintf(stream, "RTI encountered!\n");
+            break;
+        case LC3_FAULT_RESERVED_OPCODE:
+            fprintf(stream, "Reserved opcode encountered!\n");
+            break;
+        case LC3_FAULT_END_OF_INPUT:
+            fprintf(stream, "\n\nGETC called after end of input!\n");
+            break;
+        case LC3_FAULT_ACCESS_VIOLATION: {
+            unsigned short pc = state->pc - 1;
+            const LC3Symbol *symbol = state->image != NULL ? imageSymbolAt(state->image, pc) : NULL;
+            fprintf(stream, "Access control violation: ");
+            printHexInstruction(stream, state->memory[pc].rawNumber);
+            fprintf(stream, " at x%04x", pc);
+            if (symbol != NULL && symbol->address == pc) {
+                fprintf(stream, " (%s)", symbol->name);
+            } else if (symbol != NULL) {
+                fprintf(stream, " (%s+%d)", symbol->name, pc - symbol->address);
+            }
+            fprintf(stream, " %s system space at x%04x\n", state->faultAddress == pc ? "runs in" : "accesses", state->faultAddress);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+int exitStatus(const LC3EmulatorState *state) {
+    if (state->haltSignal == LC3_STOP_SIGNAL) {
+        return state->loop.detected ? LOOP_EXIT_CODE : LC3_CYCLE_LIMIT_EXIT_CODE;
+    }
+    return state->fault != LC3_FAULT_NONE;
+}
+
+void printStop(const LC3Context *ctx, const LC3EmulatorState *state, FILE *stream) {
+    if (state->haltSignal == LC3_STOP_SIGNAL && state->loop.detected) {
+        printLoopReport(state, stream);
+    } else if (state->haltSignal == LC3_STOP_SIGNAL) {
+        fprintf(stream, "Exceeded maximum cycle count of %d\n", ctx->maxCycleCount);
+    } else {
+        printFault(state, stream);
+    }
+}
+
+void exitOnStop(const LC3Context *ctx, const LC3EmulatorState *state) {
+    int status = exitStatus(state);
+    if (status == 0) {
+        return;
+    }
+
+    printStop(ctx, state, stderr);
+    exit(status);
+}
+
+// Ends the run at the cycle limit, unless a fault ended it first
+static inline void stopAtLimit(LC3EmulatorState *state) {
+    if (state->haltSignal != LC3_FAULT_SIGNAL) {
+        state->haltSignal = LC3_STOP_SIGNAL;
+    }
+}
+
+// Cycle of the next loop detector sample, time travel checkpoint or timer tick, whichever comes first
+static unsigned long long nextEventCycle(LC3Context *ctx, LC3EmulatorState *state) {
+    unsigned long long next = ULLONG_MAX;
+    if (ctx->detectLoops) {
+        next = state->loop.nextSample;
+    }
+
+    if (state->interrupts.enabled && state->interrupts.nextTick < next) {
+        next = state->interrupts.nextTick;
+    }
+
+    if (ctx->debugger != NULL && ctx->debugger->timeTravel != NULL && ctx->debugger->timeTravel->nextCheckpoint < next) {
+        next = ctx->debugger->timeTravel->nextCheckpoint;
+    }
+
+    return next;
+}
+
+// Takes the interrupt, time travel checkpoint and loop detector sample that are due, returns the cycle count
+static unsigned long long runEvents(LC3Context *ctx, LC3EmulatorState *state, unsigned long long currentCycle) {
+    if (state->interrupts.enabled) {
+        interruptsRun(state, currentCycle);
+    }
+
+    TimeTravel *travel = ctx->debugger != NULL ? ctx->debugger->timeTravel : NULL;
+    if (travel != NULL && currentCycle >= travel->nextCheckpoint) {
+        timeTravelCheckpoint(travel, state, currentCycle);
+    }
+
+    if (ctx->detectLoops && currentCycle >= state->loop.nextSample && loopDetectorSample(state, currentCycle)) {
+        // Confirming never runs past the cycle limit, which is checked after it as usual
+        unsigned long long executed = 0;
+        int stuck = loopDetectorConfirm(ctx, state, currentCycle, remainingCycles(ctx, currentCycle), &executed);
+        currentCycle += executed;
 
+        if (stuck) {
+            state->haltSignal = LC3_STOP_SIGNAL;
+        }
+    }
+
+    return currentCycle;
+}
+
+// Runs until the halt signal is set, returns the cycle count
+static inline __attribute__((always_inline)) unsigned long long runLoop(LC3Context *ctx, LC3EmulatorState *state,
+                                                                        unsigned long long currentCycle, const int features) {
     while (!state->haltSignal) {
-        if (ctx.debugMode) {
+        if (features & EMULATE_TRACE) {
             printState(state);
         }
 
-        step(&ctx, state);
-        currentCycle++;
+        if ((features & EMULATE_DISPATCH) == EMULATE_FUSED) {
+            currentCycle += stepFused(ctx, state, currentCycle, features);
+        } else if ((features & EMULATE_DISPATCH) == EMULATE_MEMOIZED) {
+            currentCycle += memoStep(ctx->memo, ctx, state, remainingCycles(ctx, currentCycle));
+        } else if (features & EMULATE_HOOKS) {
+            stepHooked(ctx, state, features);
+            currentCycle++;
+        } else {
+            stepInstruction(ctx, state, features);
+            currentCycle++;
+        }
+
+        if ((features & EMULATE_EVENTS) && currentCycle >= state->nextEvent && !state->haltSignal) {
+            currentCycle = runEvents(ctx, state, currentCycle);
+            state->nextEvent = nextEventCycle(ctx, state);
+        }
 
-        if (ctx.maxCycleCount > 0 && currentCycle >= ctx.maxCycleCount) {
-            fprintf(stderr, "Exceeded maximum cycle count of %d\n", ctx.maxCycleCount);
-            exit(99);
+        if ((features & EMULATE_LIMIT) && currentCycle >= (unsigned long long)ctx->maxCycleCount) {
+            stopAtLimit(state);
         }
     }
 
-    if (ctx.benchmarkMode) {
-        printf("\n===========\nExecution took %d cycles.\n===========\n", currentCycle);
+    return currentCycle;
+}
+
+typedef unsigned long long (*EmulateLoop)(LC3Context *ctx, LC3EmulatorState *state, unsigned long long currentCycle);
+
+#define EMULATE_VARIANT(features)                                                                                            \
+    static unsigned long long runLoop##features(LC3Context *ctx, LC3EmulatorState *state, unsigned long long currentCycle) { \
+        return runLoop(ctx, state, currentCycle, features);                                                                  \
+    }
+
+// Every dispatch with and without the limit and events, tracing and hooks only exist for stepping
+#define EMULATE_VARIANTS(X)    \
+    X(0) X(8) X(16) X(24)      \
+    X(1) X(9) X(17) X(25)      \
+    X(2) X(10) X(18) X(26)     \
+    X(6) X(14) X(22) X(30)     \
+    X(34) X(42) X(50) X(58)    \
+    X(38) X(46) X(54) X(62)
+
+EMULATE_VARIANTS(EMULATE_VARIANT)
+
+#define EMULATE_ENTRY(features) [features] = runLoop##features,
+static const EmulateLoop emulateLoops[64] = {EMULATE_VARIANTS(EMULATE_ENTRY)};
+
+void emulate(LC3Context ctx, LC3EmulatorState *state) {
+    unsigned long long currentCycle = 0;
+
+    // Fusion is skipped when every instruction has to be seen on its own, or when other cores may store over
+    // the code (the fused groups are decoded per core)
+    int hooks = hasHooks(&ctx);
+    int fuse = ctx.cores <= 1 && !ctx.debugMode && !hooks && ctx.memo == NULL;
+    int memoize = !ctx.debugMode && ctx.memo != NULL;
+    state->fusion = fuse ? calloc(65536, sizeof(unsigned char)) : NULL;
+
+    if (ctx.pairProfile != NULL) {
+        pairProfileReset(ctx.pairProfile);
+    }
+
+    if (ctx.callProfile != NULL) {
+        callProfileBegin(ctx.callProfile, state);
+    }
+
+    if (ctx.coverage != NULL) {
+        coverageBegin(ctx.coverage, state);
+    }
+
+    if (ctx.detectLoops) {
+        loopDetectorStart(state, 0);
+    }
+
+    if (memoize) {
+        memoBeginRun(ctx.memo, state);
+    }
+
+    // The debugger takes over before the first instruction
+    if (ctx.debugger != NULL) {
+        state->haltSignal = LC3_BREAK_SIGNAL;
+    }
+
+    // With interrupts the timer registers are read after the first dispatch
+    state->nextEvent = state->interrupts.enabled ? 0 : nextEventCycle(&ctx, state);
+
+    int features = fuse ? EMULATE_FUSED : memoize ? EMULATE_MEMOIZED
+                                                  : EMULATE_STEPPED;
+    if (features == EMULATE_STEPPED && hooks) {
+        features |= EMULATE_HOOKS;
+    }
+    if (ctx.debugMode) {
+        features |= EMULATE_TRACE;
+    }
+    if (ctx.maxCycleCount > 0) {
+        features |= EMULATE_LIMIT;
+    }
+    if (ctx.detectLoops || (ctx.debugger != NULL && ctx.debugger->timeTravel != NULL) || state->interrupts.enabled) {
+        features |= EMULATE_EVENTS;
+    }
+    EmulateLoop loop = emulateLoops[features];
+
+    if (ctx.hostCounters != NULL) {
+        hostCountersStart(ctx.hostCounters);
+    }
+
+    for (;;) {
+        currentCycle = loop(&ctx, state, currentCycle);
+
+        // A breakpoint ends the loop like a halt, the debugger then resumes the run
+        if (state->haltSignal != LC3_BREAK_SIGNAL) {
+            break;
+        }
+
+        currentCycle = debuggerStop(ctx.debugger, &ctx, state, currentCycle);
+        state->nextEvent = nextEventCycle(&ctx, state);
+        if (ctx.maxCycleCount > 0 && currentCycle >= (unsigned long long)ctx.maxCycleCount && !state->haltSignal) {
+            stopAtLimit(state);
+        }
+    }
+
+    if (ctx.hostCounters != NULL) {
+        hostCountersStop(ctx.hostCounters, currentCycle);
+    }
+
+    if (ctx.debugger != NULL) {
+        debuggerExited(ctx.debugger, exitStatus(state));
+    }
+
+    if (ctx.callProfile != NULL) {
+        callProfileEnd(ctx.callProfile);
+    }
+
+    free(state->fusion);
+    state->fusion = NULL;
+    state->loop.enabled = 0;
+
+    state->cycleCount = currentCycle;
+
+    // A stopped or faulted run only reports why
+    if (ctx.benchmarkMode && state->haltSignal != LC3_STOP_SIGNAL && state->fault == LC3_FAULT_NONE) {
+        printBenchmarkReport(state);
     }
 }
 
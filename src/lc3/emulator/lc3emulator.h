@@ -1,6 +1,9 @@
 #ifndef LC3_EMULATOR
 #define LC3_EMULATOR
 
+#include <stddef.h>
+#include <stdio.h>
+
 #include "../context/lc3context.h"
 
 typedef union {
@@ -8,15 +11,123 @@ typedef union {
     unsigned short rawNumber;
 } MemoryCell;
 
+// Memory is tracked in pages of 256 words for cheap resets between runs
+#define LC3_PAGE_SHIFT 8
+#define LC3_PAGE_SIZE (1 << LC3_PAGE_SHIFT)
+#define LC3_PAGE_COUNT (65536 >> LC3_PAGE_SHIFT)
+
+typedef struct LC3Image LC3Image;
+
+typedef struct LC3IO {
+    const unsigned char *input;  // Buffered input for GETC/IN, NULL to read stdin directly
+    size_t inputLength;
+    size_t inputPosition;  // Also counts the characters read from stdin
+
+    int logInput;  // When set, characters read from stdin are kept so a rewound run reads them again
+    unsigned char *inputLog;
+    size_t inputLogLength;
+    size_t inputLogCapacity;
+
+    int captureOutput;   // When set, everything written to stdout is also appended to output
+    int suppressStdout;  // When set, output is only captured
+    char *output;
+    size_t outputLength;
+    size_t outputCapacity;
+} LC3IO;
+
+// Stuck-state detection (see lc3loop.h), kept in the state so stores can update the memory digest
+typedef struct LC3LoopDetector {
+    int enabled;
+    unsigned long long memoryDigest;  // Digest of every word changed during the run, independent of store order
+
+    unsigned long long nextSample;  // Cycle of the next state hash
+    unsigned long long savedHash;   // Brent's cycle detection over the sampled states
+    unsigned long long savedCycle;
+    unsigned long long power;
+    unsigned long long samplesSinceSaved;
+
+    int detected;
+    unsigned short lowPc;
+    unsigned short highPc;
+    unsigned long long period;  // Cycles after which the whole state repeats
+} LC3LoopDetector;
+
+// Privilege, exceptions and the timer (see lc3interrupt.h), used with --interrupts
+typedef struct LC3Interrupts {
+    int enabled;
+    unsigned short psr;       // Privilege and priority, the condition codes are kept in cc
+    unsigned short savedSsp;  // R6 of the stack not in use
+    unsigned short savedUsp;
+
+    unsigned short interval;      // Timer interval the registers were last seen with
+    unsigned long long nextTick;  // Cycle of the next timer tick, ULLONG_MAX when stopped
+} LC3Interrupts;
+
+// haltSignal while the debugger has stopped the run, a halted program sets it to 1
+#define LC3_BREAK_SIGNAL 2
+
+// haltSignal of a run stopped by a fault, the instruction that caused it has been fetched (the pc is past it)
+#define LC3_FAULT_SIGNAL 3
+
+// haltSignal of a run stopped by the cycle limit, or by the loop detector when loop.detected is set
+#define LC3_STOP_SIGNAL 4
+
+// Exit code of a run past the cycle limit, the loop detector uses LOOP_EXIT_CODE
+#define LC3_CYCLE_LIMIT_EXIT_CODE 99
+
+typedef enum {
+    LC3_FAULT_NONE,
+    LC3_FAULT_RTI,
+    LC3_FAULT_RESERVED_OPCODE,
+    LC3_FAULT_END_OF_INPUT,  // GETC with no input left
+    LC3_FAULT_ACCESS_VIOLATION,  // User code touched system space (see lc3protect.h), at faultAddress
+} LC3Fault;
+
 typedef struct LC3EmulatorState {
     short registers[8];
     unsigned short pc;
     unsigned short cc;
     MemoryCell *memory;
     unsigned short haltSignal;
+    LC3Fault fault;
+    unsigned short faultAddress;
+
+    LC3Image *image;  // The assembled image (with symbols), NULL when loaded from a .bin
+
+    LC3IO io;
+    unsigned long long cycleCount;  // Set by emulate()
+    unsigned long long nextEvent;   // Cycle at which emulate() next handles events, cleared to force it at the next dispatch
+
+    unsigned long long dirtyPages[LC3_PAGE_COUNT / 64];  // 1 bit per page written since the last snapshot
+
+    unsigned char *fusion;  // Fused dispatch kind per address while emulate() runs, NULL otherwise
+
+    unsigned short core;       // Number of the core with --cores (see lc3multicore.h)
+    unsigned short coreCount;  // 0 on a single core
+
+    LC3LoopDetector loop;
+    LC3Interrupts interrupts;
 } LC3EmulatorState;
 
+static inline void markPageDirty(LC3EmulatorState *state, unsigned short address) {
+    unsigned int page = address >> LC3_PAGE_SHIFT;
+    state->dirtyPages[page >> 6] |= 1ULL << (page & 63);
+}
+
+void step(LC3Context *ctx, LC3EmulatorState *state);
 void emulate(LC3Context ctx, LC3EmulatorState *state);
+void printBenchmarkReport(LC3EmulatorState *state);
+void printHexInstruction(FILE *stream, unsigned short instruction);
+
+// emulate() returns after a fault or a stop, single runs report it (if any) and exit with its status:
+// 1 after a fault, LOOP_EXIT_CODE or LC3_CYCLE_LIMIT_EXIT_CODE. Batches report it with the case.
+void exitOnStop(const LC3Context *ctx, const LC3EmulatorState *state);
+int exitStatus(const LC3EmulatorState *state);
+void printStop(const LC3Context *ctx, const LC3EmulatorState *state, FILE *stream);
+void printFault(const LC3EmulatorState *state, FILE *stream);
+
+// Writes memory from outside the emulator (expectations, cached verdicts) so the page is tracked as dirty
+void emulatorWriteMemory(LC3EmulatorState *state, unsigned short address, short value);
 
 void dumpToFile(LC3EmulatorState *state, FILE *output);
 LC3EmulatorState loadFromFile(FILE *input);
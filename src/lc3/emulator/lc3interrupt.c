@@ -0,0 +1,82 @@
+#include "lc3interrupt.h"
+
+#include <limits.h>
+
+void interruptsEnable(LC3EmulatorState *state) {
+    state->interrupts = (LC3Interrupts){0};
+    state->interrupts.enabled = 1;
+    state->interrupts.savedSsp = LC3_SUPERVISOR_STACK;
+    state->interrupts.savedUsp = LC3_USER_STACK;
+    state->interrupts.nextTick = ULLONG_MAX;
+}
+
+static void push(LC3EmulatorState *state, unsigned short value) {
+    state->registers[6]--;
+    emulatorWriteMemory(state, state->registers[6], value);
+}
+
+static unsigned short pop(LC3EmulatorState *state) {
+    unsigned short value = state->memory[(unsigned short)state->registers[6]].rawNumber;
+    state->registers[6]++;
+    return value;
+}
+
+void interruptEnter(LC3EmulatorState *state, unsigned char vector, int priority) {
+    LC3Interrupts *interrupts = &state->interrupts;
+    unsigned short psr = interrupts->psr | state->cc;
+
+    if (psr & LC3_PSR_USER) {
+        interrupts->savedUsp = state->registers[6];
+        state->registers[6] = interrupts->savedSsp;
+    }
+
+    push(state, psr);
+    push(state, state->pc);
+
+    interrupts->psr = priority >= 0 ? priority << 8 : psr & LC3_PSR_PRIORITY;
+    state->pc = state->memory[LC3_VECTOR_TABLE + vector].rawNumber;
+}
+
+void interruptReturn(LC3EmulatorState *state) {
+    LC3Interrupts *interrupts = &state->interrupts;
+    if (interrupts->psr & LC3_PSR_USER) {
+        interruptEnter(state, LC3_VECTOR_PRIVILEGE, -1);
+        return;
+    }
+
+    state->pc = pop(state);
+    unsigned short psr = pop(state);
+    interrupts->psr = psr & (LC3_PSR_USER | LC3_PSR_PRIORITY);
+    state->cc = psr & 7;
+
+    if (psr & LC3_PSR_USER) {
+        interrupts->savedSsp = state->registers[6];
+        state->registers[6] = interrupts->savedUsp;
+    }
+
+    // The lower priority may let a waiting interrupt in
+    state->nextEvent = 0;
+}
+
+void interruptsRun(LC3EmulatorState *state, unsigned long long cycle) {
+    LC3Interrupts *interrupts = &state->interrupts;
+
+    // A new interval restarts the timer
+    unsigned short interval = state->memory[LC3_TIR].rawNumber;
+    if (interval != interrupts->interval) {
+        interrupts->interval = interval;
+        interrupts->nextTick = interval != 0 ? cycle + interval : ULLONG_MAX;
+    }
+
+    // Ticks missed inside a long dispatch are one tick
+    if (cycle >= interrupts->nextTick) {
+        emulatorWriteMemory(state, LC3_TSR, state->memory[LC3_TSR].rawNumber | 0x8000);
+        interrupts->nextTick = cycle + interval - (cycle - interrupts->nextTick) % interval;
+    }
+
+    unsigned short tsr = state->memory[LC3_TSR].rawNumber;
+    int priority = (interrupts->psr & LC3_PSR_PRIORITY) >> 8;
+    if ((tsr & 0x8000) && (tsr & 0x4000) && LC3_TIMER_PRIORITY > priority) {
+        interruptEnter(state, LC3_VECTOR_TIMER, LC3_TIMER_PRIORITY);
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef LC3_INTERRUPT_H
+#define LC3_INTERRUPT_H
+
+#include "lc3emulator.h"
+
+/*
+ * LC-3 privilege, exceptions and interrupts (--interrupts).
+ *
+ * The PSR holds the privilege (bit 15, set in user mode), the priority (bits 10-8) and the condition
+ * codes (bits 2-0, kept in state->cc). Entering a handler switches to the supervisor stack when coming
+ * from user mode (saving R6 as the USP), pushes the PSR and the pc, and jumps through the vector table
+ * at x0100-x01FF. RTI pops them back, and returns to the user stack when the popped PSR is user mode.
+ *
+ * Exceptions are raised by the instruction that causes them and keep the priority: RTI in user mode
+ * (vector x00) and the reserved opcode (vector x01). The timer requests an interrupt at vector x81 and
+ * priority 1 while its ready bit and interrupt enable bit are both set, like the keyboard does on the
+ * real machine, so the handler has to clear the ready bit before returning.
+ *
+ * Interrupts are only looked at between dispatches of emulate() (see EMULATE_EVENTS): when the timer
+ * ticks, and after a store to a device register or an RTI forced a check by clearing state->nextEvent.
+ * Programs run without --interrupts test nothing for it.
+ */
+#define LC3_PSR_USER 0x8000
+#define LC3_PSR_PRIORITY 0x0700
+
+#define LC3_VECTOR_TABLE 0x0100
+#define LC3_VECTOR_PRIVILEGE 0x00
+#define LC3_VECTOR_ILLEGAL_OPCODE 0x01
+#define LC3_VECTOR_TIMER 0x81
+#define LC3_TIMER_PRIORITY 1
+
+// Device registers
+#define LC3_DEVICE_BASE 0xFE00
+#define LC3_TSR 0xFE08  // Timer status: bit 15 ready (set by every tick), bit 14 interrupt enable
+#define LC3_TIR 0xFE0A  // Timer interval in cycles, 0 stops the timer
+
+#define LC3_SUPERVISOR_STACK 0x3000  // Initial SSP, the supervisor stack grows down from the user program
+#define LC3_USER_STACK 0xFE00        // Initial USP
+
+// Starts the machine in supervisor mode at priority 0, with the timer stopped
+void interruptsEnable(LC3EmulatorState *state);
+
+// Enters the handler of the vector, priority -1 keeps the current one (exceptions)
+void interruptEnter(LC3EmulatorState *state, unsigned char vector, int priority);
+
+// RTI, raises the privilege exception in user mode
+void interruptReturn(LC3EmulatorState *state);
+
+// Called when cycle reaches state->nextEvent: follows the timer registers, ticks and takes a requested interrupt
+void interruptsRun(LC3EmulatorState *state, unsigned long long cycle);
+
+#endif // LC3_INTERRUPT_H
@@ -0,0 +1,102 @@
+#include "lc3loop.h"
+
+#include <string.h>
+
+#include "../../hash/hash.h"
+
+static Hash64 hashLoopState(LC3EmulatorState *state) {
+    Hash64 hash = HASH64_INITIAL;
+    hash = hashBytes(hash, state->registers, sizeof(state->registers));
+    hash = hashInt(hash, state->pc);
+    hash = hashInt(hash, state->cc);
+    hash = hashInt(hash, state->io.inputPosition);
+    hash = hashBytes(hash, &state->loop.memoryDigest, sizeof(state->loop.memoryDigest));
+    return hash;
+}
+
+void loopDetectorStart(LC3EmulatorState *state, unsigned long long cycle) {
+    state->loop = (LC3LoopDetector){0};
+    state->loop.enabled = 1;
+    state->loop.power = 1;
+    state->loop.savedHash = hashLoopState(state);
+    state->loop.savedCycle = cycle;
+    state->loop.nextSample = cycle + LOOP_SAMPLE_INTERVAL;
+}
+
+int loopDetectorSample(LC3EmulatorState *state, unsigned long long cycle) {
+    LC3LoopDetector *loop = &state->loop;
+    Hash64 hash = hashLoopState(state);
+    loop->nextSample = cycle + LOOP_SAMPLE_INTERVAL;
+
+    if (hash == loop->savedHash) {
+        return 1;
+    }
+
+    // Brent: move the saved sample forward whenever the distance to it reaches the next power of two
+    loop->samplesSinceSaved++;
+    if (loop->samplesSinceSaved == loop->power) {
+        loop->savedHash = hash;
+        loop->savedCycle = cycle;
+        loop->power *= 2;
+        loop->samplesSinceSaved = 0;
+    }
+
+    return 0;
+}
+
+int loopDetectorConfirm(LC3Context *ctx, LC3EmulatorState *state, unsigned long long cycle, unsigned long long budget,
+                        unsigned long long *executed) {
+    LC3LoopDetector *loop = &state->loop;
+
+    // The saved sample had the same hash, so a real loop repeats within the distance to it
+    unsigned long long maxCycles = cycle - loop->savedCycle;
+    if (maxCycles > budget) {
+        maxCycles = budget;
+    }
+
+    short registers[8];
+    memcpy(registers, state->registers, sizeof(registers));
+    unsigned short pc = state->pc;
+    unsigned short cc = state->cc;
+    size_t inputPosition = state->io.inputPosition;
+    unsigned long long memoryDigest = loop->memoryDigest;
+
+    unsigned short lowPc = pc;
+    unsigned short highPc = pc;
+    unsigned long long cycles = 0;
+
+    while (!state->haltSignal && cycles < maxCycles) {
+        step(ctx, state);
+        cycles++;
+
+        if (state->pc == pc && state->cc == cc && state->io.inputPosition == inputPosition &&
+            loop->memoryDigest == memoryDigest && memcmp(state->registers, registers, sizeof(registers)) == 0) {
+            loop->detected = 1;
+            loop->lowPc = lowPc;
+            loop->highPc = highPc;
+            loop->period = cycles;
+            break;
+        }
+
+        lowPc = state->pc < lowPc ? state->pc : lowPc;
+        highPc = state->pc > highPc ? state->pc : highPc;
+    }
+
+    *executed += cycles;
+
+    if (!loop->detected) {
+        // A hash collision (or the budget ran out), start over from here
+        loop->savedHash = hashLoopState(state);
+        loop->savedCycle = cycle + cycles;
+        loop->power = 1;
+        loop->samplesSinceSaved = 0;
+        loop->nextSample = cycle + cycles + LOOP_SAMPLE_INTERVAL;
+    }
+
+    return loop->detected;
+}
+
+void printLoopReport(const LC3EmulatorState *state, FILE *stream) {
+    fprintf(stream, "Infinite loop detected in x%04x-x%04x, the state repeats every %llu cycles\n", state->loop.lowPc,
+            state->loop.highPc, state->loop.period);
+}
@@ -0,0 +1,41 @@
+#ifndef LC3_LOOP_H
+#define LC3_LOOP_H
+
+#include <stdio.h>
+
+#include "../context/lc3context.h"
+#include "lc3emulator.h"
+
+/*
+ * Stuck-state detection.
+ *
+ * Every LOOP_SAMPLE_INTERVAL cycles the registers, pc, cc, input position and a digest of the written
+ * memory are hashed, and Brent's algorithm looks for a repeated hash. Self-branches and tight loops
+ * without stores repeat their whole state every iteration, so they are caught within a few samples;
+ * longer loops are caught once their period has been sampled twice.
+ *
+ * A repeated hash is then confirmed by stepping until the exact state comes back, which also measures
+ * the period and the pc range of the loop. A run that reads input or changes memory every iteration
+ * never repeats, and is left to the cycle limit.
+ */
+#define LOOP_SAMPLE_INTERVAL 1024
+
+// Exit code of a run ended by the detector, the cycle limit uses 99
+#define LOOP_EXIT_CODE 98
+
+void loopDetectorStart(LC3EmulatorState *state, unsigned long long cycle);
+
+// Called when cycle reaches state->loop.nextSample, returns 1 when the sampled state was seen before
+int loopDetectorSample(LC3EmulatorState *state, unsigned long long cycle);
+
+/*
+ * Steps from a repeated sample until the state repeats exactly, within the budget of remaining cycles.
+ * Returns 1 and fills in the period and pc range when confirmed, otherwise detection carries on.
+ * The number of instructions stepped is added to executed.
+ */
+int loopDetectorConfirm(LC3Context *ctx, LC3EmulatorState *state, unsigned long long cycle, unsigned long long budget,
+                        unsigned long long *executed);
+
+void printLoopReport(const LC3EmulatorState *state, FILE *stream);
+
+#endif // LC3_LOOP_H
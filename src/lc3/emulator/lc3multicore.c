@@ -0,0 +1,113 @@
+#include "lc3multicore.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Every instruction writes the registers of its core, the padding keeps two cores off one host cache line
+typedef struct LC3Core {
+    LC3EmulatorState state;
+    LC3Context context;
+    pthread_t thread;
+    unsigned char padding[64];
+} LC3Core;
+
+static void *runFree(void *argument) {
+    LC3Core *core = argument;
+    emulate(core->context, &core->state);
+    return NULL;
+}
+
+static void runInterleaved(LC3Context context, LC3Core *cores, int count) {
+    int running = count;
+    while (running > 0) {
+        running = 0;
+
+        for (int i = 0; i < count; i++) {
+            LC3EmulatorState *state = &cores[i].state;
+            for (int n = 0; n < context.interleave && !state->haltSignal; n++) {
+                step(&context, state);
+                state->cycleCount++;
+
+                // Stops this core like emulate() would, the others go on
+                if (context.maxCycleCount > 0 && state->cycleCount >= (unsigned long long)context.maxCycleCount &&
+                    state->haltSignal != LC3_FAULT_SIGNAL) {
+                    state->haltSignal = LC3_STOP_SIGNAL;
+                }
+            }
+
+            if (!state->haltSignal) {
+                running++;
+            }
+        }
+    }
+}
+
+static void printCoreReport(const LC3Core *cores, int count) {
+    unsigned long long longest = 0;
+
+    printf("\n===========\n");
+    for (int i = 0; i < count; i++) {
+        printf("Core %d took %llu cycles.\n", i, cores[i].state.cycleCount);
+        if (cores[i].state.cycleCount > longest) {
+            longest = cores[i].state.cycleCount;
+        }
+    }
+    printf("Execution took %llu cycles on %d cores.\n===========\n", longest, count);
+}
+
+void runCores(LC3Context context, LC3EmulatorState *boot) {
+    int count = context.cores;
+    LC3Core *cores = calloc(count, sizeof(LC3Core));
+
+    // The cycles are reported per core
+    LC3Context coreContext = context;
+    coreContext.benchmarkMode = 0;
+
+    for (int i = 0; i < count; i++) {
+        cores[i].state = *boot;
+        cores[i].state.core = i;
+        cores[i].state.coreCount = count;
+        cores[i].state.cycleCount = 0;
+        cores[i].context = coreContext;
+    }
+
+    if (context.interleave > 0) {
+        runInterleaved(coreContext, cores, count);
+    } else {
+        for (int i = 0; i < count; i++) {
+            if (pthread_create(&cores[i].thread, NULL, runFree, &cores[i]) != 0) {
+                fprintf(stderr, "Could not start core %d\n", i);
+                exit(1);
+            }
+        }
+
+        for (int i = 0; i < count; i++) {
+            pthread_join(cores[i].thread, NULL);
+        }
+    }
+
+    // The first core that faulted or stopped gives the exit status
+    int status = 0;
+    for (int i = 0; i < count; i++) {
+        int coreStatus = exitStatus(&cores[i].state);
+        if (coreStatus != 0) {
+            fprintf(stderr, "Core %d: ", i);
+            printStop(&context, &cores[i].state, stderr);
+            if (status == 0) {
+                status = coreStatus;
+            }
+        }
+    }
+
+    if (context.benchmarkMode) {
+        printCoreReport(cores, count);
+    }
+
+    *boot = cores[0].state;
+    free(cores);
+
+    if (status != 0) {
+        exit(status);
+    }
+}
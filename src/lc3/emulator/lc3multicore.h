@@ -0,0 +1,38 @@
+#ifndef LC3_MULTICORE_H
+#define LC3_MULTICORE_H
+
+#include "../context/lc3context.h"
+#include "lc3emulator.h"
+
+/*
+ * Several cores on one shared memory (--cores).
+ *
+ * Every core is an LC3EmulatorState of its own (registers, pc, cc, I/O positions, cycle count) whose
+ * memory points at the memory of the program, and starts at the program's entry with its registers.
+ * Two traps let the cores tell themselves apart and synchronize, and work the same on a single core:
+ *
+ *   TRAP x30 (CORE)  R0 <- the number of the core, from 0, R1 <- the number of cores
+ *   TRAP x31 (CAS)   Compares the word at R0 with R1 and replaces it with R2 if they are equal, as one
+ *                    atomic step. R1 <- the previous word, so the swap happened when R1 is unchanged.
+ *
+ * Free-running (the default) gives every core a host thread that runs emulate() on its own, so
+ * independent cores scale with the host's cores. Loads and stores are atomic words but otherwise
+ * unordered between cores, CAS is a full barrier. Fused dispatch is decoded per core, so several cores
+ * run the stepped engine and code stored by one core is seen by the others like any other word.
+ *
+ * --interleave <n> runs the cores on the calling thread instead, n instructions per core in turn from
+ * core 0, so a run (including its races) is the same every time.
+ *
+ * Each core counts its own cycles, --max-cycles stops each core on its own and the run ends once every
+ * core has halted, faulted or stopped.
+ */
+#define LC3_TRAP_CORE 0x30
+#define LC3_TRAP_CAS 0x31
+
+#define LC3_MAX_CORES 64
+
+// Runs the program on context.cores cores sharing boot's memory, leaves the registers of core 0 in boot.
+// Reports the cores that faulted or stopped and exits with the status of the first one (see exitOnStop).
+void runCores(LC3Context context, LC3EmulatorState *boot);
+
+#endif // LC3_MULTICORE_H
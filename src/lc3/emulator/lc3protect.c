@@ -0,0 +1,28 @@
+#include "lc3protect.h"
+
+#include "lc3interrupt.h"
+
+int checkAccess(LC3EmulatorState *state) {
+    // Supervisor code may access anything
+    if (state->interrupts.enabled && !(state->interrupts.psr & LC3_PSR_USER)) {
+        return 0;
+    }
+
+    unsigned short address;
+    if (!findViolation(state, &address)) {
+        return 0;
+    }
+
+    // The instruction has been fetched, the saved pc is past it
+    state->pc++;
+
+    if (state->interrupts.enabled) {
+        interruptEnter(state, LC3_VECTOR_ACCESS_VIOLATION, -1);
+        return 1;
+    }
+
+    state->fault = LC3_FAULT_ACCESS_VIOLATION;
+    state->faultAddress = address;
+    state->haltSignal = LC3_FAULT_SIGNAL;
+    return 1;
+}
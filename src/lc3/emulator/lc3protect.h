@@ -0,0 +1,50 @@
+#ifndef LC3_PROTECT_H
+#define LC3_PROTECT_H
+
+#include "lc3decode.h"
+#include "lc3emulator.h"
+
+/*
+ * Access control (--protect): user code may not touch system space, x0000-x2FFF and the device
+ * registers at xFE00-xFFFF, as a fetch or as a load or store of LD/LDR/LDI/ST/STR/STI (both the
+ * pointer and the target of an indirection).
+ *
+ * Permissions are kept per page of LC3_PAGE_SIZE words. Only the stepped engine consults them, before
+ * each instruction, so the default engine has no per-access check. A violating instruction is not
+ * executed: with --interrupts it raises the ACV exception (vector x02) like the real machine, otherwise
+ * the run ends with a fault naming the instruction and the address. Without --interrupts the whole
+ * program counts as user code, with them only code running in user mode does.
+ */
+#define LC3_VECTOR_ACCESS_VIOLATION 0x02
+
+// 1 bit per page of system space: pages x00-x2F and xFE-xFF
+static const unsigned long long lc3SystemPages[LC3_PAGE_COUNT / 64] = {0x0000FFFFFFFFFFFFULL, 0, 0, 0xC000000000000000ULL};
+
+static inline int isSystemAddress(unsigned short address) {
+    unsigned int page = address >> LC3_PAGE_SHIFT;
+    return (lc3SystemPages[page >> 6] >> (page & 63)) & 1;
+}
+
+// Fills in the first system address the instruction at the pc would access, returns 0 when there is none
+static inline int findViolation(const LC3EmulatorState *state, unsigned short *address) {
+    unsigned short pc = state->pc;
+
+    if (isSystemAddress(pc)) {
+        *address = pc;
+        return 1;
+    }
+
+    LC3DataAccess access = decodeDataAccess(state, state->memory[pc].rawNumber);
+    if (access.kind == LC3_DATA_NONE) {
+        return 0;
+    }
+
+    // A pointer in system space is the violation, its word is never read
+    *address = access.indirect && isSystemAddress(access.pointer) ? access.pointer : access.address;
+    return isSystemAddress(*address);
+}
+
+// Called by the stepped engine before each instruction, returns 1 when it was not executed
+int checkAccess(LC3EmulatorState *state);
+
+#endif // LC3_PROTECT_H
@@ -0,0 +1,55 @@
+#include "lc3snapshot.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+LC3Snapshot *createSnapshot(LC3EmulatorState *state) {
+    LC3Snapshot *snapshot = calloc(1, sizeof(LC3Snapshot));
+    snapshot->memory = malloc(65536 * sizeof(MemoryCell));
+    memcpy(snapshot->memory, state->memory, 65536 * sizeof(MemoryCell));
+
+    memcpy(snapshot->registers, state->registers, sizeof(snapshot->registers));
+    snapshot->pc = state->pc;
+    snapshot->cc = state->cc;
+    snapshot->interrupts = state->interrupts;
+
+    memset(state->dirtyPages, 0, sizeof(state->dirtyPages));
+
+    return snapshot;
+}
+
+void destroySnapshot(LC3Snapshot *snapshot) {
+    if (snapshot == NULL) {
+        return;
+    }
+
+    free(snapshot->memory);
+    free(snapshot);
+}
+
+int restoreSnapshot(const LC3Snapshot *snapshot, LC3EmulatorState *state) {
+    int restoredPages = 0;
+
+    for (int word = 0; word < LC3_PAGE_COUNT / 64; word++) {
+        unsigned long long dirty = state->dirtyPages[word];
+        while (dirty != 0) {
+            int page = word * 64 + __builtin_ctzll(dirty);
+            dirty &= dirty - 1;
+
+            memcpy(&state->memory[page * LC3_PAGE_SIZE], &snapshot->memory[page * LC3_PAGE_SIZE], LC3_PAGE_SIZE * sizeof(MemoryCell));
+            restoredPages++;
+        }
+
+        state->dirtyPages[word] = 0;
+    }
+
+    memcpy(state->registers, snapshot->registers, sizeof(state->registers));
+    state->pc = snapshot->pc;
+    state->cc = snapshot->cc;
+    state->interrupts = snapshot->interrupts;
+    state->haltSignal = 0;
+    state->fault = LC3_FAULT_NONE;
+    state->cycleCount = 0;
+
+    return restoredPages;
+}
@@ -0,0 +1,27 @@
+#ifndef LC3_SNAPSHOT_H
+#define LC3_SNAPSHOT_H
+
+#include "lc3emulator.h"
+
+/*
+ * A pristine copy of an emulator state, used to run many cases against the same program.
+ *
+ * Taking a snapshot clears the dirty page bitmap of the state, restoring it only copies back
+ * the pages written since then, so resetting costs what the program actually touched.
+ */
+typedef struct LC3Snapshot {
+    MemoryCell *memory;
+
+    short registers[8];
+    unsigned short pc;
+    unsigned short cc;
+    LC3Interrupts interrupts;
+} LC3Snapshot;
+
+LC3Snapshot *createSnapshot(LC3EmulatorState *state);
+void destroySnapshot(LC3Snapshot *snapshot);
+
+// Returns the number of pages copied back
+int restoreSnapshot(const LC3Snapshot *snapshot, LC3EmulatorState *state);
+
+#endif // LC3_SNAPSHOT_H
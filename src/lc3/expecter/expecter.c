@@ -80,6 +80,10 @@ EmulatorExpectations loadExpectationFromFile(FILE* expectationsFile) {
                 // This is a memory location
                 int memoryLocation = strtol(location + 1, NULL, 16);
                 expectations.output.expectedMemory[memoryLocation] = 1;
+            } else if (strcmp(location, "cc") == 0) {
+                expectations.output.expectedCc = 1;
+            } else if (strcmp(location, "pc") == 0) {
+                expectations.output.expectedPc = 1;
             } else {
                 fprintf(stderr, "EXPECT: Invalid location in expectations file: %s\n", location);
             }
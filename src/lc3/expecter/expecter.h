@@ -14,6 +14,8 @@ typedef struct EmulatorInput {
 typedef struct EmulatorOutput {
     short expectedRegisters[8]; // 1 if we expect the register to be replaced, 0 otherwise
     short expectedMemory[65536]; // 1 if we expect the memory to be replaced, 0 otherwise
+    short expectedCc; // 1 if we expect the condition codes, 0 otherwise
+    short expectedPc; // 1 if we expect the pc, 0 otherwise
 } EmulatorOutput;
 
 typedef struct EmulatorExpectations {
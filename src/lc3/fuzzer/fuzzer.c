@@ -0,0 +1,334 @@
+#include "fuzzer.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "../../hash/hash.h"
+#include "../random/lc3random.h"
+
+typedef enum {
+    FUZZ_HALTED,  // Halted, or asked for more input than it got
+    FUZZ_CRASHED,
+    FUZZ_HUNG,
+} FuzzOutcome;
+
+static const unsigned char INTERESTING[] = {'0', '1', '9', '-', '+', ' ', '\n', 'a', 'z', 'A', 'Z', 'q', 'y', 'n', 0, 127, 128, 255};
+
+static unsigned long long nextRandom(Fuzzer* fuzzer) {
+    fuzzer->random += 0x9e3779b97f4a7c15ULL;
+    return randomMix(fuzzer->random);
+}
+
+static unsigned int randomBelow(Fuzzer* fuzzer, unsigned int limit) {
+    return limit > 0 ? nextRandom(fuzzer) % limit : 0;
+}
+
+static int hasBit(const unsigned char* bitmap, unsigned short address) {
+    return (bitmap[address >> 3] >> (address & 7)) & 1;
+}
+
+static void setBit(unsigned char* bitmap, unsigned short address) {
+    bitmap[address >> 3] |= 1 << (address & 7);
+}
+
+static void addToCorpus(Fuzzer* fuzzer, const unsigned char* data, size_t length) {
+    if (fuzzer->corpusCount == fuzzer->corpusCapacity) {
+        fuzzer->corpusCapacity = fuzzer->corpusCapacity == 0 ? 64 : fuzzer->corpusCapacity * 2;
+        fuzzer->corpus = realloc(fuzzer->corpus, fuzzer->corpusCapacity * sizeof(FuzzInput));
+    }
+
+    FuzzInput* input = &fuzzer->corpus[fuzzer->corpusCount++];
+    input->data = malloc(length + 1);
+    memcpy(input->data, data, length);
+    input->length = length;
+}
+
+// Named by content, so the same input is never stored twice
+static void saveInput(Fuzzer* fuzzer, const char* prefix, const unsigned char* data, size_t length, char* path, size_t pathSize) {
+    snprintf(path, pathSize, "%s/%s-%016llx", fuzzer->directory, prefix, hashBytes(HASH64_INITIAL, data, length));
+
+    FILE* file = fopen(path, "wb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not write fuzzer input: %s\n", path);
+        return;
+    }
+
+    fwrite(data, 1, length, file);
+    fclose(file);
+}
+
+static void loadCorpus(Fuzzer* fuzzer) {
+    DIR* directory = opendir(fuzzer->directory);
+    if (directory == NULL) {
+        return;
+    }
+
+    struct dirent* entry;
+    while ((entry = readdir(directory)) != NULL) {
+        // Crashes and hangs are results, not seeds
+        if (entry->d_name[0] == '.' || strncmp(entry->d_name, "crash-", 6) == 0 || strncmp(entry->d_name, "hang-", 5) == 0) {
+            continue;
+        }
+
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", fuzzer->directory, entry->d_name);
+        FILE* file = fopen(path, "rb");
+        if (file == NULL) {
+            continue;
+        }
+
+        unsigned char data[FUZZ_MAX_INPUT];
+        size_t length = fread(data, 1, sizeof(data), file);
+        fclose(file);
+        addToCorpus(fuzzer, data, length);
+    }
+
+    closedir(directory);
+}
+
+// Steps the program up to its first input trap, returns 0 when it ends without reading input
+static int runToFirstInput(LC3Context* ctx, LC3EmulatorState* state, Fuzzer* fuzzer) {
+    while (!state->haltSignal && fuzzer->prefixCycles < fuzzer->budget) {
+        unsigned short instruction = state->memory[state->pc].rawNumber;
+        if (instruction == 0xF020 || instruction == 0xF023) {
+            return 1;
+        }
+
+        step(ctx, state);
+        fuzzer->prefixCycles++;
+    }
+
+    return 0;
+}
+
+static FuzzOutcome execute(Fuzzer* fuzzer, LC3Context* ctx, LC3EmulatorState* state, const unsigned char* input, size_t length) {
+    restoreSnapshot(fuzzer->snapshot, state);
+    state->io.input = input;
+    state->io.inputLength = length;
+    state->io.inputPosition = 0;
+
+    memset(fuzzer->trace, 0, sizeof(fuzzer->trace));
+    unsigned long long cycles = fuzzer->prefixCycles;
+
+    while (!state->haltSignal && cycles < fuzzer->budget) {
+        unsigned short pc = state->pc;
+        unsigned short opcode = state->memory[pc].rawNumber >> 12;
+        step(ctx, state);
+        cycles++;
+
+        if (opcode == 0 || opcode == 4 || opcode == 12) {
+            unsigned short edge = (unsigned short)(pc * 0x9e37u) ^ state->pc;
+            fuzzer->trace[edge] += fuzzer->trace[edge] != 255;
+        }
+    }
+
+    fuzzer->stats.executions++;
+    if (!state->haltSignal) {
+        return FUZZ_HUNG;
+    }
+
+    return state->fault == LC3_FAULT_RTI || state->fault == LC3_FAULT_RESERVED_OPCODE ? FUZZ_CRASHED : FUZZ_HALTED;
+}
+
+static unsigned char countBucket(unsigned char count) {
+    if (count <= 3) {
+        return count == 3 ? 4 : count;
+    }
+    return count < 8 ? 8 : count < 16 ? 16 : count < 32 ? 32 : count < 128 ? 64 : 128;
+}
+
+// Merges the trace into the seen buckets, returns whether it reached any new one
+static int hasNewCoverage(Fuzzer* fuzzer) {
+    int found = 0;
+
+    for (int word = 0; word < FUZZ_MAP_SIZE / 8; word++) {
+        // Most of the map is untouched, skipped 8 edges at a time
+        unsigned long long counts;
+        memcpy(&counts, &fuzzer->trace[word * 8], sizeof(counts));
+        if (counts == 0) {
+            continue;
+        }
+
+        for (int i = word * 8; i < word * 8 + 8; i++) {
+            unsigned char bucket = countBucket(fuzzer->trace[i]);
+            if (bucket & ~fuzzer->seen[i]) {
+                fuzzer->stats.edges += fuzzer->seen[i] == 0;
+                fuzzer->seen[i] |= bucket;
+                found = 1;
+            }
+        }
+    }
+
+    return found;
+}
+
+static size_t mutate(Fuzzer* fuzzer, unsigned char* data, size_t length) {
+    int mutations = 1 + randomBelow(fuzzer, 8);
+    for (int i = 0; i < mutations; i++) {
+        unsigned int position = randomBelow(fuzzer, length);
+
+        switch (randomBelow(fuzzer, 8)) {
+            case 0:  // Flip a bit
+                if (length > 0) {
+                    data[position] ^= 1 << randomBelow(fuzzer, 8);
+                }
+                break;
+            case 1:  // Replace a byte
+                if (length > 0) {
+                    data[position] = INTERESTING[randomBelow(fuzzer, sizeof(INTERESTING))];
+                }
+                break;
+            case 2:  // Step a byte (next digit or letter)
+                if (length > 0) {
+                    data[position] += randomBelow(fuzzer, 2) ? 1 : -1;
+                }
+                break;
+            case 3:  // Insert a byte (possibly at the end)
+            case 4:
+                position = randomBelow(fuzzer, length + 1);
+                if (length < FUZZ_MAX_INPUT) {
+                    memmove(&data[position + 1], &data[position], length - position);
+                    data[position] = randomBelow(fuzzer, 2) ? INTERESTING[randomBelow(fuzzer, sizeof(INTERESTING))] : nextRandom(fuzzer);
+                    length++;
+                }
+                break;
+            case 5:  // Delete a byte
+                if (length > 0) {
+                    memmove(&data[position], &data[position + 1], length - position - 1);
+                    length--;
+                }
+                break;
+            case 6: {  // Duplicate a chunk
+                size_t chunk = 1 + randomBelow(fuzzer, length - position);
+                if (length > 0 && length + chunk <= FUZZ_MAX_INPUT) {
+                    memmove(&data[position + chunk], &data[position], length - position);
+                    length += chunk;
+                }
+                break;
+            }
+            default: {  // Splice the tail of another input (possibly appending it)
+                position = randomBelow(fuzzer, length + 1);
+                const FuzzInput* other = &fuzzer->corpus[randomBelow(fuzzer, fuzzer->corpusCount)];
+                size_t from = randomBelow(fuzzer, other->length);
+                size_t chunk = other->length - from;
+                if (position + chunk > FUZZ_MAX_INPUT) {
+                    chunk = FUZZ_MAX_INPUT - position;
+                }
+                memcpy(&data[position], &other->data[from], chunk);
+                length = position + chunk;
+                break;
+            }
+        }
+    }
+
+    return length;
+}
+
+static void reportResult(Fuzzer* fuzzer, FuzzOutcome outcome, LC3EmulatorState* state, const unsigned char* data, size_t length) {
+    char path[4096 + 64];
+    if (outcome == FUZZ_CRASHED) {
+        fuzzer->stats.crashes++;
+
+        unsigned short address = state->pc - 1;
+        if (!hasBit(fuzzer->crashed, address)) {
+            setBit(fuzzer->crashed, address);
+            fuzzer->stats.uniqueCrashes++;
+
+            saveInput(fuzzer, "crash", data, length, path, sizeof(path));
+            printf("Crash at x%04x: ", address);
+            printFault(state, stdout);
+            printf("  input saved to %s\n", path);
+        }
+    } else if (outcome == FUZZ_HUNG) {
+        fuzzer->stats.hangs++;
+
+        if (!hasBit(fuzzer->hung, state->pc)) {
+            setBit(fuzzer->hung, state->pc);
+            fuzzer->stats.uniqueHangs++;
+
+            saveInput(fuzzer, "hang", data, length, path, sizeof(path));
+            printf("Hang at x%04x after %llu cycles, input saved to %s\n", state->pc, fuzzer->budget, path);
+        }
+    }
+}
+
+int runFuzzer(LC3Context ctx, LC3EmulatorState* state, const char* directory, unsigned long long executions) {
+    if (mkdir(directory, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Could not create fuzzer directory: %s\n", directory);
+        exit(1);
+    }
+
+    Fuzzer* fuzzer = calloc(1, sizeof(Fuzzer));
+    fuzzer->directory = directory;
+    fuzzer->random = randomKey(ctx.seed, RANDOM_STREAM_FUZZER);
+    fuzzer->budget = ctx.maxCycleCount > 0 ? (unsigned long long)ctx.maxCycleCount : FUZZ_CYCLE_BUDGET;
+
+    // Nothing before the first input depends on it, output is never printed
+    static const unsigned char noInput[1] = {0};
+    state->io = (LC3IO){0};
+    state->io.input = noInput;
+    state->io.suppressStdout = 1;
+
+    if (!runToFirstInput(&ctx, state, fuzzer)) {
+        free(fuzzer);
+        return 0;
+    }
+    fuzzer->snapshot = createSnapshot(state);
+
+    loadCorpus(fuzzer);
+    if (fuzzer->corpusCount == 0) {
+        addToCorpus(fuzzer, (const unsigned char*)"", 0);
+        addToCorpus(fuzzer, (const unsigned char*)"a\n", 2);
+        addToCorpus(fuzzer, (const unsigned char*)"0\n", 2);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // The seeds are kept whatever they cover
+    unsigned int seeds = fuzzer->corpusCount;
+    for (unsigned int i = 0; i < seeds; i++) {
+        FuzzOutcome outcome = execute(fuzzer, &ctx, state, fuzzer->corpus[i].data, fuzzer->corpus[i].length);
+        hasNewCoverage(fuzzer);
+        reportResult(fuzzer, outcome, state, fuzzer->corpus[i].data, fuzzer->corpus[i].length);
+    }
+
+    unsigned char data[FUZZ_MAX_INPUT];
+    while (fuzzer->stats.executions < executions) {
+        const FuzzInput* parent = &fuzzer->corpus[randomBelow(fuzzer, fuzzer->corpusCount)];
+        memcpy(data, parent->data, parent->length);
+        size_t length = mutate(fuzzer, data, parent->length);
+
+        FuzzOutcome outcome = execute(fuzzer, &ctx, state, data, length);
+        if (hasNewCoverage(fuzzer)) {
+            char path[4096 + 64];
+            addToCorpus(fuzzer, data, length);
+            saveInput(fuzzer, "id", data, length, path, sizeof(path));
+        }
+        reportResult(fuzzer, outcome, state, data, length);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("\n===========\nFuzzing: %llu executions in %.2f s (%.0f per second)\n", fuzzer->stats.executions, seconds,
+           seconds > 0 ? fuzzer->stats.executions / seconds : 0.0);
+    printf("Corpus: %u inputs, %u edges\n", fuzzer->corpusCount, fuzzer->stats.edges);
+    printf("Crashes: %llu (%u unique), hangs: %llu (%u unique)\n===========\n", fuzzer->stats.crashes, fuzzer->stats.uniqueCrashes,
+           fuzzer->stats.hangs, fuzzer->stats.uniqueHangs);
+
+    for (unsigned int i = 0; i < fuzzer->corpusCount; i++) {
+        free(fuzzer->corpus[i].data);
+    }
+    free(fuzzer->corpus);
+    destroySnapshot(fuzzer->snapshot);
+    free(fuzzer);
+
+    state->io = (LC3IO){0};
+    return 1;
+}
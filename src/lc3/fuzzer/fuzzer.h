@@ -0,0 +1,64 @@
+#ifndef LC3_FUZZER_H
+#define LC3_FUZZER_H
+
+#include <stddef.h>
+
+#include "../context/lc3context.h"
+#include "../emulator/lc3emulator.h"
+#include "../emulator/lc3snapshot.h"
+
+/*
+ * Coverage-guided fuzzing of the input stream (--fuzz).
+ *
+ * The program runs once up to its first GETC/IN, which is snapshotted. Every execution restores the
+ * snapshot (only the pages the previous one wrote), feeds a mutated input and steps until the program
+ * halts, faults or runs out of cycles. Control transfers (BR, JMP/RET, JSR/JSRR) are counted per edge in
+ * a hashed map; an input that reaches a new edge, or an edge a new number of times (in AFL's power of two
+ * buckets), joins the corpus.
+ *
+ * The corpus, crashing inputs (RTI, reserved opcodes) and hangs (out of cycles) are written to the
+ * directory, named by a hash of their contents. Files already in it seed the next session.
+ */
+#define FUZZ_MAP_SIZE 65536
+#define FUZZ_MAX_INPUT 256
+#define FUZZ_CYCLE_BUDGET 1000000  // Per execution without --max-cycles, counted from the start of the program
+
+typedef struct FuzzInput {
+    unsigned char* data;
+    size_t length;
+} FuzzInput;
+
+typedef struct FuzzStats {
+    unsigned long long executions;
+    unsigned long long crashes;
+    unsigned long long hangs;
+    unsigned int uniqueCrashes;  // By faulting address
+    unsigned int uniqueHangs;    // By pc when the cycles ran out
+    unsigned int edges;
+} FuzzStats;
+
+typedef struct Fuzzer {
+    const char* directory;
+    unsigned long long random;
+    unsigned long long budget;
+    unsigned long long prefixCycles;  // Run before the snapshot
+
+    LC3Snapshot* snapshot;
+
+    unsigned char trace[FUZZ_MAP_SIZE];  // Edge counts of the current execution
+    unsigned char seen[FUZZ_MAP_SIZE];   // Count buckets reached by any execution
+
+    unsigned char crashed[65536 / 8];  // Faulting addresses already saved
+    unsigned char hung[65536 / 8];
+
+    FuzzInput* corpus;
+    unsigned int corpusCount;
+    unsigned int corpusCapacity;
+
+    FuzzStats stats;
+} Fuzzer;
+
+// Fuzzes the assembled program for the given number of executions, returns 0 when it reads no input
+int runFuzzer(LC3Context ctx, LC3EmulatorState* state, const char* directory, unsigned long long executions);
+
+#endif // LC3_FUZZER_H
@@ -0,0 +1,197 @@
+#include "lc3image.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IMAGE_MAGIC 0x4333434cU  // "LC3C"
+#define IMAGE_FORMAT_VERSION 2
+
+LC3Image* createImage(void) {
+    LC3Image* image = calloc(1, sizeof(LC3Image));
+    image->memory = calloc(65536, sizeof(MemoryCell));
+    image->lines = calloc(65536, sizeof(unsigned int));
+    image->symbols = calloc(16, sizeof(LC3Symbol));
+    image->symbolCount = 0;
+    image->symbolCapacity = 16;
+
+    return image;
+}
+
+void destroyImage(LC3Image* image) {
+    if (image == NULL) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < image->symbolCount; i++) {
+        free(image->symbols[i].name);
+    }
+
+    free(image->symbols);
+    free(image->memory);
+    free(image->lines);
+    free(image);
+}
+
+void imageEmitWord(LC3Image* image, unsigned short address, unsigned short value) {
+    image->memory[address].rawNumber = value;
+    image->emitted[address >> 3] |= 1 << (address & 7);
+}
+
+int imageIsEmitted(const LC3Image* image, unsigned short address) {
+    return (image->emitted[address >> 3] >> (address & 7)) & 1;
+}
+
+void imageSetSource(LC3Image* image, unsigned short address, unsigned int line, int isCode) {
+    image->lines[address] = line;
+    if (isCode) {
+        image->code[address >> 3] |= 1 << (address & 7);
+    }
+}
+
+int imageIsCode(const LC3Image* image, unsigned short address) {
+    return (image->code[address >> 3] >> (address & 7)) & 1;
+}
+
+void imageApply(const LC3Image* image, MemoryCell* memory) {
+    for (int block = 0; block < 65536 / 8; block++) {
+        unsigned char bits = image->emitted[block];
+        if (bits == 0) {
+            continue;
+        }
+
+        if (bits == 0xFF) {
+            memcpy(&memory[block * 8], &image->memory[block * 8], 8 * sizeof(MemoryCell));
+            continue;
+        }
+
+        for (int i = 0; i < 8; i++) {
+            if (bits & (1 << i)) {
+                memory[block * 8 + i] = image->memory[block * 8 + i];
+            }
+        }
+    }
+}
+
+void imageAddSymbol(LC3Image* image, const char* name, unsigned short address) {
+    if (image->symbolCount == image->symbolCapacity) {
+        image->symbolCapacity *= 2;
+        image->symbols = realloc(image->symbols, sizeof(LC3Symbol) * image->symbolCapacity);
+    }
+
+    // Keep the symbols sorted by address, labels are mostly added in order so this is cheap
+    unsigned int position = image->symbolCount;
+    while (position > 0 && image->symbols[position - 1].address > address) {
+        image->symbols[position] = image->symbols[position - 1];
+        position--;
+    }
+
+    image->symbols[position].name = strdup(name);
+    image->symbols[position].address = address;
+    image->symbolCount++;
+}
+
+const LC3Symbol* imageFindSymbol(const LC3Image* image, const char* name) {
+    for (unsigned int i = 0; i < image->symbolCount; i++) {
+        const char* a = image->symbols[i].name;
+        const char* b = name;
+        while (*a != '\0' && *a == tolower((unsigned char)*b)) {
+            a++;
+            b++;
+        }
+
+        if (*a == '\0' && *b == '\0') {
+            return &image->symbols[i];
+        }
+    }
+
+    return NULL;
+}
+
+const LC3Symbol* imageSymbolAt(const LC3Image* image, unsigned short address) {
+    // Binary search for the last symbol with symbol.address <= address
+    int low = 0;
+    int high = (int)image->symbolCount - 1;
+    const LC3Symbol* found = NULL;
+
+    while (low <= high) {
+        int middle = (low + high) / 2;
+        if (image->symbols[middle].address <= address) {
+            found = &image->symbols[middle];
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+
+    return found;
+}
+
+int imageWrite(const LC3Image* image, FILE* output) {
+    unsigned int header[2] = {IMAGE_MAGIC, IMAGE_FORMAT_VERSION};
+    fwrite(header, sizeof(unsigned int), 2, output);
+    fwrite(&image->initialPc, sizeof(unsigned short), 1, output);
+    fwrite(image->emitted, 1, sizeof(image->emitted), output);
+    fwrite(image->code, 1, sizeof(image->code), output);
+
+    // Only the emitted words are stored, in address order
+    for (int address = 0; address < 65536; address++) {
+        if (imageIsEmitted(image, address)) {
+            fwrite(&image->memory[address], sizeof(MemoryCell), 1, output);
+            fwrite(&image->lines[address], sizeof(unsigned int), 1, output);
+        }
+    }
+
+    fwrite(&image->symbolCount, sizeof(unsigned int), 1, output);
+    for (unsigned int i = 0; i < image->symbolCount; i++) {
+        unsigned short length = strlen(image->symbols[i].name);
+        fwrite(&image->symbols[i].address, sizeof(unsigned short), 1, output);
+        fwrite(&length, sizeof(unsigned short), 1, output);
+        fwrite(image->symbols[i].name, 1, length, output);
+    }
+
+    fflush(output);
+    return !ferror(output);
+}
+
+LC3Image* imageRead(FILE* input) {
+    unsigned int header[2] = {0};
+    if (fread(header, sizeof(unsigned int), 2, input) != 2 || header[0] != IMAGE_MAGIC || header[1] != IMAGE_FORMAT_VERSION) {
+        return NULL;
+    }
+
+    LC3Image* image = createImage();
+    int ok = fread(&image->initialPc, sizeof(unsigned short), 1, input) == 1;
+    ok = ok && fread(image->emitted, 1, sizeof(image->emitted), input) == sizeof(image->emitted);
+    ok = ok && fread(image->code, 1, sizeof(image->code), input) == sizeof(image->code);
+
+    for (int address = 0; ok && address < 65536; address++) {
+        if (imageIsEmitted(image, address)) {
+            ok = fread(&image->memory[address], sizeof(MemoryCell), 1, input) == 1;
+            ok = ok && fread(&image->lines[address], sizeof(unsigned int), 1, input) == 1;
+        }
+    }
+
+    unsigned int symbolCount = 0;
+    ok = ok && fread(&symbolCount, sizeof(unsigned int), 1, input) == 1;
+    for (unsigned int i = 0; ok && i < symbolCount; i++) {
+        unsigned short address = 0;
+        unsigned short length = 0;
+        ok = fread(&address, sizeof(unsigned short), 1, input) == 1;
+        ok = ok && fread(&length, sizeof(unsigned short), 1, input) == 1;
+
+        char* name = calloc(length + 1, 1);
+        ok = ok && fread(name, 1, length, input) == length;
+        if (ok) {
+            imageAddSymbol(image, name, address);
+        }
+        free(name);
+    }
+
+    if (!ok) {
+        destroyImage(image);
+        return NULL;
+    }
+
+    return image;
+}
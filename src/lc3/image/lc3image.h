@@ -0,0 +1,51 @@
+#ifndef LC3_IMAGE_H
+#define LC3_IMAGE_H
+
+#include <stdio.h>
+
+#include "../emulator/lc3emulator.h"
+
+typedef struct LC3Symbol {
+    char* name;  // Lowercase, as resolved by the assembler
+    unsigned short address;
+} LC3Symbol;
+
+/*
+ * The output of the assembler, independent of the memory it is later loaded into.
+ *
+ * Only the words marked in the emitted bitmap were produced by the assembler, everything else
+ * is left to the memory layout (zeroed, or junk when randomized).
+ */
+typedef struct LC3Image {
+    unsigned short initialPc;
+
+    MemoryCell* memory;                // 65536 cells
+    unsigned char emitted[65536 / 8];  // 1 bit per word written by the assembler
+    unsigned char code[65536 / 8];     // 1 bit per word assembled from an instruction (not a directive)
+    unsigned int* lines;               // Source line of the statement starting at each address, 0 for none
+
+    LC3Symbol* symbols;  // Sorted by address
+    unsigned int symbolCount;
+    unsigned int symbolCapacity;
+} LC3Image;
+
+LC3Image* createImage(void);
+void destroyImage(LC3Image* image);
+
+void imageEmitWord(LC3Image* image, unsigned short address, unsigned short value);
+int imageIsEmitted(const LC3Image* image, unsigned short address);
+
+void imageSetSource(LC3Image* image, unsigned short address, unsigned int line, int isCode);
+int imageIsCode(const LC3Image* image, unsigned short address);
+
+// Copies every emitted word of the image into the given memory
+void imageApply(const LC3Image* image, MemoryCell* memory);
+
+void imageAddSymbol(LC3Image* image, const char* name, unsigned short address);
+const LC3Symbol* imageFindSymbol(const LC3Image* image, const char* name);
+const LC3Symbol* imageSymbolAt(const LC3Image* image, unsigned short address);  // Closest symbol at or before the address
+
+int imageWrite(const LC3Image* image, FILE* output);
+LC3Image* imageRead(FILE* input);
+
+#endif // LC3_IMAGE_H
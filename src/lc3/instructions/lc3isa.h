@@ -172,6 +172,7 @@ typedef struct StringzDirective {
 typedef struct ParsedInstruction {
     InstructionType type;
     int memoryLocation;
+    int line;  // In the source file
 
     union {
         AddInstruction iAdd;
@@ -256,6 +257,7 @@ void addLabel(Labels* labels, char* label);
 typedef struct LabelledInstruction {
     Labels* labels;
     int memoryLocation;
+    int line;  // In the source file
     UnresolvedInstruction instruction;
 } LabelledInstruction;
 
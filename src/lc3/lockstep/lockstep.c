@@ -0,0 +1,445 @@
+#include "lockstep.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../emulator/lc3decode.h"
+#include "../emulator/lc3loop.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+typedef struct LaneVector {
+    unsigned short lane[LOCKSTEP_LANES];
+} LaneVector;
+
+typedef struct LockstepGroup {
+    LaneVector registers[8];
+    LaneVector pc;
+    LaneVector cc;
+
+    unsigned int active;        // Lanes still executing together
+    unsigned long long cycles;  // Every lane in the group has retired the same instructions
+
+    // Pages written by any lane, instruction words on these pages may differ between lanes
+    unsigned long long dirtyPages[LC3_PAGE_COUNT / 64];
+} LockstepGroup;
+
+/* 16-bit lane operations */
+
+#if defined(__AVX2__)
+
+#define LOAD(v) _mm256_loadu_si256((const __m256i *)(v).lane)
+#define STORE(v, x) _mm256_storeu_si256((__m256i *)(v).lane, (x))
+
+static inline LaneVector laneAdd(LaneVector a, LaneVector b) {
+    LaneVector r;
+    STORE(r, _mm256_add_epi16(LOAD(a), LOAD(b)));
+    return r;
+}
+
+static inline LaneVector laneAnd(LaneVector a, LaneVector b) {
+    LaneVector r;
+    STORE(r, _mm256_and_si256(LOAD(a), LOAD(b)));
+    return r;
+}
+
+static inline LaneVector laneNot(LaneVector a) {
+    LaneVector r;
+    STORE(r, _mm256_xor_si256(LOAD(a), _mm256_set1_epi16(-1)));
+    return r;
+}
+
+static inline LaneVector laneSplat(unsigned short value) {
+    LaneVector r;
+    STORE(r, _mm256_set1_epi16((short)value));
+    return r;
+}
+
+static inline LaneVector laneSelect(LaneVector mask, LaneVector ifSet, LaneVector ifClear) {
+    LaneVector r;
+    STORE(r, _mm256_blendv_epi8(LOAD(ifClear), LOAD(ifSet), LOAD(mask)));
+    return r;
+}
+
+static inline LaneVector laneNonZero(LaneVector a) {
+    LaneVector r;
+    STORE(r, _mm256_xor_si256(_mm256_cmpeq_epi16(LOAD(a), _mm256_setzero_si256()), _mm256_set1_epi16(-1)));
+    return r;
+}
+
+static inline LaneVector laneConditionCodes(LaneVector result) {
+    __m256i value = LOAD(result);
+    __m256i zero = _mm256_cmpeq_epi16(value, _mm256_setzero_si256());
+    __m256i negative = _mm256_cmpgt_epi16(_mm256_setzero_si256(), value);
+    __m256i positive = _mm256_andnot_si256(_mm256_or_si256(zero, negative), _mm256_set1_epi16(1));
+
+    LaneVector r;
+    STORE(r, _mm256_or_si256(_mm256_or_si256(_mm256_and_si256(zero, _mm256_set1_epi16(2)), _mm256_and_si256(negative, _mm256_set1_epi16(4))), positive));
+    return r;
+}
+
+#undef LOAD
+#undef STORE
+
+#elif defined(__SSE2__)
+
+#define LOAD(v, half) _mm_loadu_si128((const __m128i *)&(v).lane[(half) * 8])
+#define STORE(v, half, x) _mm_storeu_si128((__m128i *)&(v).lane[(half) * 8], (x))
+
+static inline LaneVector laneAdd(LaneVector a, LaneVector b) {
+    LaneVector r;
+    for (int h = 0; h < 2; h++) STORE(r, h, _mm_add_epi16(LOAD(a, h), LOAD(b, h)));
+    return r;
+}
+
+static inline LaneVector laneAnd(LaneVector a, LaneVector b) {
+    LaneVector r;
+    for (int h = 0; h < 2; h++) STORE(r, h, _mm_and_si128(LOAD(a, h), LOAD(b, h)));
+    return r;
+}
+
+static inline LaneVector laneNot(LaneVector a) {
+    LaneVector r;
+    for (int h = 0; h < 2; h++) STORE(r, h, _mm_xor_si128(LOAD(a, h), _mm_set1_epi16(-1)));
+    return r;
+}
+
+static inline LaneVector laneSplat(unsigned short value) {
+    LaneVector r;
+    for (int h = 0; h < 2; h++) STORE(r, h, _mm_set1_epi16((short)value));
+    return r;
+}
+
+static inline LaneVector laneSelect(LaneVector mask, LaneVector ifSet, LaneVector ifClear) {
+    LaneVector r;
+    for (int h = 0; h < 2; h++) {
+        __m128i m = LOAD(mask, h);
+        STORE(r, h, _mm_or_si128(_mm_and_si128(m, LOAD(ifSet, h)), _mm_andnot_si128(m, LOAD(ifClear, h))));
+    }
+    return r;
+}
+
+static inline LaneVector laneNonZero(LaneVector a) {
+    LaneVector r;
+    for (int h = 0; h < 2; h++) STORE(r, h, _mm_xor_si128(_mm_cmpeq_epi16(LOAD(a, h), _mm_setzero_si128()), _mm_set1_epi16(-1)));
+    return r;
+}
+
+static inline LaneVector laneConditionCodes(LaneVector result) {
+    LaneVector r;
+    for (int h = 0; h < 2; h++) {
+        __m128i value = LOAD(result, h);
+        __m128i zero = _mm_cmpeq_epi16(value, _mm_setzero_si128());
+        __m128i negative = _mm_cmplt_epi16(value, _mm_setzero_si128());
+        __m128i positive = _mm_andnot_si128(_mm_or_si128(zero, negative), _mm_set1_epi16(1));
+        STORE(r, h, _mm_or_si128(_mm_or_si128(_mm_and_si128(zero, _mm_set1_epi16(2)), _mm_and_si128(negative, _mm_set1_epi16(4))), positive));
+    }
+    return r;
+}
+
+#undef LOAD
+#undef STORE
+
+#else
+
+static inline LaneVector laneAdd(LaneVector a, LaneVector b) {
+    LaneVector r;
+    for (int i = 0; i < LOCKSTEP_LANES; i++) r.lane[i] = a.lane[i] + b.lane[i];
+    return r;
+}
+
+static inline LaneVector laneAnd(LaneVector a, LaneVector b) {
+    LaneVector r;
+    for (int i = 0; i < LOCKSTEP_LANES; i++) r.lane[i] = a.lane[i] & b.lane[i];
+    return r;
+}
+
+static inline LaneVector laneNot(LaneVector a) {
+    LaneVector r;
+    for (int i = 0; i < LOCKSTEP_LANES; i++) r.lane[i] = ~a.lane[i];
+    return r;
+}
+
+static inline LaneVector laneSplat(unsigned short value) {
+    LaneVector r;
+    for (int i = 0; i < LOCKSTEP_LANES; i++) r.lane[i] = value;
+    return r;
+}
+
+static inline LaneVector laneSelect(LaneVector mask, LaneVector ifSet, LaneVector ifClear) {
+    LaneVector r;
+    for (int i = 0; i < LOCKSTEP_LANES; i++) r.lane[i] = (mask.lane[i] & ifSet.lane[i]) | (~mask.lane[i] & ifClear.lane[i]);
+    return r;
+}
+
+static inline LaneVector laneNonZero(LaneVector a) {
+    LaneVector r;
+    for (int i = 0; i < LOCKSTEP_LANES; i++) r.lane[i] = a.lane[i] != 0 ? 0xFFFF : 0;
+    return r;
+}
+
+static inline LaneVector laneConditionCodes(LaneVector result) {
+    LaneVector r;
+    for (int i = 0; i < LOCKSTEP_LANES; i++) {
+        short value = (short)result.lane[i];
+        r.lane[i] = value == 0 ? 2 : value < 0 ? 4 : 1;
+    }
+    return r;
+}
+
+#endif
+
+static inline LaneVector laneMaskFromBits(unsigned int bits) {
+    LaneVector r;
+    for (int i = 0; i < LOCKSTEP_LANES; i++) {
+        r.lane[i] = (bits >> i) & 1 ? 0xFFFF : 0;
+    }
+    return r;
+}
+
+/* Moving lanes between the group and their scalar states */
+
+static void loadLane(LockstepGroup *group, int lane, const LC3EmulatorState *state) {
+    for (int r = 0; r < 8; r++) {
+        group->registers[r].lane[lane] = state->registers[r];
+    }
+    group->pc.lane[lane] = state->pc;
+    group->cc.lane[lane] = state->cc;
+}
+
+static void storeLane(const LockstepGroup *group, int lane, LC3EmulatorState *state) {
+    for (int r = 0; r < 8; r++) {
+        state->registers[r] = group->registers[r].lane[lane];
+    }
+    state->pc = group->pc.lane[lane];
+    state->cc = group->cc.lane[lane];
+    state->cycleCount = group->cycles;
+}
+
+static void stepLanesScalar(LC3Context *ctx, LockstepGroup *group, LC3EmulatorState **states, unsigned int lanes, unsigned short opcode) {
+    while (lanes != 0) {
+        int lane = __builtin_ctz(lanes);
+        lanes &= lanes - 1;
+
+        storeLane(group, lane, states[lane]);
+        step(ctx, states[lane]);
+        loadLane(group, lane, states[lane]);
+
+        // Stores may have changed instruction words of this lane only
+        if (opcode == 3 || opcode == 7 || opcode == 11) {
+            for (int i = 0; i < LC3_PAGE_COUNT / 64; i++) {
+                group->dirtyPages[i] |= states[lane]->dirtyPages[i];
+            }
+        }
+    }
+}
+
+static unsigned long long remainingCycles(LC3Context *ctx, unsigned long long cycles) {
+    if (ctx->maxCycleCount <= 0) {
+        return ULLONG_MAX;
+    }
+    return cycles < (unsigned long long)ctx->maxCycleCount ? ctx->maxCycleCount - cycles : 0;
+}
+
+// Samples the lane's state, returns 1 when it is confirmed to be stuck. The lane may have stepped ahead.
+static int checkLaneLoop(LC3Context *ctx, LC3EmulatorState *state, LockstepStats *stats) {
+    if (!loopDetectorSample(state, state->cycleCount)) {
+        return 0;
+    }
+
+    unsigned long long executed = 0;
+    int stuck = loopDetectorConfirm(ctx, state, state->cycleCount, remainingCycles(ctx, state->cycleCount), &executed);
+    state->cycleCount += executed;
+    stats->scalarInstructions += executed;
+
+    return stuck;
+}
+
+// Like emulate(), the limit is checked after each instruction, so a halt on the last allowed one still
+// ends the run at the limit. A fault takes precedence.
+static void stopLaneAtLimit(LC3Context *ctx, LC3EmulatorState *state) {
+    if (ctx->maxCycleCount > 0 && state->cycleCount >= (unsigned long long)ctx->maxCycleCount && state->haltSignal != LC3_FAULT_SIGNAL) {
+        state->haltSignal = LC3_STOP_SIGNAL;
+    }
+}
+
+static void runScalarLane(LC3Context *ctx, LC3EmulatorState *state, LockstepStats *stats) {
+    // A loop check may have stepped the lane up to the limit
+    stopLaneAtLimit(ctx, state);
+
+    while (!state->haltSignal) {
+        if (ctx->detectLoops && state->cycleCount >= state->loop.nextSample && checkLaneLoop(ctx, state, stats)) {
+            return;
+        }
+
+        step(ctx, state);
+        state->cycleCount++;
+        stats->scalarInstructions++;
+        stopLaneAtLimit(ctx, state);
+    }
+}
+
+LockstepStats runLockstep(LC3Context ctx, LC3EmulatorState **states, int count) {
+    LockstepStats stats = {0};
+    LockstepGroup group;
+    memset(&group, 0, sizeof(group));
+
+    unsigned int diverged = 0;
+
+    for (int lane = 0; lane < count; lane++) {
+        loadLane(&group, lane, states[lane]);
+        group.active |= 1U << lane;
+
+        if (ctx.detectLoops) {
+            loopDetectorStart(states[lane], 0);
+        }
+
+        for (int i = 0; i < LC3_PAGE_COUNT / 64; i++) {
+            group.dirtyPages[i] |= states[lane]->dirtyPages[i];
+        }
+    }
+
+    while (group.active != 0) {
+        int leader = __builtin_ctz(group.active);
+        unsigned short pc = group.pc.lane[leader];
+        unsigned short instruction = states[leader]->memory[pc].rawNumber;
+
+        // Lanes at a different pc, or with a different instruction word at this pc, leave the group
+        unsigned int match = 0;
+        unsigned int page = pc >> LC3_PAGE_SHIFT;
+        int pageIsDirty = (group.dirtyPages[page >> 6] >> (page & 63)) & 1;
+
+        for (unsigned int lanes = group.active; lanes != 0; lanes &= lanes - 1) {
+            int lane = __builtin_ctz(lanes);
+            if (group.pc.lane[lane] == pc && (!pageIsDirty || states[lane]->memory[pc].rawNumber == instruction)) {
+                match |= 1U << lane;
+            }
+        }
+
+        // Diverged lanes continue from their current state in scalar mode
+        for (unsigned int lanes = group.active & ~match; lanes != 0; lanes &= lanes - 1) {
+            storeLane(&group, __builtin_ctz(lanes), states[__builtin_ctz(lanes)]);
+        }
+
+        diverged |= group.active & ~match;
+        group.active = match;
+
+        LaneVector mask = laneMaskFromBits(match);
+        unsigned short opcode = getRaw(instruction, 12, 4);
+        unsigned short nextPc = pc + 1;
+
+        switch (opcode) {
+            case 0: {  // BR
+                LaneVector taken = laneNonZero(laneAnd(group.cc, laneSplat(getRaw(instruction, 9, 3))));
+                LaneVector target = laneSelect(taken, laneSplat(nextPc + getAsNumber(instruction, 0, 9)), laneSplat(nextPc));
+                group.pc = laneSelect(mask, target, group.pc);
+                break;
+            }
+            case 1:    // ADD
+            case 5: {  // AND
+                unsigned short dr = getRaw(instruction, 9, 3);
+                LaneVector sr1 = group.registers[getRaw(instruction, 6, 3)];
+                LaneVector sr2 = instruction & (1 << 5) ? laneSplat(getAsNumber(instruction, 0, 5)) : group.registers[getRaw(instruction, 0, 3)];
+                LaneVector result = opcode == 1 ? laneAdd(sr1, sr2) : laneAnd(sr1, sr2);
+
+                group.registers[dr] = laneSelect(mask, result, group.registers[dr]);
+                group.cc = laneSelect(mask, laneConditionCodes(result), group.cc);
+                group.pc = laneSelect(mask, laneSplat(nextPc), group.pc);
+                break;
+            }
+            case 9: {  // NOT
+                unsigned short dr = getRaw(instruction, 9, 3);
+                LaneVector result = laneNot(group.registers[getRaw(instruction, 6, 3)]);
+
+                group.registers[dr] = laneSelect(mask, result, group.registers[dr]);
+                group.cc = laneSelect(mask, laneConditionCodes(result), group.cc);
+                group.pc = laneSelect(mask, laneSplat(nextPc), group.pc);
+                break;
+            }
+            case 14: {  // LEA
+                unsigned short dr = getRaw(instruction, 9, 3);
+                group.registers[dr] = laneSelect(mask, laneSplat(nextPc + getAsNumber(instruction, 0, 9)), group.registers[dr]);
+                group.pc = laneSelect(mask, laneSplat(nextPc), group.pc);
+                break;
+            }
+            case 12:  // JMP
+                group.pc = laneSelect(mask, group.registers[getRaw(instruction, 6, 3)], group.pc);
+                break;
+            case 4:  // JSR / JSRR
+                group.registers[7] = laneSelect(mask, laneSplat(nextPc), group.registers[7]);
+                if (getRaw(instruction, 11, 1)) {
+                    group.pc = laneSelect(mask, laneSplat(nextPc + getAsNumber(instruction, 0, 11)), group.pc);
+                } else {
+                    group.pc = laneSelect(mask, group.registers[getRaw(instruction, 6, 3)], group.pc);
+                }
+                break;
+            default:
+                // Memory accesses and traps touch per-lane memory and I/O
+                stepLanesScalar(&ctx, &group, states, match, opcode);
+                break;
+        }
+
+        group.cycles++;
+        stats.groupInstructions++;
+        stats.laneInstructions += __builtin_popcount(match);
+
+        // Traps halt, RTI and reserved opcodes fault
+        if (opcode == 15 || opcode == 8 || opcode == 13) {
+            for (unsigned int lanes = match; lanes != 0; lanes &= lanes - 1) {
+                int lane = __builtin_ctz(lanes);
+                if (states[lane]->haltSignal) {
+                    storeLane(&group, lane, states[lane]);
+                    group.active &= ~(1U << lane);
+                }
+            }
+        }
+
+        // All lanes in the group share the sampling schedule. Checking steps a lane ahead on its own, so a
+        // lane that turns out not to be stuck continues in scalar mode.
+        if (ctx.detectLoops && group.active != 0 && group.cycles >= states[__builtin_ctz(group.active)]->loop.nextSample) {
+            for (unsigned int lanes = group.active; lanes != 0; lanes &= lanes - 1) {
+                int lane = __builtin_ctz(lanes);
+                storeLane(&group, lane, states[lane]);
+
+                unsigned long long cycles = states[lane]->cycleCount;
+                int stuck = checkLaneLoop(&ctx, states[lane], &stats);
+                if (stuck || states[lane]->cycleCount != cycles) {
+                    group.active &= ~(1U << lane);
+                    diverged |= stuck ? 0 : 1U << lane;
+                }
+            }
+        }
+
+        if (ctx.maxCycleCount > 0 && group.cycles >= (unsigned long long)ctx.maxCycleCount) {
+            // Lanes that halted on this instruction have been stored already
+            for (unsigned int lanes = match & ~group.active & ~diverged; lanes != 0; lanes &= lanes - 1) {
+                stopLaneAtLimit(&ctx, states[__builtin_ctz(lanes)]);
+            }
+            break;
+        }
+    }
+
+    // Lanes that are still active ran into the cycle limit together
+    for (unsigned int lanes = group.active; lanes != 0; lanes &= lanes - 1) {
+        int lane = __builtin_ctz(lanes);
+        storeLane(&group, lane, states[lane]);
+        stopLaneAtLimit(&ctx, states[lane]);
+    }
+
+    for (unsigned int lanes = diverged; lanes != 0; lanes &= lanes - 1) {
+        int lane = __builtin_ctz(lanes);
+        stats.divergedLanes++;
+        runScalarLane(&ctx, states[lane], &stats);
+    }
+
+    return stats;
+}
+
+void printLockstepStats(LockstepStats stats, FILE *stream) {
+    double width = stats.groupInstructions > 0 ? (double)stats.laneInstructions / stats.groupInstructions : 0;
+    fprintf(stream, "Lockstep: %llu group instructions (%.2f lanes on average), %llu scalar instructions, %u diverged lanes\n",
+            stats.groupInstructions, width, stats.scalarInstructions, stats.divergedLanes);
+}
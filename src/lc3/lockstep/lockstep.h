@@ -0,0 +1,32 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include "../context/lc3context.h"
+#include "../emulator/lc3emulator.h"
+
+/*
+ * Lockstep engine: runs one program for up to LOCKSTEP_LANES independent states at the same time.
+ *
+ * Registers, pc and cc of all lanes are kept in structure-of-arrays form, so one decoded ALU or control
+ * instruction is applied to every lane that shares the pc with 16-bit SIMD operations (AVX2 or SSE2, with a
+ * scalar fallback). Memory accesses and traps are executed per lane by the regular step function.
+ * Lanes whose pc diverges leave the group and finish in scalar mode.
+ *
+ * All lanes must start from the same program image (their own copy of it). After running, a lane with a
+ * cleared haltSignal was found stuck (loop.detected, with ctx.detectLoops), one with LC3_STOP_SIGNAL
+ * reached the cycle limit like in emulate().
+ */
+#define LOCKSTEP_LANES 16
+
+typedef struct LockstepStats {
+    unsigned long long groupInstructions;  // Instructions decoded once for the whole group
+    unsigned long long laneInstructions;   // Instructions retired by lanes while in the group
+    unsigned long long scalarInstructions; // Instructions retired by lanes after diverging
+    unsigned int divergedLanes;
+} LockstepStats;
+
+LockstepStats runLockstep(LC3Context ctx, LC3EmulatorState **states, int count);
+
+void printLockstepStats(LockstepStats stats, FILE *stream);
+
+#endif // LOCKSTEP_H
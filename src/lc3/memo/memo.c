@@ -0,0 +1,616 @@
+#include "memo.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../hash/hash.h"
+#include "../emulator/lc3decode.h"
+#include "../emulator/lc3multicore.h"
+
+#define REGISTER_CC 8
+#define REGISTER_COUNT 9
+
+#define ACCESS_READ 1
+#define ACCESS_WRITTEN 2
+
+typedef struct MemoAccess {
+    unsigned short address;
+    unsigned char flags;        // 0 for an empty slot
+    unsigned short readValue;   // Value at the first access, when that was a read
+} MemoAccess;
+
+// A call in progress, with the locations it accessed so far
+typedef struct MemoFrame {
+    unsigned short target;
+    unsigned short returnAddress;
+    unsigned long long startCycle;
+    int impure;
+
+    unsigned short registerReads;  // Bit per register (and cc) read before being written
+    unsigned short registerWrites;
+    unsigned short registerInputs[REGISTER_COUNT];
+
+    MemoAccess* accesses;  // Open addressing by address
+    unsigned int accessCount;
+    unsigned int accessCapacity;
+} MemoFrame;
+
+typedef struct MemoEntry {
+    Hash64 hash;
+    unsigned short* inputs;  // Read registers in order, then the signature's memory addresses
+
+    unsigned short registerWrites;
+    unsigned short registerOutputs[REGISTER_COUNT];
+    unsigned int writeCount;
+    unsigned short* writeAddresses;
+    unsigned short* writeValues;
+
+    unsigned short finalPc;
+    unsigned long long cycles;
+} MemoEntry;
+
+// The calls to one target that read the same locations, by the hash of the values read
+typedef struct MemoSignature {
+    unsigned short registerReads;
+    unsigned int readCount;
+    unsigned short* readAddresses;  // Sorted
+    unsigned int inputCount;
+
+    MemoEntry** slots;
+    unsigned int entryCount;
+    unsigned int slotCapacity;
+
+    struct MemoSignature* next;
+} MemoSignature;
+
+struct MemoTable {
+    MemoSignature** signatures;  // By call target
+
+    MemoFrame frames[MEMO_MAX_DEPTH];
+    int depth;
+    int overflow;  // Calls nested deeper than the frames, whose RETs must not end a tracked call
+
+    unsigned char executed[65536 / 8];  // Addresses fetched as instructions, with the word that was fetched
+    unsigned short code[65536];
+
+    unsigned long long cycles;
+    MemoStats stats;
+};
+
+static inline Hash64 mixValue(Hash64 hash, unsigned short value) {
+    return (hash ^ value) * 0x100000001b3ULL;
+}
+
+static inline int isExecuted(MemoTable* table, unsigned short address) {
+    return (table->executed[address >> 3] >> (address & 7)) & 1;
+}
+
+static inline unsigned short readRegister(LC3EmulatorState* state, int r) {
+    return r == REGISTER_CC ? state->cc : (unsigned short)state->registers[r];
+}
+
+/* Cache entries */
+
+static void destroySignatures(MemoTable* table) {
+    for (int target = 0; target < 65536; target++) {
+        MemoSignature* signature = table->signatures[target];
+        while (signature != NULL) {
+            MemoSignature* next = signature->next;
+            for (unsigned int i = 0; i < signature->slotCapacity; i++) {
+                MemoEntry* entry = signature->slots[i];
+                if (entry != NULL) {
+                    free(entry->inputs);
+                    free(entry->writeAddresses);
+                    free(entry->writeValues);
+                    free(entry);
+                }
+            }
+            free(signature->slots);
+            free(signature->readAddresses);
+            free(signature);
+            signature = next;
+        }
+        table->signatures[target] = NULL;
+    }
+
+    table->stats.entries = 0;
+}
+
+// Drops every entry and every executed address, calls in progress can no longer be cached
+static void flushMemo(MemoTable* table) {
+    destroySignatures(table);
+    memset(table->executed, 0, sizeof(table->executed));
+
+    for (int i = 0; i < table->depth; i++) {
+        table->frames[i].impure = 1;
+    }
+}
+
+static Hash64 hashCurrentInputs(const MemoSignature* signature, LC3EmulatorState* state) {
+    Hash64 hash = HASH64_INITIAL;
+    for (int r = 0; r < REGISTER_COUNT; r++) {
+        if ((signature->registerReads >> r) & 1) {
+            hash = mixValue(hash, readRegister(state, r));
+        }
+    }
+    for (unsigned int i = 0; i < signature->readCount; i++) {
+        hash = mixValue(hash, state->memory[signature->readAddresses[i]].rawNumber);
+    }
+    return hash;
+}
+
+static int matchesCurrentInputs(const MemoSignature* signature, const MemoEntry* entry, LC3EmulatorState* state) {
+    unsigned int input = 0;
+    for (int r = 0; r < REGISTER_COUNT; r++) {
+        if ((signature->registerReads >> r) & 1 && entry->inputs[input++] != readRegister(state, r)) {
+            return 0;
+        }
+    }
+    for (unsigned int i = 0; i < signature->readCount; i++) {
+        if (entry->inputs[input++] != state->memory[signature->readAddresses[i]].rawNumber) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static MemoEntry* findEntry(MemoTable* table, LC3EmulatorState* state, unsigned short target, MemoSignature** found) {
+    for (MemoSignature* signature = table->signatures[target]; signature != NULL; signature = signature->next) {
+        Hash64 hash = hashCurrentInputs(signature, state);
+        unsigned int mask = signature->slotCapacity - 1;
+
+        for (unsigned int slot = hash & mask; signature->slots[slot] != NULL; slot = (slot + 1) & mask) {
+            MemoEntry* entry = signature->slots[slot];
+            if (entry->hash == hash && matchesCurrentInputs(signature, entry, state)) {
+                *found = signature;
+                return entry;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static void insertSlot(MemoSignature* signature, MemoEntry* entry) {
+    unsigned int mask = signature->slotCapacity - 1;
+    unsigned int slot = entry->hash & mask;
+    while (signature->slots[slot] != NULL) {
+        slot = (slot + 1) & mask;
+    }
+    signature->slots[slot] = entry;
+}
+
+static void addEntry(MemoSignature* signature, MemoEntry* entry) {
+    if ((signature->entryCount + 1) * 2 > signature->slotCapacity) {
+        MemoEntry** old = signature->slots;
+        unsigned int oldCapacity = signature->slotCapacity;
+
+        signature->slotCapacity *= 2;
+        signature->slots = calloc(signature->slotCapacity, sizeof(MemoEntry*));
+        for (unsigned int i = 0; i < oldCapacity; i++) {
+            if (old[i] != NULL) {
+                insertSlot(signature, old[i]);
+            }
+        }
+        free(old);
+    }
+
+    insertSlot(signature, entry);
+    signature->entryCount++;
+}
+
+/* Recording accesses of the innermost call */
+
+// Finds the slot of the address, or the empty slot it goes into. Grows the table first when inserting.
+static MemoAccess* findAccess(MemoFrame* frame, unsigned short address, int inserting) {
+    if (inserting && (frame->accessCount + 1) * 2 > frame->accessCapacity) {
+        MemoAccess* old = frame->accesses;
+        unsigned int oldCapacity = frame->accessCapacity;
+
+        frame->accessCapacity = oldCapacity == 0 ? 16 : oldCapacity * 2;
+        frame->accesses = calloc(frame->accessCapacity, sizeof(MemoAccess));
+        for (unsigned int i = 0; i < oldCapacity; i++) {
+            if (old[i].flags != 0) {
+                *findAccess(frame, old[i].address, 0) = old[i];
+            }
+        }
+        free(old);
+    }
+
+    unsigned int mask = frame->accessCapacity - 1;
+    unsigned int slot = (address * 0x9E37U) & mask;
+    while (frame->accesses[slot].flags != 0 && frame->accesses[slot].address != address) {
+        slot = (slot + 1) & mask;
+    }
+
+    return &frame->accesses[slot];
+}
+
+static void recordRegisterRead(MemoFrame* frame, int r, unsigned short value) {
+    unsigned short bit = 1 << r;
+    if (!((frame->registerReads | frame->registerWrites) & bit)) {
+        frame->registerReads |= bit;
+        frame->registerInputs[r] = value;
+    }
+}
+
+static void recordRegisterWrite(MemoFrame* frame, int r) {
+    frame->registerWrites |= 1 << r;
+}
+
+static void recordMemoryRead(MemoFrame* frame, unsigned short address, unsigned short value) {
+    MemoAccess* access = findAccess(frame, address, 1);
+    if (access->flags == 0) {
+        access->address = address;
+        access->flags = ACCESS_READ;
+        access->readValue = value;
+        frame->accessCount++;
+    }
+}
+
+static void recordMemoryWrite(MemoFrame* frame, unsigned short address) {
+    MemoAccess* access = findAccess(frame, address, 1);
+    if (access->flags == 0) {
+        access->address = address;
+        frame->accessCount++;
+    }
+    access->flags |= ACCESS_WRITTEN;
+}
+
+// Records what the instruction about to run reads and writes, from the state before it runs
+static void recordInstruction(MemoFrame* frame, LC3EmulatorState* state, unsigned short instruction) {
+    unsigned short opcode = getRaw(instruction, 12, 4);
+    unsigned short dr = getRaw(instruction, 9, 3);
+    unsigned short sr1 = getRaw(instruction, 6, 3);
+    LC3DataAccess access = decodeDataAccess(state, instruction);
+
+    switch (opcode) {
+        case 0:  // BR
+            if (dr != 0 && dr != 7) {
+                recordRegisterRead(frame, REGISTER_CC, state->cc);
+            }
+            break;
+        case 1:  // ADD
+        case 5:  // AND
+            recordRegisterRead(frame, sr1, state->registers[sr1]);
+            if (!(instruction & (1 << 5))) {
+                recordRegisterRead(frame, getRaw(instruction, 0, 3), state->registers[getRaw(instruction, 0, 3)]);
+            }
+            recordRegisterWrite(frame, dr);
+            recordRegisterWrite(frame, REGISTER_CC);
+            break;
+        case 9:  // NOT
+            recordRegisterRead(frame, sr1, state->registers[sr1]);
+            recordRegisterWrite(frame, dr);
+            recordRegisterWrite(frame, REGISTER_CC);
+            break;
+        case 2:   // LD
+        case 6:   // LDR
+        case 10:  // LDI
+            if (opcode == 6) {
+                recordRegisterRead(frame, sr1, state->registers[sr1]);
+            }
+            if (access.indirect) {
+                recordMemoryRead(frame, access.pointer, access.address);
+            }
+            recordMemoryRead(frame, access.address, state->memory[access.address].rawNumber);
+            recordRegisterWrite(frame, dr);
+            recordRegisterWrite(frame, REGISTER_CC);
+            break;
+        case 14:  // LEA
+            recordRegisterWrite(frame, dr);
+            break;
+        case 3:   // ST
+        case 7:   // STR
+        case 11:  // STI
+            recordRegisterRead(frame, dr, state->registers[dr]);
+            if (opcode == 7) {
+                recordRegisterRead(frame, sr1, state->registers[sr1]);
+            }
+            if (access.indirect) {
+                recordMemoryRead(frame, access.pointer, access.address);
+            }
+            recordMemoryWrite(frame, access.address);
+            break;
+        case 4:  // JSR, JSRR
+            if (!getRaw(instruction, 11, 1)) {
+                recordRegisterRead(frame, sr1, state->registers[sr1]);
+            }
+            recordRegisterWrite(frame, 7);
+            break;
+        case 12:  // JMP
+            recordRegisterRead(frame, sr1, state->registers[sr1]);
+            break;
+        case 15: {  // TRAP, the known ones do I/O, halt or depend on the core
+            unsigned short trapVector = getRaw(instruction, 0, 8);
+            if ((trapVector >= 0x20 && trapVector <= 0x25) || trapVector == LC3_TRAP_CORE || trapVector == LC3_TRAP_CAS) {
+                frame->impure = 1;
+            }
+            break;
+        }
+        default:  // RTI and the reserved opcode end the run
+            frame->impure = 1;
+            break;
+    }
+}
+
+// Adds the reads and writes of a finished (or replayed) call to its caller
+static void mergeAccesses(MemoFrame* caller, MemoFrame* callee) {
+    for (int r = 0; r < REGISTER_COUNT; r++) {
+        if ((callee->registerReads >> r) & 1) {
+            recordRegisterRead(caller, r, callee->registerInputs[r]);
+        }
+    }
+    for (unsigned int i = 0; i < callee->accessCapacity; i++) {
+        if (callee->accesses[i].flags & ACCESS_READ) {
+            recordMemoryRead(caller, callee->accesses[i].address, callee->accesses[i].readValue);
+        }
+    }
+
+    caller->registerWrites |= callee->registerWrites;
+    for (unsigned int i = 0; i < callee->accessCapacity; i++) {
+        if (callee->accesses[i].flags & ACCESS_WRITTEN) {
+            recordMemoryWrite(caller, callee->accesses[i].address);
+        }
+    }
+
+    caller->impure |= callee->impure;
+}
+
+static void mergeEntry(MemoFrame* caller, const MemoSignature* signature, const MemoEntry* entry) {
+    unsigned int input = 0;
+    for (int r = 0; r < REGISTER_COUNT; r++) {
+        if ((signature->registerReads >> r) & 1) {
+            recordRegisterRead(caller, r, entry->inputs[input++]);
+        }
+    }
+    for (unsigned int i = 0; i < signature->readCount; i++) {
+        recordMemoryRead(caller, signature->readAddresses[i], entry->inputs[input++]);
+    }
+
+    caller->registerWrites |= entry->registerWrites;
+    for (unsigned int i = 0; i < entry->writeCount; i++) {
+        recordMemoryWrite(caller, entry->writeAddresses[i]);
+    }
+}
+
+/* Calls */
+
+static int compareAddresses(const void* a, const void* b) {
+    return (int)*(const unsigned short*)a - (int)*(const unsigned short*)b;
+}
+
+static MemoSignature* findOrCreateSignature(MemoTable* table, MemoFrame* frame, unsigned short* readAddresses, unsigned int readCount) {
+    for (MemoSignature* signature = table->signatures[frame->target]; signature != NULL; signature = signature->next) {
+        if (signature->registerReads == frame->registerReads && signature->readCount == readCount &&
+            memcmp(signature->readAddresses, readAddresses, readCount * sizeof(unsigned short)) == 0) {
+            free(readAddresses);
+            return signature;
+        }
+    }
+
+    MemoSignature* signature = calloc(1, sizeof(MemoSignature));
+    signature->registerReads = frame->registerReads;
+    signature->readCount = readCount;
+    signature->readAddresses = readAddresses;
+    signature->inputCount = __builtin_popcount(frame->registerReads) + readCount;
+    signature->slotCapacity = 8;
+    signature->slots = calloc(signature->slotCapacity, sizeof(MemoEntry*));
+
+    signature->next = table->signatures[frame->target];
+    table->signatures[frame->target] = signature;
+    return signature;
+}
+
+static void storeEntry(MemoTable* table, MemoFrame* frame, LC3EmulatorState* state) {
+    unsigned short* readAddresses = malloc((frame->accessCount + 1) * sizeof(unsigned short));
+    unsigned int readCount = 0;
+    unsigned int writeCount = 0;
+    for (unsigned int i = 0; i < frame->accessCapacity; i++) {
+        if (frame->accesses[i].flags & ACCESS_READ) {
+            readAddresses[readCount++] = frame->accesses[i].address;
+        }
+        if (frame->accesses[i].flags & ACCESS_WRITTEN) {
+            writeCount++;
+        }
+    }
+    qsort(readAddresses, readCount, sizeof(unsigned short), compareAddresses);
+
+    MemoSignature* signature = findOrCreateSignature(table, frame, readAddresses, readCount);
+
+    MemoEntry* entry = calloc(1, sizeof(MemoEntry));
+    entry->inputs = malloc((signature->inputCount + 1) * sizeof(unsigned short));
+    entry->hash = HASH64_INITIAL;
+
+    unsigned int input = 0;
+    for (int r = 0; r < REGISTER_COUNT; r++) {
+        if ((frame->registerReads >> r) & 1) {
+            entry->inputs[input++] = frame->registerInputs[r];
+            entry->hash = mixValue(entry->hash, frame->registerInputs[r]);
+        }
+    }
+    for (unsigned int i = 0; i < readCount; i++) {
+        unsigned short value = findAccess(frame, signature->readAddresses[i], 0)->readValue;
+        entry->inputs[input++] = value;
+        entry->hash = mixValue(entry->hash, value);
+    }
+
+    entry->registerWrites = frame->registerWrites;
+    for (int r = 0; r < REGISTER_COUNT; r++) {
+        entry->registerOutputs[r] = readRegister(state, r);
+    }
+
+    entry->writeCount = writeCount;
+    entry->writeAddresses = malloc((writeCount + 1) * sizeof(unsigned short));
+    entry->writeValues = malloc((writeCount + 1) * sizeof(unsigned short));
+    unsigned int write = 0;
+    for (unsigned int i = 0; i < frame->accessCapacity; i++) {
+        if (frame->accesses[i].flags & ACCESS_WRITTEN) {
+            entry->writeAddresses[write] = frame->accesses[i].address;
+            entry->writeValues[write++] = state->memory[frame->accesses[i].address].rawNumber;
+        }
+    }
+
+    entry->finalPc = state->pc;
+    entry->cycles = table->cycles - frame->startCycle;
+
+    addEntry(signature, entry);
+    table->stats.entries++;
+}
+
+static void resetFrame(MemoFrame* frame) {
+    frame->impure = 0;
+    frame->registerReads = 0;
+    frame->registerWrites = 0;
+    frame->accessCount = 0;
+    if (frame->accessCapacity > 0) {
+        memset(frame->accesses, 0, frame->accessCapacity * sizeof(MemoAccess));
+    }
+}
+
+// Called right after a JSR/JSRR, replays the call when it is cached and fits in the budget (a call that would
+// cross the cycle limit is executed so the run stops inside it). Returns the instructions replayed.
+static int enterCall(MemoTable* table, LC3EmulatorState* state, unsigned long long budget) {
+    MemoSignature* signature = NULL;
+    MemoEntry* entry = findEntry(table, state, state->pc, &signature);
+
+    if (entry != NULL && entry->cycles <= budget) {
+        for (int r = 0; r < 8; r++) {
+            if ((entry->registerWrites >> r) & 1) {
+                state->registers[r] = entry->registerOutputs[r];
+            }
+        }
+        if ((entry->registerWrites >> REGISTER_CC) & 1) {
+            state->cc = entry->registerOutputs[REGISTER_CC];
+        }
+
+        int overwritesCode = 0;
+        for (unsigned int i = 0; i < entry->writeCount; i++) {
+            emulatorWriteMemory(state, entry->writeAddresses[i], entry->writeValues[i]);
+            overwritesCode |= isExecuted(table, entry->writeAddresses[i]);
+        }
+
+        state->pc = entry->finalPc;
+        table->cycles += entry->cycles;
+        table->stats.hits++;
+        table->stats.replayedCycles += entry->cycles;
+
+        unsigned long long cycles = entry->cycles;
+        if (table->depth > 0) {
+            mergeEntry(&table->frames[table->depth - 1], signature, entry);
+        }
+        if (overwritesCode) {
+            flushMemo(table);
+        }
+
+        return cycles;
+    }
+
+    // Calls nested deeper than the frame stack run untracked. A recursive call returns to the same address
+    // as its caller, so the deepest tracked call is not cached and its returns are matched by count.
+    if (table->depth == MEMO_MAX_DEPTH) {
+        table->overflow++;
+        table->frames[table->depth - 1].impure = 1;
+        return 0;
+    }
+
+    MemoFrame* frame = &table->frames[table->depth++];
+    resetFrame(frame);
+    frame->target = state->pc;
+    frame->returnAddress = state->registers[7];
+    frame->startCycle = table->cycles;
+
+    return 0;
+}
+
+static void completeCall(MemoTable* table, LC3EmulatorState* state) {
+    MemoFrame* frame = &table->frames[--table->depth];
+
+    if (frame->impure) {
+        table->stats.impureCalls++;
+    } else if (table->stats.entries < MEMO_MAX_ENTRIES) {
+        storeEntry(table, frame, state);
+        table->stats.recordedCalls++;
+    }
+
+    if (table->depth > 0) {
+        mergeAccesses(&table->frames[table->depth - 1], frame);
+    }
+}
+
+MemoTable* createMemoTable(void) {
+    MemoTable* table = calloc(1, sizeof(MemoTable));
+    table->signatures = calloc(65536, sizeof(MemoSignature*));
+    return table;
+}
+
+void destroyMemoTable(MemoTable* table) {
+    destroySignatures(table);
+    for (int i = 0; i < MEMO_MAX_DEPTH; i++) {
+        free(table->frames[i].accesses);
+    }
+    free(table->signatures);
+    free(table);
+}
+
+void memoBeginRun(MemoTable* table, LC3EmulatorState* state) {
+    table->depth = 0;
+    table->overflow = 0;
+
+    // Entries stay valid across runs of the same program, unless its code is different this time
+    for (int address = 0; address < 65536; address++) {
+        if (isExecuted(table, address) && table->code[address] != state->memory[address].rawNumber) {
+            flushMemo(table);
+            return;
+        }
+    }
+}
+
+int memoStep(MemoTable* table, LC3Context* ctx, LC3EmulatorState* state, unsigned long long budget) {
+    unsigned short pc = state->pc;
+    unsigned short instruction = state->memory[pc].rawNumber;
+    unsigned short opcode = getRaw(instruction, 12, 4);
+
+    // Code only changes through stores, which are checked against this
+    table->executed[pc >> 3] |= 1 << (pc & 7);
+    table->code[pc] = instruction;
+
+    MemoFrame* frame = table->depth > 0 ? &table->frames[table->depth - 1] : NULL;
+    if (frame != NULL) {
+        recordInstruction(frame, state, instruction);
+    }
+
+    LC3DataAccess access = decodeDataAccess(state, instruction);
+    int storeAddress = access.kind == LC3_DATA_STORE ? access.address : -1;
+
+    step(ctx, state);
+    table->cycles++;
+    int retired = 1;
+
+    if (storeAddress >= 0 && isExecuted(table, storeAddress)) {
+        flushMemo(table);
+    }
+
+    if (opcode == 4) {
+        retired += enterCall(table, state, budget > 0 ? budget - 1 : 0);
+    } else if (opcode == 12 && table->overflow > 0) {
+        // RET of an untracked call
+        if (getRaw(instruction, 6, 3) == 7) {
+            table->overflow--;
+        }
+    } else if (opcode == 12 && frame != NULL && state->pc == frame->returnAddress) {
+        completeCall(table, state);
+    }
+
+    return retired;
+}
+
+MemoStats memoGetStats(const MemoTable* table) {
+    return table->stats;
+}
+
+void printMemoStats(const MemoTable* table, FILE* stream) {
+    fprintf(stream, "Memoization: %llu hits replaying %llu cycles, %llu calls recorded, %llu impure calls, %u entries\n",
+            table->stats.hits, table->stats.replayedCycles, table->stats.recordedCalls, table->stats.impureCalls,
+            table->stats.entries);
+}
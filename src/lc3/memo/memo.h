@@ -0,0 +1,48 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include <stdio.h>
+
+#include "../context/lc3context.h"
+#include "../emulator/lc3emulator.h"
+
+/*
+ * Memoization of pure subroutine calls.
+ *
+ * Between a JSR/JSRR and the JMP that returns to the address after it, every register (and cc) and
+ * memory word the call reads before writing it is recorded with its value, together with everything
+ * it writes. A call without traps becomes a cache entry, keyed by its target and the values of its read
+ * set. When a later call to the same target finds all of those values in place, the recorded writes,
+ * final pc and cycle count are replayed instead of executing it.
+ *
+ * Nested calls add their reads and writes to the caller, so a caller is only cached when everything
+ * it called was pure too. Instruction words are part of what a call reads; a store to an executed
+ * address drops the whole cache instead of keying every entry on its code.
+ */
+#define MEMO_MAX_DEPTH 4096
+#define MEMO_MAX_ENTRIES (1 << 20)
+
+typedef struct MemoStats {
+    unsigned long long hits;
+    unsigned long long replayedCycles;
+    unsigned long long recordedCalls;
+    unsigned long long impureCalls;
+    unsigned int entries;
+} MemoStats;
+
+typedef struct MemoTable MemoTable;
+
+MemoTable* createMemoTable(void);
+void destroyMemoTable(MemoTable* table);
+
+// Called by emulate() before a run, active calls of a previous run are dropped
+void memoBeginRun(MemoTable* table, LC3EmulatorState* state);
+
+// Runs the instruction at the pc (or a whole cached call that fits in the cycle budget), returns the number of
+// instructions retired
+int memoStep(MemoTable* table, LC3Context* ctx, LC3EmulatorState* state, unsigned long long budget);
+
+MemoStats memoGetStats(const MemoTable* table);
+void printMemoStats(const MemoTable* table, FILE* stream);
+
+#endif // MEMO_H
@@ -0,0 +1,221 @@
+#include "cachemodel.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char* REPLACEMENT_NAMES[] = {"LRU", "FIFO", "random"};
+
+static int isPowerOfTwo(unsigned int value) {
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+static int parseOption(const char* key, const char* value, CacheConfig* config) {
+    char* end;
+    unsigned long number = strtoul(value, &end, 10);
+    int isNumber = *value != '\0' && *end == '\0';
+
+    if (strcmp(key, "size") == 0 && isNumber) {
+        config->size = number;
+    } else if (strcmp(key, "ways") == 0 && isNumber) {
+        config->ways = number;
+    } else if (strcmp(key, "line") == 0 && isNumber) {
+        config->line = number;
+    } else if (strcmp(key, "penalty") == 0 && isNumber) {
+        config->missPenalty = number;
+    } else if (strcmp(key, "replace") == 0 && strcmp(value, "lru") == 0) {
+        config->replacement = CACHE_LRU;
+    } else if (strcmp(key, "replace") == 0 && strcmp(value, "fifo") == 0) {
+        config->replacement = CACHE_FIFO;
+    } else if (strcmp(key, "replace") == 0 && strcmp(value, "random") == 0) {
+        config->replacement = CACHE_RANDOM;
+    } else if (strcmp(key, "write") == 0 && strcmp(value, "back") == 0) {
+        config->write = CACHE_WRITE_BACK;
+    } else if (strcmp(key, "write") == 0 && strcmp(value, "through") == 0) {
+        config->write = CACHE_WRITE_THROUGH;
+    } else {
+        return 0;
+    }
+
+    return 1;
+}
+
+int parseCacheConfig(const char* specification, CacheConfig* config) {
+    *config = (CacheConfig){1024, 2, 8, CACHE_LRU, CACHE_WRITE_BACK, 10};
+
+    char* copy = strdup(specification);
+    for (char* option = strtok(copy, ","); option != NULL; option = strtok(NULL, ",")) {
+        char* value = strchr(option, '=');
+        if (value != NULL) {
+            *value++ = '\0';
+        }
+
+        if (value == NULL || !parseOption(option, value, config)) {
+            fprintf(stderr, "Invalid cache option: %s\n", option);
+            free(copy);
+            return 0;
+        }
+    }
+    free(copy);
+
+    // Divided instead of multiplied, ways * line can wrap around
+    if (!isPowerOfTwo(config->size) || !isPowerOfTwo(config->ways) || !isPowerOfTwo(config->line) ||
+        config->size > 65536 || config->ways > config->size || config->line > config->size / config->ways) {
+        fprintf(stderr, "Cache size, ways and line have to be powers of two, with ways * line <= size <= 65536\n");
+        return 0;
+    }
+
+    return 1;
+}
+
+static Cache* createCache(const char* name, const CacheConfig* config) {
+    Cache* cache = calloc(1, sizeof(Cache));
+    cache->name = name;
+    cache->config = *config;
+    cache->sets = config->size / (config->ways * config->line);
+    cache->lines = calloc(config->size / config->line, sizeof(CacheLine));
+    cache->random = 0x9E3779B97F4A7C15ULL;
+
+    while ((1U << cache->lineShift) < config->line) {
+        cache->lineShift++;
+    }
+
+    return cache;
+}
+
+static CacheLine* findVictim(Cache* cache, CacheLine* set) {
+    unsigned int ways = cache->config.ways;
+    for (unsigned int i = 0; i < ways; i++) {
+        if (!set[i].valid) {
+            return &set[i];
+        }
+    }
+
+    if (cache->config.replacement == CACHE_RANDOM) {
+        cache->random ^= cache->random << 13;
+        cache->random ^= cache->random >> 7;
+        cache->random ^= cache->random << 17;
+        return &set[cache->random % ways];
+    }
+
+    // LRU stamps every use, FIFO only the fill
+    CacheLine* victim = &set[0];
+    for (unsigned int i = 1; i < ways; i++) {
+        if (set[i].stamp < victim->stamp) {
+            victim = &set[i];
+        }
+    }
+    return victim;
+}
+
+static void cacheAccess(Cache* cache, unsigned short address, int write) {
+    unsigned short block = address >> cache->lineShift;
+    CacheLine* set = &cache->lines[(block & (cache->sets - 1)) * cache->config.ways];
+    int writeThrough = cache->config.write == CACHE_WRITE_THROUGH;
+
+    cache->clock++;
+    if (write) {
+        cache->writes++;
+        if (writeThrough) {
+            cache->memoryWrites++;
+        }
+    } else {
+        cache->reads++;
+    }
+
+    for (unsigned int i = 0; i < cache->config.ways; i++) {
+        if (set[i].valid && set[i].block == block) {
+            if (cache->config.replacement == CACHE_LRU) {
+                set[i].stamp = cache->clock;
+            }
+            if (write && !writeThrough) {
+                set[i].dirty = 1;
+            }
+            return;
+        }
+    }
+
+    if (write) {
+        cache->writeMisses++;
+        if (writeThrough) {
+            // No write allocate, the word only goes to memory
+            return;
+        }
+    } else {
+        cache->readMisses++;
+    }
+
+    CacheLine* victim = findVictim(cache, set);
+    if (victim->valid && victim->dirty) {
+        cache->memoryWrites++;
+    }
+
+    *victim = (CacheLine){block, 1, write && !writeThrough, cache->clock};
+    cache->fills++;
+}
+
+static void observeAccess(void* data, unsigned short address, LC3AccessKind kind) {
+    CacheModel* model = data;
+    if (kind == LC3_ACCESS_FETCH) {
+        if (model->instruction != NULL) {
+            cacheAccess(model->instruction, address, 0);
+        }
+    } else if (model->data != NULL) {
+        cacheAccess(model->data, address, kind == LC3_ACCESS_WRITE);
+    }
+}
+
+CacheModel* createCacheModel(const CacheConfig* instruction, const CacheConfig* data) {
+    CacheModel* model = calloc(1, sizeof(CacheModel));
+    model->instruction = instruction != NULL ? createCache("I-cache", instruction) : NULL;
+    model->data = data != NULL ? createCache("D-cache", data) : NULL;
+    model->observer = (LC3MemoryObserver){observeAccess, model};
+    return model;
+}
+
+static void destroyCache(Cache* cache) {
+    if (cache != NULL) {
+        free(cache->lines);
+        free(cache);
+    }
+}
+
+void destroyCacheModel(CacheModel* model) {
+    destroyCache(model->instruction);
+    destroyCache(model->data);
+    free(model);
+}
+
+unsigned long long cacheStallCycles(const Cache* cache) {
+    return (cache->fills + cache->memoryWrites) * cache->config.missPenalty;
+}
+
+static double percentOf(unsigned long long part, unsigned long long whole) {
+    return whole != 0 ? 100.0 * part / whole : 0.0;
+}
+
+static void printCache(const Cache* cache, FILE* stream) {
+    const CacheConfig* config = &cache->config;
+    unsigned long long accesses = cache->reads + cache->writes;
+    unsigned long long misses = cache->readMisses + cache->writeMisses;
+
+    fprintf(stream, "%s: %u words, %u-way, %u-word lines, %s, write-%s, %u cycle penalty\n", cache->name, config->size, config->ways,
+            config->line, REPLACEMENT_NAMES[config->replacement], config->write == CACHE_WRITE_BACK ? "back" : "through", config->missPenalty);
+    fprintf(stream, "  %16llu  accesses, %.2f%% hits\n", accesses, percentOf(accesses - misses, accesses));
+    fprintf(stream, "  %16llu  read misses of %llu reads (%.2f%%)\n", cache->readMisses, cache->reads, percentOf(cache->readMisses, cache->reads));
+    if (cache->writes != 0) {
+        fprintf(stream, "  %16llu  write misses of %llu writes (%.2f%%)\n", cache->writeMisses, cache->writes, percentOf(cache->writeMisses, cache->writes));
+    }
+    fprintf(stream, "  %16llu  lines filled, %llu writes to memory\n", cache->fills, cache->memoryWrites);
+    fprintf(stream, "  %16llu  stall cycles\n", cacheStallCycles(cache));
+}
+
+void printCacheModel(const CacheModel* model, FILE* stream) {
+    fprintf(stream, "\n===========\n");
+    if (model->instruction != NULL) {
+        printCache(model->instruction, stream);
+    }
+    if (model->data != NULL) {
+        printCache(model->data, stream);
+    }
+    fprintf(stream, "===========\n");
+}
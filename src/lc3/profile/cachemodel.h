@@ -0,0 +1,82 @@
+#ifndef CACHE_MODEL_H
+#define CACHE_MODEL_H
+
+#include <stdio.h>
+
+#include "../emulator/lc3access.h"
+
+/*
+ * Simulated instruction and data caches (--icache, --dcache), fed by a memory access observer.
+ *
+ * Each cache is set-associative, sized in LC-3 words: size, ways and line are powers of two. A line is
+ * replaced by LRU, FIFO or a pseudo-random choice (the same on every run). Write-back caches allocate on
+ * a write miss and write a dirty line to memory when it is evicted, write-through caches send every
+ * store to memory and do not allocate on a write miss.
+ *
+ * Every line filled from memory and every word or line written to memory stalls for the miss penalty,
+ * hits are free. Caches start empty and stay warm between batch cases.
+ */
+typedef enum {
+    CACHE_LRU,
+    CACHE_FIFO,
+    CACHE_RANDOM,
+} CacheReplacement;
+
+typedef enum {
+    CACHE_WRITE_BACK,
+    CACHE_WRITE_THROUGH,
+} CacheWritePolicy;
+
+typedef struct CacheConfig {
+    unsigned int size;  // Words
+    unsigned int ways;
+    unsigned int line;  // Words
+    CacheReplacement replacement;
+    CacheWritePolicy write;
+    unsigned int missPenalty;  // Cycles
+} CacheConfig;
+
+typedef struct CacheLine {
+    unsigned short block;  // Address >> line shift
+    unsigned char valid;
+    unsigned char dirty;
+    unsigned long long stamp;  // Last use (LRU) or fill (FIFO)
+} CacheLine;
+
+typedef struct Cache {
+    const char* name;
+    CacheConfig config;
+    unsigned int lineShift;
+    unsigned int sets;
+    CacheLine* lines;  // sets * ways, a set is contiguous
+
+    unsigned long long clock;
+    unsigned long long random;  // xorshift state for CACHE_RANDOM
+
+    unsigned long long reads;
+    unsigned long long writes;
+    unsigned long long readMisses;
+    unsigned long long writeMisses;
+    unsigned long long fills;         // Lines read from memory
+    unsigned long long memoryWrites;  // Write-backs, or stores written through
+} Cache;
+
+typedef struct CacheModel {
+    Cache* instruction;  // Sees fetches, NULL when not modeled
+    Cache* data;         // Sees loads and stores, NULL when not modeled
+    LC3MemoryObserver observer;
+} CacheModel;
+
+// Fills in the configuration from "size=1024,ways=2,line=8,replace=lru,write=back,penalty=10", keys may be
+// left out for their defaults. Returns 0 and prints why when the specification is invalid.
+int parseCacheConfig(const char* specification, CacheConfig* config);
+
+// Either configuration may be NULL
+CacheModel* createCacheModel(const CacheConfig* instruction, const CacheConfig* data);
+void destroyCacheModel(CacheModel* model);
+
+unsigned long long cacheStallCycles(const Cache* cache);
+
+void printCacheModel(const CacheModel* model, FILE* stream);
+
+#endif // CACHE_MODEL_H
@@ -0,0 +1,180 @@
+#include "callprofile.h"
+
+#include <stdlib.h>
+
+#include "../image/lc3image.h"
+
+CallProfile* createCallProfile(void) {
+    CallProfile* profile = calloc(1, sizeof(CallProfile));
+    profile->stats = calloc(65536, sizeof(CallStats));
+
+    profile->nodeCapacity = 256;
+    profile->nodes = malloc(profile->nodeCapacity * sizeof(CallNode));
+    profile->nodes[0] = (CallNode){0, -1, -1, -1, 0};
+    profile->nodeCount = 1;
+
+    return profile;
+}
+
+void destroyCallProfile(CallProfile* profile) {
+    free(profile->stats);
+    free(profile->nodes);
+    free(profile->frames);
+    free(profile);
+}
+
+static int childNode(CallProfile* profile, int parent, unsigned short address) {
+    for (int child = profile->nodes[parent].firstChild; child >= 0; child = profile->nodes[child].nextSibling) {
+        if (profile->nodes[child].address == address) {
+            return child;
+        }
+    }
+
+    if (profile->nodeCount == profile->nodeCapacity) {
+        profile->nodeCapacity *= 2;
+        profile->nodes = realloc(profile->nodes, profile->nodeCapacity * sizeof(CallNode));
+    }
+
+    int node = profile->nodeCount++;
+    profile->nodes[node] = (CallNode){address, parent, -1, profile->nodes[parent].firstChild, 0};
+    profile->nodes[parent].firstChild = node;
+    return node;
+}
+
+static void pushFrame(CallProfile* profile, unsigned short address, unsigned short returnAddress) {
+    if (profile->depth == profile->frameCapacity) {
+        profile->frameCapacity = profile->frameCapacity == 0 ? 64 : profile->frameCapacity * 2;
+        profile->frames = realloc(profile->frames, profile->frameCapacity * sizeof(CallFrame));
+    }
+
+    int node;
+    if (profile->depth == 0) {
+        node = childNode(profile, 0, address);
+    } else if (profile->depth < CALL_PROFILE_MAX_DEPTH) {
+        node = childNode(profile, profile->frames[profile->depth - 1].node, address);
+    } else {
+        node = profile->frames[profile->depth - 1].node;
+    }
+
+    profile->frames[profile->depth++] = (CallFrame){address, returnAddress, node, profile->cycle};
+    if (profile->depth > profile->maxDepth) {
+        profile->maxDepth = profile->depth;
+    }
+
+    CallStats* stats = &profile->stats[address];
+    stats->calls++;
+    stats->active++;
+}
+
+static void popFrame(CallProfile* profile) {
+    CallFrame* frame = &profile->frames[--profile->depth];
+    CallStats* stats = &profile->stats[frame->address];
+
+    // Only the outermost frame of a recursion adds its cycles
+    if (--stats->active == 0) {
+        stats->inclusive += profile->cycle - frame->entryCycle;
+    }
+}
+
+void callProfileBegin(CallProfile* profile, const LC3EmulatorState* state) {
+    profile->image = state->image;
+    pushFrame(profile, state->pc, 0);
+}
+
+void callProfileEnd(CallProfile* profile) {
+    while (profile->depth > 0) {
+        popFrame(profile);
+    }
+}
+
+void callProfileRecord(CallProfile* profile, const LC3EmulatorState* state, unsigned short pc, unsigned short instruction) {
+    CallFrame* top = &profile->frames[profile->depth - 1];
+    profile->stats[top->address].exclusive++;
+    profile->nodes[top->node].cycles++;
+    profile->cycle++;
+
+    if ((instruction >> 12) == 4) {
+        pushFrame(profile, state->pc, pc + 1);
+    } else if (instruction == 0xC1C0) {
+        // The entry frame is never returned from
+        for (unsigned int i = profile->depth; i > 1; i--) {
+            if (profile->frames[i - 1].returnAddress == state->pc) {
+                while (profile->depth >= i) {
+                    popFrame(profile);
+                }
+                break;
+            }
+        }
+    }
+}
+
+static void printName(const CallProfile* profile, unsigned short address, FILE* stream) {
+    const LC3Symbol* symbol = profile->image != NULL ? imageSymbolAt(profile->image, address) : NULL;
+    if (symbol == NULL) {
+        fprintf(stream, "x%04x", address);
+    } else if (symbol->address == address) {
+        fprintf(stream, "%s", symbol->name);
+    } else {
+        fprintf(stream, "%s+%d", symbol->name, address - symbol->address);
+    }
+}
+
+typedef struct CallEntry {
+    unsigned short address;
+    CallStats stats;
+} CallEntry;
+
+static int compareInclusive(const void* a, const void* b) {
+    const CallStats* left = &((const CallEntry*)a)->stats;
+    const CallStats* right = &((const CallEntry*)b)->stats;
+    if (left->inclusive != right->inclusive) {
+        return left->inclusive < right->inclusive ? 1 : -1;
+    }
+    if (left->exclusive != right->exclusive) {
+        return left->exclusive < right->exclusive ? 1 : -1;
+    }
+    return ((const CallEntry*)a)->address - ((const CallEntry*)b)->address;
+}
+
+void callProfileReport(const CallProfile* profile, FILE* stream) {
+    CallEntry* entries = malloc(65536 * sizeof(CallEntry));
+    unsigned int count = 0;
+    for (unsigned int address = 0; address < 65536; address++) {
+        if (profile->stats[address].calls > 0) {
+            entries[count++] = (CallEntry){address, profile->stats[address]};
+        }
+    }
+
+    qsort(entries, count, sizeof(CallEntry), compareInclusive);
+
+    double total = profile->cycle > 0 ? (double)profile->cycle : 1;
+    fprintf(stream, "\n===========\nCall profile: %llu cycles, maximum depth %u\n", profile->cycle, profile->maxDepth);
+    fprintf(stream, "%14s %7s %14s %7s %10s  %s\n", "Inclusive", "", "Exclusive", "", "Calls", "Subroutine");
+    for (unsigned int i = 0; i < count; i++) {
+        const CallStats* stats = &entries[i].stats;
+        fprintf(stream, "%14llu %6.2f%% %14llu %6.2f%% %10llu  ", stats->inclusive, 100 * stats->inclusive / total,
+                stats->exclusive, 100 * stats->exclusive / total, stats->calls);
+        printName(profile, entries[i].address, stream);
+        fprintf(stream, " (x%04x)\n", entries[i].address);
+    }
+    fprintf(stream, "===========\n");
+
+    free(entries);
+}
+
+static void printStack(const CallProfile* profile, int node, FILE* stream) {
+    if (profile->nodes[node].parent > 0) {
+        printStack(profile, profile->nodes[node].parent, stream);
+        fputc(';', stream);
+    }
+    printName(profile, profile->nodes[node].address, stream);
+}
+
+void callProfileWriteFolded(const CallProfile* profile, FILE* stream) {
+    for (unsigned int node = 1; node < profile->nodeCount; node++) {
+        if (profile->nodes[node].cycles > 0) {
+            printStack(profile, node, stream);
+            fprintf(stream, " %llu\n", profile->nodes[node].cycles);
+        }
+    }
+}
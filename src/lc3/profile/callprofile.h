@@ -0,0 +1,73 @@
+#ifndef CALL_PROFILE_H
+#define CALL_PROFILE_H
+
+#include <stdio.h>
+
+#include "../emulator/lc3emulator.h"
+
+/*
+ * Attributes the cycles of a run to its subroutines, following JSR/JSRR and RET (JMP R7).
+ *
+ * A RET returns to the innermost frame whose return address it jumps to, unwinding any frame in between
+ * (a subroutine that left without RET). A RET to no return address on the stack is an ordinary jump.
+ * Subroutines are named by the label at their entry (or the closest one before it, as label+offset).
+ *
+ * Inclusive cycles of a recursive subroutine only count its outermost frame. Calls nested deeper than
+ * CALL_PROFILE_MAX_DEPTH are still counted, but their cycles are folded into the deepest stack.
+ */
+#define CALL_PROFILE_MAX_DEPTH 1024
+
+typedef struct CallNode {
+    unsigned short address;  // Entry of the subroutine
+    int parent;              // Node 0 is the root above the entry point of each run
+    int firstChild;
+    int nextSibling;
+    unsigned long long cycles;  // Spent in this exact stack
+} CallNode;
+
+typedef struct CallFrame {
+    unsigned short address;
+    unsigned short returnAddress;
+    int node;
+    unsigned long long entryCycle;
+} CallFrame;
+
+typedef struct CallStats {
+    unsigned long long calls;
+    unsigned long long inclusive;
+    unsigned long long exclusive;
+    unsigned int active;  // Frames on the stack
+} CallStats;
+
+typedef struct CallProfile {
+    const LC3Image* image;  // For names, NULL when running a .bin
+    unsigned long long cycle;
+    unsigned int maxDepth;
+
+    CallStats* stats;  // By entry address
+    CallNode* nodes;
+    unsigned int nodeCount;
+    unsigned int nodeCapacity;
+
+    CallFrame* frames;
+    unsigned int depth;
+    unsigned int frameCapacity;
+} CallProfile;
+
+CallProfile* createCallProfile(void);
+void destroyCallProfile(CallProfile* profile);
+
+// Enters the run at its current pc, profiles of consecutive runs (batch cases) add up
+void callProfileBegin(CallProfile* profile, const LC3EmulatorState* state);
+void callProfileEnd(CallProfile* profile);
+
+// Called after each executed instruction with the pc it was at
+void callProfileRecord(CallProfile* profile, const LC3EmulatorState* state, unsigned short pc, unsigned short instruction);
+
+// Inclusive and exclusive cycles, calls and the maximum depth, by inclusive cycles
+void callProfileReport(const CallProfile* profile, FILE* stream);
+
+// One "caller;callee;... cycles" line per stack, the folded format flame graph tools read
+void callProfileWriteFolded(const CallProfile* profile, FILE* stream);
+
+#endif // CALL_PROFILE_H
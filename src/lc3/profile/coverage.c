@@ -0,0 +1,220 @@
+#include "coverage.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "../image/lc3image.h"
+
+#define COVERAGE_MAGIC 0x4f43334cU  // "LC3O"
+#define COVERAGE_FORMAT_VERSION 1
+
+Coverage* createCoverage(void) {
+    return calloc(1, sizeof(Coverage));
+}
+
+void destroyCoverage(Coverage* coverage) {
+    free(coverage);
+}
+
+void coverageBegin(Coverage* coverage, const LC3EmulatorState* state) {
+    if (state->image == NULL) {
+        coverage->program = hashBytes(HASH64_INITIAL, state->memory, 65536 * sizeof(MemoryCell));
+        return;
+    }
+
+    // The assembled words only, the rest of memory differs between randomized runs
+    const LC3Image* image = state->image;
+    Hash64 hash = hashBytes(HASH64_INITIAL, image->emitted, sizeof(image->emitted));
+    for (int address = 0; address < 65536; address++) {
+        if (imageIsEmitted(image, address)) {
+            hash = hashInt(hash, image->memory[address].rawNumber);
+        }
+    }
+    coverage->program = hash;
+}
+
+static int readCoverage(Coverage* coverage, FILE* stream) {
+    unsigned int header[2] = {0};
+    Coverage stored;
+    if (fread(header, sizeof(unsigned int), 2, stream) != 2 || header[0] != COVERAGE_MAGIC || header[1] != COVERAGE_FORMAT_VERSION ||
+        fread(&stored, sizeof(Coverage), 1, stream) != 1 || stored.program != coverage->program) {
+        return 0;
+    }
+
+    for (int i = 0; i < 65536 / 8; i++) {
+        coverage->executed[i] |= stored.executed[i];
+        coverage->taken[i] |= stored.taken[i];
+        coverage->notTaken[i] |= stored.notTaken[i];
+    }
+
+    return 1;
+}
+
+int coverageMerge(Coverage* coverage, const char* path) {
+    // Runs over a test suite may finish at the same time, the lock file serializes the read-modify-write
+    char lockPath[4096 + 8];
+    snprintf(lockPath, sizeof(lockPath), "%s.lock", path);
+    int lock = open(lockPath, O_RDWR | O_CREAT, 0666);
+    if (lock < 0 || flock(lock, LOCK_EX) != 0) {
+        if (lock >= 0) {
+            close(lock);
+        }
+        return 0;
+    }
+
+    FILE* existing = fopen(path, "rb");
+    if (existing != NULL) {
+        if (!readCoverage(coverage, existing)) {
+            fprintf(stderr, "Replacing the coverage of another program in %s\n", path);
+        }
+        fclose(existing);
+    }
+
+    char temporaryPath[4096 + 32];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp.%ld", path, (long)getpid());
+
+    int ok = 0;
+    FILE* output = fopen(temporaryPath, "wb");
+    if (output != NULL) {
+        unsigned int header[2] = {COVERAGE_MAGIC, COVERAGE_FORMAT_VERSION};
+        fwrite(header, sizeof(unsigned int), 2, output);
+        fwrite(coverage, sizeof(Coverage), 1, output);
+        ok = fclose(output) == 0 && rename(temporaryPath, path) == 0;
+        if (!ok) {
+            unlink(temporaryPath);
+        }
+    }
+
+    flock(lock, LOCK_UN);
+    close(lock);
+
+    return ok;
+}
+
+static int hasBit(const unsigned char* bitmap, unsigned short address) {
+    return (bitmap[address >> 3] >> (address & 7)) & 1;
+}
+
+// BRn, BRz, BRp and their pairs, BRnzp always branches
+static int isConditional(unsigned short instruction) {
+    unsigned short nzp = (instruction >> 9) & 7;
+    return (instruction >> 12) == 0 && nzp != 0 && nzp != 7;
+}
+
+static double percent(unsigned int part, unsigned int total) {
+    return total > 0 ? 100.0 * part / total : 100.0;
+}
+
+static void printLocation(const LC3Image* image, unsigned short address, FILE* stream) {
+    const LC3Symbol* symbol = imageSymbolAt(image, address);
+    fprintf(stream, "x%04x", address);
+    if (symbol != NULL && symbol->address == address) {
+        fprintf(stream, " (%s)", symbol->name);
+    } else if (symbol != NULL) {
+        fprintf(stream, " (%s+%d)", symbol->name, address - symbol->address);
+    }
+}
+
+typedef struct CoverageCounts {
+    unsigned int instructions;
+    unsigned int executed;
+    unsigned int directions;
+    unsigned int coveredDirections;
+} CoverageCounts;
+
+static void printCounts(const char* name, CoverageCounts counts, FILE* stream) {
+    fprintf(stream, "%-24s %6u/%-6u %6.2f%%", name, counts.executed, counts.instructions, percent(counts.executed, counts.instructions));
+    if (counts.directions > 0) {
+        fprintf(stream, "  %6u/%-6u %6.2f%%", counts.coveredDirections, counts.directions,
+                percent(counts.coveredDirections, counts.directions));
+    }
+    fprintf(stream, "\n");
+}
+
+void coverageReport(const Coverage* coverage, const LC3Image* image, FILE* stream) {
+    fprintf(stream, "\n===========\n");
+
+    if (image == NULL) {
+        unsigned int executed = 0;
+        for (int i = 0; i < 65536 / 8; i++) {
+            executed += __builtin_popcount(coverage->executed[i]);
+        }
+        fprintf(stream, "Coverage: %u addresses executed, no source to report against\n===========\n", executed);
+        return;
+    }
+
+    CoverageCounts total = {0};
+    CoverageCounts* perSymbol = calloc(image->symbolCount + 1, sizeof(CoverageCounts));  // The last one is code before any label
+
+    for (int address = 0; address < 65536; address++) {
+        if (!imageIsCode(image, address)) {
+            continue;
+        }
+
+        const LC3Symbol* symbol = imageSymbolAt(image, address);
+        CoverageCounts* counts = &perSymbol[symbol != NULL ? (unsigned int)(symbol - image->symbols) : image->symbolCount];
+
+        int executed = hasBit(coverage->executed, address);
+        counts->instructions++;
+        counts->executed += executed;
+
+        if (isConditional(image->memory[address].rawNumber)) {
+            counts->directions += 2;
+            counts->coveredDirections += hasBit(coverage->taken, address) + hasBit(coverage->notTaken, address);
+        }
+    }
+
+    for (unsigned int i = 0; i <= image->symbolCount; i++) {
+        total.instructions += perSymbol[i].instructions;
+        total.executed += perSymbol[i].executed;
+        total.directions += perSymbol[i].directions;
+        total.coveredDirections += perSymbol[i].coveredDirections;
+    }
+
+    fprintf(stream, "Coverage: %u/%u instructions (%.2f%%), %u/%u branch directions (%.2f%%)\n\n", total.executed, total.instructions,
+            percent(total.executed, total.instructions), total.coveredDirections, total.directions,
+            percent(total.coveredDirections, total.directions));
+
+    fprintf(stream, "%-24s %21s  %21s\n", "Label", "Instructions", "Branch directions");
+    if (perSymbol[image->symbolCount].instructions > 0) {
+        printCounts("(start)", perSymbol[image->symbolCount], stream);
+    }
+    for (unsigned int i = 0; i < image->symbolCount; i++) {
+        if (perSymbol[i].instructions > 0) {
+            printCounts(image->symbols[i].name, perSymbol[i], stream);
+        }
+    }
+
+    int header = 0;
+    for (int address = 0; address < 65536; address++) {
+        if (!imageIsCode(image, address)) {
+            continue;
+        }
+
+        const char* missing = NULL;
+        if (!hasBit(coverage->executed, address)) {
+            missing = "not executed";
+        } else if (isConditional(image->memory[address].rawNumber) && !hasBit(coverage->taken, address)) {
+            missing = "branch never taken";
+        } else if (isConditional(image->memory[address].rawNumber) && !hasBit(coverage->notTaken, address)) {
+            missing = "branch always taken";
+        }
+
+        if (missing != NULL) {
+            if (!header) {
+                fprintf(stream, "\nNot covered:\n");
+                header = 1;
+            }
+
+            fprintf(stream, "  line %4u  ", image->lines[address]);
+            printLocation(image, address, stream);
+            fprintf(stream, "  %s\n", missing);
+        }
+    }
+
+    fprintf(stream, "===========\n");
+    free(perSymbol);
+}
@@ -0,0 +1,45 @@
+#ifndef COVERAGE_H
+#define COVERAGE_H
+
+#include <stdio.h>
+
+#include "../../hash/hash.h"
+#include "../emulator/lc3emulator.h"
+
+/*
+ * Which instructions ran, and which way each conditional BR went, as bitmaps over the address space.
+ *
+ * Coverage is merged into a file by OR-ing the bitmaps, so a whole test suite is accumulated by pointing
+ * every run at the same file. The file is tied to the program (a hash of its assembled words), coverage
+ * of another program replaces it instead of being merged.
+ */
+typedef struct Coverage {
+    Hash64 program;
+    unsigned char executed[65536 / 8];
+    unsigned char taken[65536 / 8];     // BRs that branched
+    unsigned char notTaken[65536 / 8];  // BRs that fell through
+} Coverage;
+
+Coverage* createCoverage(void);
+void destroyCoverage(Coverage* coverage);
+
+// Identifies the program, from the image when there is one
+void coverageBegin(Coverage* coverage, const LC3EmulatorState* state);
+
+// Called before each executed instruction
+static inline void coverageRecord(Coverage* coverage, unsigned short pc, unsigned short instruction, unsigned short cc) {
+    unsigned char bit = 1 << (pc & 7);
+    coverage->executed[pc >> 3] |= bit;
+    if ((instruction >> 12) == 0) {
+        unsigned char* direction = ((instruction >> 9) & cc) ? coverage->taken : coverage->notTaken;
+        direction[pc >> 3] |= bit;
+    }
+}
+
+// ORs the coverage already stored in the file (if any, of the same program) into this one and rewrites it, returns 0 on failure
+int coverageMerge(Coverage* coverage, const char* path);
+
+// Totals, then per label and every source line that is not fully covered
+void coverageReport(const Coverage* coverage, const LC3Image* image, FILE* stream);
+
+#endif // COVERAGE_H
@@ -0,0 +1,151 @@
+#include "hostcounters.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+static const char* COUNTER_NAMES[HOST_COUNTER_COUNT] = {
+    "cycles", "instructions", "branches", "branch-misses", "L1d-misses",
+};
+
+#ifdef __linux__
+static int openCounter(HostCounter counter) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    switch (counter) {
+        case HOST_CYCLES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case HOST_INSTRUCTIONS:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case HOST_BRANCHES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_INSTRUCTIONS;
+            break;
+        case HOST_BRANCH_MISSES:
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        default:
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                          (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            break;
+    }
+
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+HostCounters* createHostCounters(void) {
+    HostCounters* counters = calloc(1, sizeof(HostCounters));
+
+    for (int i = 0; i < HOST_COUNTER_COUNT; i++) {
+#ifdef __linux__
+        counters->fds[i] = openCounter(i);
+#else
+        counters->fds[i] = -1;
+        errno = ENOSYS;
+#endif
+        if (counters->fds[i] < 0 && counters->error == 0) {
+            counters->error = errno;
+        }
+    }
+
+    return counters;
+}
+
+void destroyHostCounters(HostCounters* counters) {
+    for (int i = 0; i < HOST_COUNTER_COUNT; i++) {
+        if (counters->fds[i] >= 0) {
+            close(counters->fds[i]);
+        }
+    }
+
+    free(counters);
+}
+
+void hostCountersStart(HostCounters* counters) {
+#ifdef __linux__
+    for (int i = 0; i < HOST_COUNTER_COUNT; i++) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counters->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#else
+    (void)counters;
+#endif
+}
+
+void hostCountersStop(HostCounters* counters, unsigned long long emulatedInstructions) {
+#ifdef __linux__
+    for (int i = 0; i < HOST_COUNTER_COUNT; i++) {
+        if (counters->fds[i] >= 0) {
+            ioctl(counters->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    for (int i = 0; i < HOST_COUNTER_COUNT; i++) {
+        // value, time enabled, time running
+        unsigned long long values[3];
+        if (counters->fds[i] < 0 || read(counters->fds[i], values, sizeof(values)) != sizeof(values)) {
+            continue;
+        }
+
+        if (values[2] > 0 && values[2] < values[1]) {
+            values[0] = (unsigned long long)((double)values[0] * values[1] / values[2]);
+        }
+        counters->totals[i] += values[0];
+    }
+#endif
+
+    counters->emulatedInstructions += emulatedInstructions;
+}
+
+static int hasCounter(const HostCounters* counters, HostCounter counter) {
+    return counters->fds[counter] >= 0;
+}
+
+void printHostCounters(const HostCounters* counters, FILE* stream) {
+    fprintf(stream, "\n===========\nHost counters over %llu emulated instructions:\n", counters->emulatedInstructions);
+
+    double emulated = counters->emulatedInstructions > 0 ? (double)counters->emulatedInstructions : 1;
+    for (int i = 0; i < HOST_COUNTER_COUNT; i++) {
+        if (!hasCounter(counters, i)) {
+            fprintf(stream, "%16s  unavailable\n", COUNTER_NAMES[i]);
+            continue;
+        }
+
+        fprintf(stream, "%16s  %16llu  %10.3f per instruction", COUNTER_NAMES[i], counters->totals[i], counters->totals[i] / emulated);
+        if (i == HOST_INSTRUCTIONS && hasCounter(counters, HOST_CYCLES) && counters->totals[HOST_CYCLES] > 0) {
+            fprintf(stream, "  (%.2f IPC)", (double)counters->totals[i] / counters->totals[HOST_CYCLES]);
+        } else if (i == HOST_BRANCH_MISSES && hasCounter(counters, HOST_BRANCHES) && counters->totals[HOST_BRANCHES] > 0) {
+            fprintf(stream, "  (%.2f%% of branches)", 100.0 * counters->totals[i] / counters->totals[HOST_BRANCHES]);
+        }
+        fprintf(stream, "\n");
+    }
+
+    if (counters->error == EACCES || counters->error == EPERM) {
+        fprintf(stream, "Some counters could not be opened: %s (see /proc/sys/kernel/perf_event_paranoid)\n", strerror(counters->error));
+    } else if (counters->error != 0) {
+        fprintf(stream, "Some counters could not be opened: %s\n", strerror(counters->error));
+    }
+    fprintf(stream, "===========\n");
+}
@@ -0,0 +1,40 @@
+#ifndef HOST_COUNTERS_H
+#define HOST_COUNTERS_H
+
+#include <stdio.h>
+
+/*
+ * Hardware counters of the host (Linux perf_event_open) read around emulation, to compare dispatch
+ * engines by what they cost the host per emulated instruction rather than by wall time.
+ *
+ * Only this process in user mode is counted. Counters the kernel or the machine does not provide are
+ * reported as unavailable and the run goes on; counters multiplexed by the kernel are scaled by the share
+ * of the time they ran.
+ */
+typedef enum {
+    HOST_CYCLES,
+    HOST_INSTRUCTIONS,
+    HOST_BRANCHES,
+    HOST_BRANCH_MISSES,
+    HOST_L1D_MISSES,
+    HOST_COUNTER_COUNT,
+} HostCounter;
+
+typedef struct HostCounters {
+    int fds[HOST_COUNTER_COUNT];  // -1 when unavailable
+    int error;                    // errno of the first counter that could not be opened
+
+    unsigned long long totals[HOST_COUNTER_COUNT];
+    unsigned long long emulatedInstructions;
+} HostCounters;
+
+HostCounters* createHostCounters(void);
+void destroyHostCounters(HostCounters* counters);
+
+// Counts from start to stop, intervals add up (each emulate() call or batch of cases)
+void hostCountersStart(HostCounters* counters);
+void hostCountersStop(HostCounters* counters, unsigned long long emulatedInstructions);
+
+void printHostCounters(const HostCounters* counters, FILE* stream);
+
+#endif // HOST_COUNTERS_H
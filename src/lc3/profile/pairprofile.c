@@ -0,0 +1,190 @@
+#include "pairprofile.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "../emulator/lc3decode.h"
+
+static const char* SHAPE_NAMES[PAIR_SHAPE_COUNT] = {
+    "NOP", "BRp", "BRz", "BRzp", "BRn", "BRnp", "BRnz", "BRnzp",  // BR, indexed by nzp
+    "ADD", "ADD imm", "LD", "ST", "JSR", "JSRR", "AND", "AND imm", "AND #0", "LDR", "STR", "RTI", "NOT",
+    "LDI", "STI", "JMP", "RET", "RES", "LEA", "GETC", "OUT", "PUTS", "IN", "PUTSP", "HALT", "TRAP",
+};
+
+static int classifyShape(unsigned short instruction) {
+    unsigned short opcode = getRaw(instruction, 12, 4);
+    int immediate = getRaw(instruction, 5, 1);
+
+    switch (opcode) {
+        case 0:
+            return getRaw(instruction, 9, 3);
+        case 1:
+            return immediate ? 9 : 8;
+        case 2:
+            return 10;
+        case 3:
+            return 11;
+        case 4:
+            return getRaw(instruction, 11, 1) ? 12 : 13;
+        case 5:
+            return !immediate ? 14 : getRaw(instruction, 0, 5) == 0 ? 16 : 15;
+        case 6:
+            return 17;
+        case 7:
+            return 18;
+        case 8:
+            return 19;
+        case 9:
+            return 20;
+        case 10:
+            return 21;
+        case 11:
+            return 22;
+        case 12:
+            return getRaw(instruction, 6, 3) == 7 ? 24 : 23;
+        case 13:
+            return 25;
+        case 14:
+            return 26;
+        default: {
+            unsigned short trapVector = getRaw(instruction, 0, 8);
+            return trapVector >= 0x20 && trapVector <= 0x25 ? 27 + trapVector - 0x20 : 33;
+        }
+    }
+}
+
+static int findShape(const char* name) {
+    for (int i = 0; i < PAIR_SHAPE_COUNT; i++) {
+        if (strcmp(SHAPE_NAMES[i], name) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+PairProfile* createPairProfile(void) {
+    PairProfile* profile = calloc(1, sizeof(PairProfile));
+    profile->previousShape = -1;
+    return profile;
+}
+
+void destroyPairProfile(PairProfile* profile) {
+    free(profile);
+}
+
+void pairProfileReset(PairProfile* profile) {
+    profile->previousShape = -1;
+}
+
+void pairProfileRecord(PairProfile* profile, unsigned short instruction) {
+    int shape = classifyShape(instruction);
+    if (profile->previousShape >= 0) {
+        profile->counts[profile->previousShape][shape]++;
+    }
+    profile->previousShape = shape;
+}
+
+typedef struct PairCount {
+    unsigned long long count;
+    int first;
+    int second;
+} PairCount;
+
+static int comparePairCounts(const void* a, const void* b) {
+    const PairCount* left = a;
+    const PairCount* right = b;
+    if (left->count != right->count) {
+        return left->count < right->count ? 1 : -1;
+    }
+    return left->first != right->first ? left->first - right->first : left->second - right->second;
+}
+
+void pairProfileWrite(const PairProfile* profile, FILE* stream) {
+    PairCount pairs[PAIR_SHAPE_COUNT * PAIR_SHAPE_COUNT];
+    int pairCount = 0;
+    unsigned long long total = 0;
+
+    for (int first = 0; first < PAIR_SHAPE_COUNT; first++) {
+        for (int second = 0; second < PAIR_SHAPE_COUNT; second++) {
+            if (profile->counts[first][second] > 0) {
+                pairs[pairCount++] = (PairCount){profile->counts[first][second], first, second};
+                total += profile->counts[first][second];
+            }
+        }
+    }
+
+    qsort(pairs, pairCount, sizeof(PairCount), comparePairCounts);
+
+    fprintf(stream, "# %llu pairs\n", total);
+    for (int i = 0; i < pairCount; i++) {
+        fprintf(stream, "%llu\t%s\t%s\n", pairs[i].count, SHAPE_NAMES[pairs[i].first], SHAPE_NAMES[pairs[i].second]);
+    }
+}
+
+static void readPairProfile(PairProfile* profile, FILE* stream) {
+    char line[256];
+    while (fgets(line, sizeof(line), stream) != NULL) {
+        if (line[0] == '#') {
+            continue;
+        }
+
+        line[strcspn(line, "\r\n")] = '\0';
+        char* count = strtok(line, "\t");
+        char* first = strtok(NULL, "\t");
+        char* second = strtok(NULL, "\t");
+        if (count == NULL || first == NULL || second == NULL) {
+            continue;
+        }
+
+        int firstShape = findShape(first);
+        int secondShape = findShape(second);
+        if (firstShape >= 0 && secondShape >= 0) {
+            profile->counts[firstShape][secondShape] += strtoull(count, NULL, 10);
+        }
+    }
+}
+
+int pairProfileMerge(const PairProfile* profile, const char* path) {
+    // Runs over a corpus may finish at the same time, the lock file serializes the read-modify-write
+    char lockPath[4096 + 8];
+    snprintf(lockPath, sizeof(lockPath), "%s.lock", path);
+    int lock = open(lockPath, O_RDWR | O_CREAT, 0666);
+    if (lock < 0 || flock(lock, LOCK_EX) != 0) {
+        if (lock >= 0) {
+            close(lock);
+        }
+        return 0;
+    }
+
+    PairProfile* merged = createPairProfile();
+    memcpy(merged->counts, profile->counts, sizeof(merged->counts));
+
+    FILE* existing = fopen(path, "r");
+    if (existing != NULL) {
+        readPairProfile(merged, existing);
+        fclose(existing);
+    }
+
+    char temporaryPath[4096 + 32];
+    snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp.%ld", path, (long)getpid());
+
+    int ok = 0;
+    FILE* output = fopen(temporaryPath, "w");
+    if (output != NULL) {
+        pairProfileWrite(merged, output);
+        ok = fclose(output) == 0 && rename(temporaryPath, path) == 0;
+        if (!ok) {
+            unlink(temporaryPath);
+        }
+    }
+
+    destroyPairProfile(merged);
+    flock(lock, LOCK_UN);
+    close(lock);
+
+    return ok;
+}
@@ -0,0 +1,33 @@
+#ifndef PAIR_PROFILE_H
+#define PAIR_PROFILE_H
+
+#include <stdio.h>
+
+/*
+ * Counts how often each instruction shape is executed directly after another one.
+ *
+ * Shapes are finer than opcodes where it matters for fusion (BR by condition, immediate vs register
+ * operands, AND with #0, RET, each trap). Profiles are merged into a text file, one
+ * "count<TAB>first<TAB>second" line per pair sorted by count, so a whole corpus can be accumulated
+ * by pointing every run at the same file.
+ */
+#define PAIR_SHAPE_COUNT 34
+
+typedef struct PairProfile {
+    unsigned long long counts[PAIR_SHAPE_COUNT][PAIR_SHAPE_COUNT];
+    int previousShape;  // -1 before the first instruction of a run
+} PairProfile;
+
+PairProfile* createPairProfile(void);
+void destroyPairProfile(PairProfile* profile);
+
+// Starts a new run, the first instruction of a run does not form a pair with the last one of the previous
+void pairProfileReset(PairProfile* profile);
+void pairProfileRecord(PairProfile* profile, unsigned short instruction);
+
+void pairProfileWrite(const PairProfile* profile, FILE* stream);
+
+// Adds the counts already stored in the file (if any) and rewrites it, returns 0 on failure
+int pairProfileMerge(const PairProfile* profile, const char* path);
+
+#endif // PAIR_PROFILE_H
@@ -0,0 +1,118 @@
+#include "timing.h"
+
+#include <ctype.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+static const char* OPCODE_NAMES[16] = {"BR", "ADD", "LD", "ST", "JSR", "AND", "LDR", "STR",
+                                       "RTI", "NOT", "LDI", "STI", "JMP", NULL, "LEA", "TRAP"};
+
+// strtoul accepts a sign (and wraps a negative number), only digits are taken here
+static int parseCycles(const char* text, unsigned int* cycles) {
+    char* end;
+    unsigned long value = strtoul(text, &end, 10);
+    if (!isdigit((unsigned char)*text) || *end != '\0' || value > UINT_MAX) {
+        return 0;
+    }
+
+    *cycles = value;
+    return 1;
+}
+
+static int parseLine(TimingModel* model, char* line) {
+    char* name = strtok(line, " \t\r\n");
+    char* first = strtok(NULL, " \t\r\n");
+    char* second = strtok(NULL, " \t\r\n");
+
+    if (name == NULL) {
+        return 1;
+    }
+    if (first == NULL || strtok(NULL, " \t\r\n") != NULL) {
+        return 0;
+    }
+
+    // TRAP x22 40
+    if (second != NULL) {
+        if (strcasecmp(name, "TRAP") != 0 || (first[0] != 'x' && first[0] != 'X') || !isxdigit((unsigned char)first[1])) {
+            return 0;
+        }
+
+        char* end;
+        unsigned long vector = strtoul(first + 1, &end, 16);
+        return *end == '\0' && vector < 256 && parseCycles(second, &model->trapCost[vector]);
+    }
+
+    if (strcasecmp(name, "fetch") == 0) {
+        return parseCycles(first, &model->fetch);
+    }
+    if (strcasecmp(name, "memory") == 0) {
+        return parseCycles(first, &model->memory);
+    }
+    if (strcasecmp(name, "branch-taken") == 0) {
+        return parseCycles(first, &model->branchTaken);
+    }
+
+    for (int opcode = 0; opcode < 16; opcode++) {
+        if (OPCODE_NAMES[opcode] != NULL && strcasecmp(name, OPCODE_NAMES[opcode]) == 0) {
+            return parseCycles(first, &model->opcodeCost[opcode]);
+        }
+    }
+
+    return 0;
+}
+
+TimingModel* loadTimingModel(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open timing model: %s\n", path);
+        return NULL;
+    }
+
+    TimingModel* model = calloc(1, sizeof(TimingModel));
+    for (int opcode = 0; opcode < 16; opcode++) {
+        model->opcodeCost[opcode] = 1;
+    }
+
+    char line[256];
+    unsigned int lineNumber = 0;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+
+        char* comment = strchr(line, '#');
+        if (comment != NULL) {
+            *comment = '\0';
+        }
+
+        if (!parseLine(model, line)) {
+            fprintf(stderr, "Invalid line %u in timing model: %s\n", lineNumber, path);
+            fclose(file);
+            free(model);
+            return NULL;
+        }
+    }
+
+    fclose(file);
+    return model;
+}
+
+void destroyTimingModel(TimingModel* model) {
+    free(model);
+}
+
+void printTimingModel(const TimingModel* model, unsigned long long stallCycles, FILE* stream) {
+    unsigned long long total = model->cycles + stallCycles;
+
+    fprintf(stream, "\n===========\nTiming model:\n");
+    fprintf(stream, "%16llu  instructions\n", model->instructions);
+    if (stallCycles != 0) {
+        fprintf(stream, "%16llu  modeled cycles\n", model->cycles);
+        fprintf(stream, "%16llu  cache stall cycles\n", stallCycles);
+    }
+    fprintf(stream, "%16llu  cycles", total);
+    if (model->instructions != 0) {
+        fprintf(stream, "  (%.3f per instruction)", (double)total / model->instructions);
+    }
+    fprintf(stream, "\n===========\n");
+}
@@ -0,0 +1,72 @@
+#ifndef TIMING_H
+#define TIMING_H
+
+#include <stdio.h>
+
+#include "../emulator/lc3decode.h"
+#include "../emulator/lc3emulator.h"
+
+/*
+ * Modeled cycle counts (--timing), instead of one cycle per instruction.
+ *
+ * The model is read from a file of "<name> <cycles>" lines, # starts a comment:
+ *
+ *   ADD 1           Base cost of an opcode: ADD AND NOT BR JMP (and RET) JSR (and JSRR) LD LDI LDR LEA
+ *   LDI 2           ST STI STR TRAP RTI
+ *   fetch 0         Added to every instruction for its fetch
+ *   memory 3        Added per data access: one for LD/LDR/ST/STR, two for LDI/STI
+ *   branch-taken 2  Added when a BR is taken
+ *   TRAP x22 40     Added to the TRAP cost for one vector, the routine itself is not emulated
+ *
+ * Names left out cost 1 (opcodes) or 0 (the rest), so an empty file counts instructions. Like the
+ * profiles, the model is charged by the stepped engine before each instruction.
+ */
+typedef struct TimingModel {
+    unsigned int opcodeCost[16];
+    unsigned int trapCost[256];
+    unsigned int fetch;
+    unsigned int memory;
+    unsigned int branchTaken;
+
+    unsigned long long instructions;
+    unsigned long long cycles;
+} TimingModel;
+
+// Returns NULL and prints why when the file cannot be read or has an invalid line
+TimingModel* loadTimingModel(const char* path);
+void destroyTimingModel(TimingModel* model);
+
+static inline void timingRecord(TimingModel* model, const LC3EmulatorState* state) {
+    unsigned short instruction = state->memory[state->pc].rawNumber;
+    unsigned short opcode = instruction >> 12;
+    unsigned long long cycles = model->opcodeCost[opcode] + model->fetch;
+
+    switch (opcode) {
+        case 0:
+            if (getRaw(instruction, 9, 3) & state->cc) {
+                cycles += model->branchTaken;
+            }
+            break;
+        case 2:
+        case 3:
+        case 6:
+        case 7:
+            cycles += model->memory;
+            break;
+        case 10:
+        case 11:
+            cycles += 2 * model->memory;
+            break;
+        case 15:
+            cycles += model->trapCost[instruction & 0xFF];
+            break;
+    }
+
+    model->instructions++;
+    model->cycles += cycles;
+}
+
+// stallCycles are added by other models (the caches), 0 when there are none
+void printTimingModel(const TimingModel* model, unsigned long long stallCycles, FILE* stream);
+
+#endif // TIMING_H
@@ -0,0 +1,21 @@
+#include "lc3random.h"
+
+void randomFillMemory(MemoryCell *memory, int seed) {
+    unsigned long long key = randomKey(seed, RANDOM_STREAM_MEMORY);
+
+    // No dependency between iterations, so this is a straight loop of multiplies and shifts
+    for (unsigned int block = 0; block < 65536 / 4; block++) {
+        unsigned long long bits = randomMix(key + block * 0x9e3779b97f4a7c15ULL);
+
+        memory[block * 4 + 0].rawNumber = (unsigned short)bits;
+        memory[block * 4 + 1].rawNumber = (unsigned short)(bits >> 16);
+        memory[block * 4 + 2].rawNumber = (unsigned short)(bits >> 32);
+        memory[block * 4 + 3].rawNumber = (unsigned short)(bits >> 48);
+    }
+}
+
+void randomFillRegisters(short registers[8], int seed) {
+    for (int i = 0; i < 8; i++) {
+        registers[i] = (short)randomWord(seed, RANDOM_STREAM_REGISTERS, i);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef LC3_RANDOM_H
+#define LC3_RANDOM_H
+
+#include "../emulator/lc3emulator.h"
+
+/*
+ * Counter-based generator for --randomized.
+ *
+ * Every value is a pure function of (seed, stream, counter), using the SplitMix64 finalizer,
+ * so layouts are identical across platforms and threads and any word can be regenerated on its own.
+ */
+typedef enum LC3RandomStream {
+    RANDOM_STREAM_MEMORY = 0,
+    RANDOM_STREAM_REGISTERS = 1,
+    RANDOM_STREAM_FUZZER = 2,
+} LC3RandomStream;
+
+static inline unsigned long long randomMix(unsigned long long x) {
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static inline unsigned long long randomKey(int seed, LC3RandomStream stream) {
+    return randomMix(((unsigned long long)(unsigned int)seed << 32) ^ ((unsigned long long)stream * 0x9e3779b97f4a7c15ULL));
+}
+
+// Each 64-bit output covers 4 consecutive words
+static inline unsigned short randomWord(int seed, LC3RandomStream stream, unsigned int index) {
+    unsigned long long block = randomMix(randomKey(seed, stream) + (index >> 2) * 0x9e3779b97f4a7c15ULL);
+    return (unsigned short)(block >> ((index & 3) * 16));
+}
+
+void randomFillMemory(MemoryCell *memory, int seed);
+void randomFillRegisters(short registers[8], int seed);
+
+#endif // LC3_RANDOM_H
@@ -0,0 +1,150 @@
+#include "shadow.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../image/lc3image.h"
+
+ShadowMemory* createShadowMemory(FILE* stream) {
+    ShadowMemory* shadow = calloc(1, sizeof(ShadowMemory));
+    shadow->stream = stream;
+    return shadow;
+}
+
+void destroyShadowMemory(ShadowMemory* shadow) {
+    free(shadow->reports);
+    free(shadow);
+}
+
+void shadowBegin(ShadowMemory* shadow, const LC3EmulatorState* state) {
+    shadow->image = state->image;
+    if (state->image != NULL) {
+        memcpy(shadow->defined, state->image->emitted, sizeof(shadow->defined));
+    } else {
+        memset(shadow->defined, 0xFF, sizeof(shadow->defined));
+    }
+
+    shadow->registers = 0;
+    memset(shadow->origins, 0, sizeof(shadow->origins));
+    memset(shadow->reported, 0, sizeof(shadow->reported));
+}
+
+void shadowDefineRegister(ShadowMemory* shadow, int reg) {
+    shadow->registers |= 1 << reg;
+}
+
+void shadowDefineWord(ShadowMemory* shadow, unsigned short address) {
+    shadowSetWord(shadow, address, 1);
+}
+
+static void printLocation(const LC3Image* image, unsigned short address, FILE* stream) {
+    // Words outside the program would be named after whatever label precedes them
+    const LC3Symbol* symbol = image != NULL && imageIsEmitted(image, address) ? imageSymbolAt(image, address) : NULL;
+    fprintf(stream, "x%04x", address);
+    if (symbol != NULL && symbol->address == address) {
+        fprintf(stream, " (%s)", symbol->name);
+    } else if (symbol != NULL) {
+        fprintf(stream, " (%s+%d)", symbol->name, address - symbol->address);
+    }
+}
+
+static void printOrigin(const LC3Image* image, ShadowOrigin origin, FILE* stream) {
+    if (!origin.loaded) {
+        fprintf(stream, "never written\n");
+        return;
+    }
+
+    fprintf(stream, "loaded from uninitialized ");
+    printLocation(image, origin.address, stream);
+    fprintf(stream, " at ");
+    printLocation(image, origin.pc, stream);
+    fprintf(stream, "\n");
+}
+
+static void printReport(const LC3Image* image, const ShadowReport* report, FILE* stream) {
+    fprintf(stream, "Uninitialized read at ");
+    printLocation(image, report->pc, stream);
+    if (image != NULL && image->lines[report->pc] != 0) {
+        fprintf(stream, ", line %u", image->lines[report->pc]);
+    }
+    fprintf(stream, ": ");
+    printHexInstruction(stream, report->instruction);
+
+    switch (report->use) {
+        case SHADOW_POINTER:
+            fprintf(stream, " reads through ");
+            printLocation(image, report->address, stream);
+            fprintf(stream, ", never written\n");
+            break;
+        case SHADOW_CONDITION:
+            fprintf(stream, " tests condition codes ");
+            printOrigin(image, report->origin, stream);
+            break;
+        case SHADOW_TRAP:
+            if (report->reg < 0) {
+                fprintf(stream, (report->instruction & 0xFF) == LC3_TRAP_CAS ? " compares " : " prints ");
+                printLocation(image, report->address, stream);
+                fprintf(stream, ", never written\n");
+                break;
+            }
+            // fall through
+        default:
+            fprintf(stream, " reads R%d, ", report->reg);
+            printOrigin(image, report->origin, stream);
+            break;
+    }
+}
+
+static void addReport(ShadowMemory* shadow, ShadowReport report) {
+    // Once per instruction, loops would repeat the same report otherwise
+    if ((shadow->reported[report.pc >> 3] >> (report.pc & 7)) & 1) {
+        return;
+    }
+    shadow->reported[report.pc >> 3] |= 1 << (report.pc & 7);
+
+    if (shadow->stream != NULL) {
+        printReport(shadow->image, &report, shadow->stream);
+        return;
+    }
+
+    if (shadow->reportCount == shadow->reportCapacity) {
+        shadow->reportCapacity = shadow->reportCapacity == 0 ? 16 : shadow->reportCapacity * 2;
+        shadow->reports = realloc(shadow->reports, shadow->reportCapacity * sizeof(ShadowReport));
+    }
+    shadow->reports[shadow->reportCount++] = report;
+}
+
+void shadowReportRegister(ShadowMemory* shadow, unsigned short pc, unsigned short instruction, ShadowUse use, int reg) {
+    addReport(shadow, (ShadowReport){pc, instruction, use, reg, 0, shadow->origins[reg]});
+    shadow->registers |= 1 << reg;
+}
+
+void shadowReportWord(ShadowMemory* shadow, unsigned short pc, unsigned short instruction, ShadowUse use, unsigned short address) {
+    addReport(shadow, (ShadowReport){pc, instruction, use, -1, address, {0}});
+    shadowSetWord(shadow, address, 1);
+}
+
+void shadowCheckString(ShadowMemory* shadow, const LC3EmulatorState* state, unsigned short pc, unsigned short instruction) {
+    // Walks the words PUTS/PUTSP print, up to the first undefined one
+    int packed = (instruction & 0xFF) == 0x24;
+    unsigned short address = state->registers[0];
+    for (int i = 0; i < 65536; i++) {
+        if (!shadowIsDefined(shadow, address)) {
+            shadowReportWord(shadow, pc, instruction, SHADOW_TRAP, address);
+            return;
+        }
+
+        unsigned short word = state->memory[address].rawNumber;
+        if (word == 0 || (packed && (word >> 8) == 0)) {
+            return;
+        }
+        address++;
+    }
+}
+
+void shadowPrintReports(ShadowMemory* shadow, FILE* stream) {
+    for (unsigned int i = 0; i < shadow->reportCount; i++) {
+        printReport(shadow->image, &shadow->reports[i], stream);
+    }
+    shadow->reportCount = 0;
+}
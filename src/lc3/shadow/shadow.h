@@ -0,0 +1,203 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <stdio.h>
+
+#include "../emulator/lc3decode.h"
+#include "../emulator/lc3emulator.h"
+#include "../emulator/lc3multicore.h"
+
+/*
+ * Uninitialized reads (--check-uninitialized), tracked with one definedness bit per memory word and
+ * per register.
+ *
+ * Words emitted by the assembler (or set by the expectations file) start defined, every store gives its
+ * word the definedness of the stored register. Registers start undefined. A load of an undefined word is
+ * not reported by itself, the register just carries where it came from, so saving and restoring a
+ * register the caller never set is fine. Undefined values are reported where they are used: operands of
+ * ADD/AND/NOT, base registers, LDI/STI pointers, the condition of a BR and the arguments of traps. The
+ * used value counts as defined afterwards, so one mistake is reported once.
+ *
+ * Without an image (a .bin) every word is taken as defined and only registers are checked.
+ */
+#define SHADOW_CC 8  // The condition codes, defined when the value that set them was
+
+typedef enum {
+    SHADOW_OPERAND,    // Source register of ADD/AND/NOT
+    SHADOW_BASE,       // Base register of LDR/STR/JMP/JSRR
+    SHADOW_POINTER,    // The pointer word of LDI/STI
+    SHADOW_CONDITION,  // The cc tested by a conditional BR
+    SHADOW_TRAP,       // R0 of OUT/PUTS/PUTSP, or a word of the string, or an argument or the word of CAS
+} ShadowUse;
+
+// Where an undefined register value came from
+typedef struct ShadowOrigin {
+    int loaded;              // 0 when the register was never written
+    unsigned short pc;       // The load
+    unsigned short address;  // The undefined word it read
+} ShadowOrigin;
+
+typedef struct ShadowReport {
+    unsigned short pc;
+    unsigned short instruction;
+    ShadowUse use;
+    int reg;                 // -1 when the undefined value is a memory word
+    unsigned short address;  // The word, when reg is -1
+    ShadowOrigin origin;
+} ShadowReport;
+
+typedef struct ShadowMemory {
+    const LC3Image* image;  // For labels and lines, NULL when running a .bin
+
+    unsigned char defined[65536 / 8];
+    unsigned short registers;  // 1 bit per defined register, bit SHADOW_CC for the cc
+    ShadowOrigin origins[SHADOW_CC + 1];
+
+    unsigned char reported[65536 / 8];  // Addresses of instructions already reported
+
+    FILE* stream;  // Reports are printed as they happen, or kept for shadowPrintReports when NULL
+    ShadowReport* reports;
+    unsigned int reportCount;
+    unsigned int reportCapacity;
+} ShadowMemory;
+
+ShadowMemory* createShadowMemory(FILE* stream);
+void destroyShadowMemory(ShadowMemory* shadow);
+
+// Marks the emitted words of the state's image defined and every register undefined, before each run
+void shadowBegin(ShadowMemory* shadow, const LC3EmulatorState* state);
+
+// Values set from outside the program (expectations)
+void shadowDefineRegister(ShadowMemory* shadow, int reg);
+void shadowDefineWord(ShadowMemory* shadow, unsigned short address);
+
+// Slow paths of shadowCheck, report the use and mark the value defined
+void shadowReportRegister(ShadowMemory* shadow, unsigned short pc, unsigned short instruction, ShadowUse use, int reg);
+void shadowReportWord(ShadowMemory* shadow, unsigned short pc, unsigned short instruction, ShadowUse use, unsigned short address);
+void shadowCheckString(ShadowMemory* shadow, const LC3EmulatorState* state, unsigned short pc, unsigned short instruction);
+
+// Prints the reports kept so far and forgets them
+void shadowPrintReports(ShadowMemory* shadow, FILE* stream);
+
+static inline int shadowIsDefined(const ShadowMemory* shadow, unsigned short address) {
+    return (shadow->defined[address >> 3] >> (address & 7)) & 1;
+}
+
+static inline void shadowSetWord(ShadowMemory* shadow, unsigned short address, int defined) {
+    unsigned char bit = 1 << (address & 7);
+    shadow->defined[address >> 3] = defined ? shadow->defined[address >> 3] | bit : shadow->defined[address >> 3] & ~bit;
+}
+
+static inline void shadowUse(ShadowMemory* shadow, unsigned short pc, unsigned short instruction, ShadowUse use, int reg) {
+    if (!((shadow->registers >> reg) & 1)) {
+        shadowReportRegister(shadow, pc, instruction, use, reg);
+    }
+}
+
+// The register and the cc take the definedness of the loaded word
+static inline void shadowLoad(ShadowMemory* shadow, unsigned short pc, int reg, unsigned short address) {
+    unsigned short bits = 1 << reg | 1 << SHADOW_CC;
+    if (shadowIsDefined(shadow, address)) {
+        shadow->registers |= bits;
+    } else {
+        shadow->registers &= ~bits;
+        shadow->origins[reg] = shadow->origins[SHADOW_CC] = (ShadowOrigin){1, pc, address};
+    }
+}
+
+static inline void shadowStore(ShadowMemory* shadow, int reg, unsigned short address) {
+    shadowSetWord(shadow, address, (shadow->registers >> reg) & 1);
+}
+
+// Called before each executed instruction, with the state it reads
+static inline void shadowCheck(ShadowMemory* shadow, const LC3EmulatorState* state, unsigned short instruction) {
+    unsigned short pc = state->pc;
+    int dr = getRaw(instruction, 9, 3);
+    int sr1 = getRaw(instruction, 6, 3);
+    LC3DataAccess access;
+    unsigned short pointer;
+
+    switch (instruction >> 12) {
+        case 0:
+            if (dr != 0 && dr != 7) {
+                shadowUse(shadow, pc, instruction, SHADOW_CONDITION, SHADOW_CC);
+            }
+            break;
+        case 1:
+        case 5:
+            // AND with #0 clears the register whatever it held
+            if (!((instruction >> 12) == 5 && (instruction & (1 << 5)) && getRaw(instruction, 0, 5) == 0)) {
+                shadowUse(shadow, pc, instruction, SHADOW_OPERAND, sr1);
+            }
+            if (!(instruction & (1 << 5))) {
+                shadowUse(shadow, pc, instruction, SHADOW_OPERAND, getRaw(instruction, 0, 3));
+            }
+            shadow->registers |= 1 << dr | 1 << SHADOW_CC;
+            break;
+        case 9:
+            shadowUse(shadow, pc, instruction, SHADOW_OPERAND, sr1);
+            shadow->registers |= 1 << dr | 1 << SHADOW_CC;
+            break;
+        case 2:
+        case 3:
+        case 6:
+        case 7:
+        case 10:
+        case 11:
+            access = decodeDataAccess(state, instruction);
+            if ((instruction >> 12) == 6 || (instruction >> 12) == 7) {
+                shadowUse(shadow, pc, instruction, SHADOW_BASE, sr1);
+            }
+            if (access.indirect && !shadowIsDefined(shadow, access.pointer)) {
+                shadowReportWord(shadow, pc, instruction, SHADOW_POINTER, access.pointer);
+            }
+            if (access.kind == LC3_DATA_LOAD) {
+                shadowLoad(shadow, pc, dr, access.address);
+            } else {
+                shadowStore(shadow, dr, access.address);
+            }
+            break;
+        case 4:
+            if (!(instruction & (1 << 11))) {
+                shadowUse(shadow, pc, instruction, SHADOW_BASE, sr1);
+            }
+            shadow->registers |= 1 << 7;
+            break;
+        case 12:
+            shadowUse(shadow, pc, instruction, SHADOW_BASE, sr1);
+            break;
+        case 14:
+            shadow->registers |= 1 << dr;
+            break;
+        case 15:
+            switch (instruction & 0xFF) {
+                case 0x20:
+                case 0x23:
+                    shadow->registers |= 1 << 0;
+                    break;
+                case 0x21:
+                    shadowUse(shadow, pc, instruction, SHADOW_TRAP, 0);
+                    break;
+                case 0x22:
+                case 0x24:
+                    shadowUse(shadow, pc, instruction, SHADOW_TRAP, 0);
+                    shadowCheckString(shadow, state, pc, instruction);
+                    break;
+                case LC3_TRAP_CORE:
+                    shadow->registers |= 1 << 0 | 1 << 1;
+                    break;
+                case LC3_TRAP_CAS:
+                    shadowUse(shadow, pc, instruction, SHADOW_TRAP, 0);
+                    shadowUse(shadow, pc, instruction, SHADOW_TRAP, 1);
+                    shadowUse(shadow, pc, instruction, SHADOW_TRAP, 2);
+                    pointer = state->registers[0];
+                    if (!shadowIsDefined(shadow, pointer)) {
+                        shadowReportWord(shadow, pc, instruction, SHADOW_TRAP, pointer);
+                    }
+                    break;
+            }
+            break;
+    }
+}
+
+#endif // SHADOW_H
@@ -0,0 +1,322 @@
+#include "translator.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../emulator/lc3decode.h"
+#include "../image/lc3image.h"
+
+// Everything the generated program needs besides the translated code, kept in sync with the emulator's traps
+static const char* RUNTIME =
+    "#define SETCC(value) (cc = (short)(value) == 0 ? 2 : (short)(value) < 0 ? 4 : 1)\n"
+    "\n"
+    "static int modified = 0;  // Set once a store overwrites a translated instruction\n"
+    "\n"
+    "static void store(unsigned short address, short value) {\n"
+    "    if (isCode[address] && mem[address] != (unsigned short)value) modified = 1;\n"
+    "    mem[address] = value;\n"
+    "}\n"
+    "\n"
+    "static void setR0FromInput(void) {\n"
+    "    int c = getchar();\n"
+    "    if (c == -1) {\n"
+    "        fprintf(stderr, \"\\n\\nGETC called after end of input!\\n\");\n"
+    "        exit(1);\n"
+    "    }\n"
+    "    R[0] = (char)c;\n"
+    "}\n"
+    "\n"
+    "static void trapOut(void) {\n"
+    "    putchar((char)R[0]);\n"
+    "    fflush(stdout);\n"
+    "}\n"
+    "\n"
+    "static void trapPuts(void) {\n"
+    "    for (unsigned short address = R[0]; mem[address]; address++) putchar((char)mem[address]);\n"
+    "    fflush(stdout);\n"
+    "}\n"
+    "\n"
+    "static void trapIn(void) {\n"
+    "    fputs(\"Input a character> \", stdout);\n"
+    "    char c = getchar();\n"
+    "    R[0] = c;\n"
+    "    putchar(c);\n"
+    "    fflush(stdout);\n"
+    "}\n"
+    "\n"
+    "static void trapPutsp(void) {\n"
+    "    for (unsigned short address = R[0]; mem[address]; address++) {\n"
+    "        putchar((char)(mem[address] & 0xFF));\n"
+    "        if ((mem[address] >> 8) == 0) break;\n"
+    "        putchar((char)(mem[address] >> 8));\n"
+    "    }\n"
+    "    fflush(stdout);\n"
+    "}\n"
+    "\n"
+    "// CAS on the only core\n"
+    "static void trapCas(void) {\n"
+    "    unsigned short previous = mem[(unsigned short)R[0]];\n"
+    "    if (previous == (unsigned short)R[1]) store(R[0], R[2]);\n"
+    "    R[1] = previous;\n"
+    "}\n"
+    "\n"
+    "static int trap(unsigned short instruction) {\n"
+    "    switch ((signed char)(instruction & 0xFF)) {\n"
+    "        case 0x20: setR0FromInput(); break;\n"
+    "        case 0x21: trapOut(); break;\n"
+    "        case 0x22: trapPuts(); break;\n"
+    "        case 0x23: trapIn(); break;\n"
+    "        case 0x24: trapPutsp(); break;\n"
+    "        case 0x25: return 1;\n"
+    "        case 0x30: R[0] = 0; R[1] = 1; break;\n"
+    "        case 0x31: trapCas(); break;\n"
+    "    }\n"
+    "    return 0;\n"
+    "}\n"
+    "\n"
+    "// Runs one instruction the way the emulator does, returns 1 on HALT\n"
+    "static int interpret(unsigned short* pc) {\n"
+    "    unsigned short instruction = mem[(*pc)++];\n"
+    "    unsigned short dr = (instruction >> 9) & 7;\n"
+    "    unsigned short sr1 = (instruction >> 6) & 7;\n"
+    "    short imm5 = (short)((instruction & 0x1F) ^ 0x10) - 0x10;\n"
+    "    short offset6 = (short)((instruction & 0x3F) ^ 0x20) - 0x20;\n"
+    "    short offset9 = (short)((instruction & 0x1FF) ^ 0x100) - 0x100;\n"
+    "    short offset11 = (short)((instruction & 0x7FF) ^ 0x400) - 0x400;\n"
+    "    short operand = instruction & 0x20 ? imm5 : R[instruction & 7];\n"
+    "    unsigned short address;\n"
+    "\n"
+    "    switch (instruction >> 12) {\n"
+    "        case 0: if (dr & cc) *pc += offset9; break;\n"
+    "        case 1: R[dr] = R[sr1] + operand; SETCC(R[dr]); break;\n"
+    "        case 2: R[dr] = mem[(unsigned short)(*pc + offset9)]; SETCC(R[dr]); break;\n"
+    "        case 3: store(*pc + offset9, R[dr]); break;\n"
+    "        case 4:\n"
+    "            R[7] = *pc;\n"
+    "            *pc = instruction & 0x800 ? (unsigned short)(*pc + offset11) : (unsigned short)R[sr1];\n"
+    "            break;\n"
+    "        case 5: R[dr] = R[sr1] & operand; SETCC(R[dr]); break;\n"
+    "        case 6: R[dr] = mem[(unsigned short)(R[sr1] + offset6)]; SETCC(R[dr]); break;\n"
+    "        case 7: store(R[sr1] + offset6, R[dr]); break;\n"
+    "        case 8: fprintf(stderr, \"RTI encountered!\\n\"); exit(1);\n"
+    "        case 9: R[dr] = ~R[sr1]; SETCC(R[dr]); break;\n"
+    "        case 10: address = mem[(unsigned short)(*pc + offset9)]; R[dr] = mem[address]; SETCC(R[dr]); break;\n"
+    "        case 11: store(mem[(unsigned short)(*pc + offset9)], R[dr]); break;\n"
+    "        case 12: *pc = R[sr1]; break;\n"
+    "        case 13: fprintf(stderr, \"Reserved opcode encountered!\\n\"); exit(1);\n"
+    "        case 14: R[dr] = *pc + offset9; break;\n"
+    "        case 15: return trap(instruction);\n"
+    "    }\n"
+    "    return 0;\n"
+    "}\n"
+    "\n";
+
+static void pushReachable(unsigned char* reachable, unsigned short* worklist, int* count, unsigned short address) {
+    if (!reachable[address]) {
+        reachable[address] = 1;
+        worklist[(*count)++] = address;
+    }
+}
+
+// Marks every instruction reachable from the initial pc through fall-through, BR and JSR edges
+static unsigned char* findReachable(LC3EmulatorState* state) {
+    unsigned char* reachable = calloc(65536, 1);
+    unsigned short* worklist = malloc(65536 * sizeof(unsigned short));
+    int count = 0;
+
+    pushReachable(reachable, worklist, &count, state->pc);
+    while (count > 0) {
+        unsigned short address = worklist[--count];
+        unsigned short next = address + 1;
+        unsigned short instruction = state->memory[address].rawNumber;
+        unsigned short opcode = getRaw(instruction, 12, 4);
+
+        if (opcode == 0) {
+            unsigned short nzp = getRaw(instruction, 9, 3);
+            if (nzp != 0) {
+                pushReachable(reachable, worklist, &count, next + getAsNumber(instruction, 0, 9));
+            }
+            // An unconditional branch usually has data after it, keep that out of the translated code
+            if (nzp != 7) {
+                pushReachable(reachable, worklist, &count, next);
+            }
+        } else if (opcode == 4) {
+            if (getRaw(instruction, 11, 1)) {
+                pushReachable(reachable, worklist, &count, next + getAsNumber(instruction, 0, 11));
+            }
+            pushReachable(reachable, worklist, &count, next);
+        } else if (opcode == 15) {
+            if (getAsNumber(instruction, 0, 8) != 0x25) {
+                pushReachable(reachable, worklist, &count, next);
+            }
+        } else if (opcode != 8 && opcode != 12 && opcode != 13) {
+            pushReachable(reachable, worklist, &count, next);
+        }
+    }
+
+    free(worklist);
+    return reachable;
+}
+
+static void emitInstruction(FILE* output, unsigned short address, unsigned short instruction) {
+    unsigned short next = address + 1;
+    unsigned short opcode = getRaw(instruction, 12, 4);
+    unsigned short dr = getRaw(instruction, 9, 3);
+    unsigned short sr1 = getRaw(instruction, 6, 3);
+    unsigned short pcRelative = next + getAsNumber(instruction, 0, 9);
+    short offset6 = getAsNumber(instruction, 0, 6);
+
+    char operand[16];
+    if (instruction & (1 << 5)) {
+        snprintf(operand, sizeof(operand), "%d", getAsNumber(instruction, 0, 5));
+    } else {
+        snprintf(operand, sizeof(operand), "R[%d]", getRaw(instruction, 0, 3));
+    }
+
+    switch (opcode) {
+        case 0:
+            if (dr != 0) {
+                fprintf(output, "    if (cc & %d) goto L_%04x;\n", dr, pcRelative);
+            }
+            break;
+        case 1:
+            fprintf(output, "    R[%d] = R[%d] + %s; SETCC(R[%d]);\n", dr, sr1, operand, dr);
+            break;
+        case 2:
+            fprintf(output, "    R[%d] = mem[0x%04x]; SETCC(R[%d]);\n", dr, pcRelative, dr);
+            break;
+        case 3:
+            fprintf(output, "    store(0x%04x, R[%d]);\n", pcRelative, dr);
+            fprintf(output, "    if (modified) { pc = 0x%04x; goto dispatch; }\n", next);
+            break;
+        case 4:
+            if (getRaw(instruction, 11, 1)) {
+                unsigned short target = next + getAsNumber(instruction, 0, 11);
+                fprintf(output, "    R[7] = 0x%04x; goto L_%04x;\n", next, target);
+            } else {
+                // R7 is written first, so JSRR R7 continues at the next instruction like in the emulator
+                fprintf(output, "    R[7] = 0x%04x; pc = R[%d]; goto dispatch;\n", next, sr1);
+            }
+            break;
+        case 5:
+            fprintf(output, "    R[%d] = R[%d] & %s; SETCC(R[%d]);\n", dr, sr1, operand, dr);
+            break;
+        case 6:
+            fprintf(output, "    R[%d] = mem[(unsigned short)(R[%d] + %d)]; SETCC(R[%d]);\n", dr, sr1, offset6, dr);
+            break;
+        case 7:
+            fprintf(output, "    store(R[%d] + %d, R[%d]);\n", sr1, offset6, dr);
+            fprintf(output, "    if (modified) { pc = 0x%04x; goto dispatch; }\n", next);
+            break;
+        case 8:
+            fprintf(output, "    fprintf(stderr, \"RTI encountered!\\n\"); exit(1);\n");
+            break;
+        case 9:
+            fprintf(output, "    R[%d] = ~R[%d]; SETCC(R[%d]);\n", dr, sr1, dr);
+            break;
+        case 10:
+            fprintf(output, "    R[%d] = mem[mem[0x%04x]]; SETCC(R[%d]);\n", dr, pcRelative, dr);
+            break;
+        case 11:
+            fprintf(output, "    store(mem[0x%04x], R[%d]);\n", pcRelative, dr);
+            fprintf(output, "    if (modified) { pc = 0x%04x; goto dispatch; }\n", next);
+            break;
+        case 12:
+            fprintf(output, "    pc = R[%d]; goto dispatch;\n", sr1);
+            break;
+        case 13:
+            fprintf(output, "    fprintf(stderr, \"Reserved opcode encountered!\\n\"); exit(1);\n");
+            break;
+        case 14:
+            fprintf(output, "    R[%d] = (short)0x%04x;\n", dr, pcRelative);
+            break;
+        case 15:
+            if (getAsNumber(instruction, 0, 8) == 0x25) {
+                fprintf(output, "    goto halt;\n");
+            } else {
+                fprintf(output, "    trap(0x%04x);\n", instruction);
+            }
+            break;
+    }
+}
+
+void translateToC(LC3EmulatorState* state, FILE* output) {
+    unsigned char* reachable = findReachable(state);
+
+    fprintf(output, "// Generated by lc3 --translate-c\n");
+    fprintf(output, "#include <stdio.h>\n#include <stdlib.h>\n\n");
+    fprintf(output, "#pragma GCC diagnostic ignored \"-Wunused-label\"\n\n");
+
+    fprintf(output, "static unsigned short mem[65536] = {");
+    int column = 0;
+    for (int address = 0; address < 65536; address++) {
+        if (state->memory[address].rawNumber != 0) {
+            fprintf(output, "%s[0x%04x] = 0x%04x,", column++ % 8 == 0 ? "\n    " : " ", address, state->memory[address].rawNumber);
+        }
+    }
+    fprintf(output, "\n};\n\n");
+
+    fprintf(output, "static const unsigned char isCode[65536] = {");
+    column = 0;
+    for (int address = 0; address < 65536; address++) {
+        if (reachable[address]) {
+            fprintf(output, "%s[0x%04x] = 1,", column++ % 8 == 0 ? "\n    " : " ", address);
+        }
+    }
+    fprintf(output, "\n};\n\n");
+
+    fprintf(output, "static short R[8] = {%d, %d, %d, %d, %d, %d, %d, %d};\n", state->registers[0], state->registers[1],
+            state->registers[2], state->registers[3], state->registers[4], state->registers[5], state->registers[6],
+            state->registers[7]);
+    fprintf(output, "static unsigned short cc = %d;\n\n", state->cc);
+    fputs(RUNTIME, output);
+
+    fprintf(output, "int main(void) {\n");
+    fprintf(output, "    unsigned short pc = 0x%04x;\n\n", state->pc);
+
+    // Indirect jumps land here, anything that was not translated (or was overwritten) is interpreted
+    fprintf(output, "dispatch:\n");
+    fprintf(output, "    if (!modified) {\n        switch (pc) {\n");
+    for (int address = 0; address < 65536; address++) {
+        if (reachable[address]) {
+            fprintf(output, "            case 0x%04x: goto L_%04x;\n", address, address);
+        }
+    }
+    fprintf(output, "        }\n    }\n");
+    fprintf(output, "    do {\n        if (interpret(&pc)) goto halt;\n    } while (modified || !isCode[pc]);\n");
+    fprintf(output, "    goto dispatch;\n\n");
+
+    for (int address = 0; address < 65536; address++) {
+        if (!reachable[address]) {
+            continue;
+        }
+
+        unsigned short instruction = state->memory[address].rawNumber;
+        const LC3Symbol* symbol = state->image != NULL ? imageSymbolAt(state->image, address) : NULL;
+
+        fprintf(output, "L_%04x:  // ", address);
+        if (symbol != NULL && symbol->address == address) {
+            fprintf(output, "%s: ", symbol->name);
+        }
+        printHexInstruction(output, instruction);
+        fprintf(output, "\n");
+
+        emitInstruction(output, address, instruction);
+
+        // Fall through to the next label, or leave through the dispatcher when it was not translated
+        unsigned short opcode = getRaw(instruction, 12, 4);
+        int fallsThrough = opcode != 4 && opcode != 8 && opcode != 12 && opcode != 13 &&
+                           !(opcode == 15 && getAsNumber(instruction, 0, 8) == 0x25);
+        unsigned short next = address + 1;
+        if (fallsThrough && !reachable[next]) {
+            fprintf(output, "    pc = 0x%04x; goto dispatch;\n", next);
+        } else if (fallsThrough && next == 0) {
+            // The last word wraps around to x0000
+            fprintf(output, "    goto L_0000;\n");
+        }
+    }
+
+    fprintf(output, "\nhalt:\n    fflush(stdout);\n    return 0;\n}\n");
+
+    free(reachable);
+}
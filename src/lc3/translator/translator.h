@@ -0,0 +1,18 @@
+#ifndef TRANSLATOR_H
+#define TRANSLATOR_H
+
+#include <stdio.h>
+
+#include "../emulator/lc3emulator.h"
+
+/*
+ * Static recompiler: writes a standalone C program that runs the loaded image natively.
+ *
+ * Every instruction reachable from the initial pc gets its own label, BR and JSR become direct gotos.
+ * JMP, JSRR and RET go through a switch over the translated addresses, and anything outside of it (or any
+ * code after a store has overwritten a translated instruction) runs in an embedded interpreter.
+ * Traps behave exactly as in the emulator. The program has no cycle limit and no benchmark report.
+ */
+void translateToC(LC3EmulatorState* state, FILE* output);
+
+#endif // TRANSLATOR_H
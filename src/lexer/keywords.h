@@ -0,0 +1,136 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+/*
+ * Perfect hash over every LC-3 mnemonic, pseudo-op, branch variant, register and directive.
+ *
+ * The lexer matches a word once with the generic identifier (or directive) rule and then
+ * classifies it here, instead of having one case-insensitive flex rule per keyword.
+ *
+ * hash(w) = (len + asso[w[0]] + asso[w[1]] + 2 * asso[w[2]] + asso[w[len - 1]]) % 128
+ *
+ * BR condition flags may be written in any order (brnzp, brpzn, ...), which makes this assembler
+ * a bit more lenient than the LC-3 manual. w[2] is weighted twice so that those permutations
+ * do not collide.
+ * The associated values were searched offline so that all keywords land in distinct slots,
+ * upper and lowercase letters share the same value. When adding a keyword, the values
+ * have to be searched again so that the table stays collision free.
+ *
+ * Must be included after the Bison generated parser.h, since the table stores token values.
+ */
+
+#define KEYWORD_TABLE_SIZE 128
+#define KEYWORD_MAX_LENGTH 5
+
+typedef struct Keyword {
+    const char* name;  // Lowercase spelling
+    int length;
+    int token;
+} Keyword;
+
+static const unsigned char keywordAssociatedValues[256] = {
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   9,   0,
+     40,  37,  62,  12,  58,  98, 100,  67,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,  32,  76,  82, 113,  28,  10,  17,  69,  21, 106, 121, 123, 123,  67,  27,
+     99,   0,   7, 111, 109,  43,   0,  46,   0,   0,   5,   0,   0,   0,   0,   0,
+      0,  32,  76,  82, 113,  28,  10,  17,  69,  21, 106, 121, 123, 123,  67,  27,
+     99,   0,   7, 111, 109,  43,   0,  46,   0,   0,   5,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+};
+
+static const Keyword keywordTable[KEYWORD_TABLE_SIZE] = {
+    [4] = {"ldr", 3, LDR},
+    [5] = {"r2", 2, R2},
+    [15] = {"r7", 2, R7},
+    [16] = {"out", 3, OUT},
+    [17] = {"jmp", 3, JMP},
+    [27] = {"trap", 4, TRAP},
+    [29] = {"in", 2, IN},
+    [30] = {"sti", 3, STI},
+    [31] = {"brn", 3, BR_N},
+    [32] = {".end", 4, END},
+    [33] = {"r3", 2, R3},
+    [34] = {"brpz", 4, BR_PZ},
+    [35] = {"brpnz", 5, BR_PZN},
+    [36] = {"brzn", 4, BR_ZN},
+    [37] = {"brzpn", 5, BR_PZN},
+    [40] = {"not", 3, NOT},
+    [46] = {"ldi", 3, LDI},
+    [54] = {"rti", 3, RTI},
+    [57] = {"and", 3, AND},
+    [61] = {".fill", 5, FILL},
+    [62] = {"putc", 4, PUTC},
+    [64] = {"brnp", 4, BR_PN},
+    [65] = {"brnzp", 5, BR_PZN},
+    [68] = {"brzp", 4, BR_PZ},
+    [69] = {"brznp", 5, BR_PZN},
+    [72] = {".orig", 5, ORIG},
+    [75] = {"st", 2, ST},
+    [76] = {"halt", 4, HALT},
+    [77] = {"r5", 2, R5},
+    [80] = {"putsp", 5, PUTSP},
+    [81] = {"r6", 2, R6},
+    [83] = {"r1", 2, R1},
+    [89] = {"r0", 2, R0},
+    [91] = {"puts", 4, PUTS},
+    [92] = {"br", 2, BR},
+    [93] = {"getc", 4, GETC},
+    [95] = {"ld", 2, LD},
+    [96] = {"brpn", 4, BR_PN},
+    [97] = {"brpzn", 5, BR_PZN},
+    [98] = {"brnz", 4, BR_ZN},
+    [99] = {"brnpz", 5, BR_PZN},
+    [101] = {"brz", 3, BR_Z},
+    [103] = {"add", 3, ADD},
+    [109] = {"ret", 3, RET},
+    [113] = {"jsr", 3, JSR},
+    [114] = {"jsrr", 4, JSRR},
+    [116] = {"str", 3, STR},
+    [122] = {"lea", 3, LEA},
+    [125] = {"r4", 2, R4},
+    [126] = {".blkw", 5, BLKW},
+    [127] = {"brp", 3, BR_P},
+};
+
+/**
+ * Classifies a word matched by the lexer.
+ *
+ * @param text The matched text (does not need to be null terminated).
+ * @param length The length of the matched text.
+ * @return The keyword token, or IDENTIFIER if the word is not a keyword.
+ */
+static inline int classifyKeyword(const char* text, int length) {
+    if (length < 2 || length > KEYWORD_MAX_LENGTH) {
+        return IDENTIFIER;
+    }
+
+    const unsigned char* word = (const unsigned char*)text;
+    unsigned int third = length > 2 ? keywordAssociatedValues[word[2]] : 0;
+    unsigned int hash = length + keywordAssociatedValues[word[0]] + keywordAssociatedValues[word[1]] + 2 * third + keywordAssociatedValues[word[length - 1]];
+
+    const Keyword* keyword = &keywordTable[hash % KEYWORD_TABLE_SIZE];
+    if (keyword->length != length) {
+        return IDENTIFIER;
+    }
+
+    // Keywords are lowercase letters, digits and a leading '.', which already have bit 5 set, so or-ing it
+    // in only folds uppercase letters. '_' (0x5F) lacks it too, but no keyword contains one.
+    for (int i = 0; i < length; i++) {
+        if ((word[i] | 0x20) != (unsigned char)keyword->name[i]) {
+            return IDENTIFIER;
+        }
+    }
+
+    return keyword->token;
+}
+
+#endif // KEYWORDS_H
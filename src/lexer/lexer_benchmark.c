@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../../target/grammar/parser.h"
+#include "lexer.h"
+
+/*
+ * Lexer-only benchmark.
+ *
+ * Runs yylex() over a large input without parsing it, so the scanner can be measured on its own.
+ * The input is the given .asm file (or a built-in sample program) repeated until it is at least
+ * the requested size.
+ *
+ * Usage: lexer_benchmark [file.asm] [megabytes]
+ */
+
+extern int yylex(void);
+
+static const char* SAMPLE_PROGRAM =
+    "; Sample program used when no input file is given\n"
+    "        .ORIG x3000\n"
+    "MAIN    AND R0, R0, #0      ; clear the accumulator\n"
+    "        LD R1, COUNT\n"
+    "LOOP:   ADD R0, R0, #5\n"
+    "        ADD R1, R1, #-1\n"
+    "        BRp LOOP\n"
+    "        LEA R2, BUFFER\n"
+    "        STR R0, R2, #0\n"
+    "        LDR R3, R2, #0\n"
+    "        brnzp SKIP\n"
+    "        JSR SUB\n"
+    "SKIP    LDI R4, PTR\n"
+    "        NOT R4, R4\n"
+    "        PUTS\n"
+    "        HALT\n"
+    "SUB     RET\n"
+    "COUNT   .FILL #10\n"
+    "PTR     .FILL x4000\n"
+    "BUFFER  .BLKW 4\n"
+    "MSG     .STRINGZ \"Hello, World!\"\n";
+
+static char* readWholeFile(const char* path, long* length) {
+    FILE* file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open input file: %s\n", path);
+        exit(1);
+    }
+
+    fseek(file, 0, SEEK_END);
+    *length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    char* buffer = malloc(*length + 1);
+    *length = fread(buffer, 1, *length, file);
+    buffer[*length] = '\0';
+    fclose(file);
+
+    return buffer;
+}
+
+int main(int argc, char** argv) {
+    long megabytes = 64;
+    long sourceLength = 0;
+    char* source = NULL;
+
+    if (argc > 1) {
+        source = readWholeFile(argv[1], &sourceLength);
+    } else {
+        source = strdup(SAMPLE_PROGRAM);
+        sourceLength = strlen(source);
+    }
+
+    if (argc > 2) {
+        megabytes = atol(argv[2]);
+    }
+
+    if (sourceLength == 0) {
+        fprintf(stderr, "Input file is empty.\n");
+        return 1;
+    }
+
+    // Build the input by repeating the source, the lexer does not care that labels repeat
+    FILE* input = tmpfile();
+    if (input == NULL) {
+        fprintf(stderr, "Could not create temporary file.\n");
+        return 1;
+    }
+
+    long totalBytes = 0;
+    while (totalBytes < megabytes * 1024 * 1024) {
+        fwrite(source, 1, sourceLength, input);
+        fputc('\n', input);
+        totalBytes += sourceLength + 1;
+    }
+    fflush(input);
+    free(source);
+
+    initLexer(input);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    long tokens = 0;
+    int token;
+    while ((token = yylex()) != 0) {
+        if (token == IDENTIFIER || token == STRINGZ) {
+            free(yylval.sval);
+        }
+        tokens++;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    finalizeLexer();
+    fclose(input);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double totalMegabytes = totalBytes / (1024.0 * 1024.0);
+
+    printf("Lexed %.1f MB (%ld tokens) in %.3f s\n", totalMegabytes, tokens, seconds);
+    printf("Throughput: %.1f MB/s, %.1f Mtokens/s\n", totalMegabytes / seconds, tokens / seconds / 1e6);
+
+    return 0;
+}
@@ -4,9 +4,29 @@
 
 #include "cli/default/default_cli.h"
 #include "lc3/assembler/lc3assembler.h"
+#include "lc3/cache/asmcache.h"
+#include "lc3/cache/verdictcache.h"
 #include "lc3/context/lc3context.h"
+#include "lc3/debugger/debugger.h"
+#include "lc3/debugger/gdbstub.h"
+#include "lc3/debugger/timetravel.h"
 #include "lc3/emulator/lc3emulator.h"
+#include "lc3/emulator/lc3interrupt.h"
+#include "lc3/emulator/lc3loop.h"
+#include "lc3/emulator/lc3multicore.h"
+#include "lc3/emulator/lc3snapshot.h"
 #include "lc3/expecter/expecter.h"
+#include "lc3/fuzzer/fuzzer.h"
+#include "lc3/lockstep/lockstep.h"
+#include "lc3/memo/memo.h"
+#include "lc3/profile/cachemodel.h"
+#include "lc3/profile/callprofile.h"
+#include "lc3/profile/coverage.h"
+#include "lc3/profile/hostcounters.h"
+#include "lc3/profile/pairprofile.h"
+#include "lc3/profile/timing.h"
+#include "lc3/shadow/shadow.h"
+#include "lc3/translator/translator.h"
 
 CLIParser* parser = NULL;
 CLIParseResult result = {NULL};
@@ -32,8 +52,7 @@ void handleRandomization(int* seedOutput, int* randomizedOutput) {
     }
 
     if (randomized) {
-        // Handle it here, no need to pass it to the LC3
-        srand(seed);
+        // The layout is generated from the seed by a counter-based generator, no global state to seed
         *seedOutput = seed;
         *randomizedOutput = randomized;
     } else {
@@ -94,6 +113,14 @@ void printExpectations(char* expectFile, LC3EmulatorState emulatorState) {
         }
     }
 
+    if (expectations.output.expectedPc) {
+        printf("PC: x%04x\n", emulatorState.pc);
+    }
+
+    if (expectations.output.expectedCc) {
+        printf("CC: %c\n", emulatorState.cc == 4 ? 'n' : emulatorState.cc == 2 ? 'z' : 'p');
+    }
+
     for (int i = 0; i < 65536; i++) {
         if (expectations.output.expectedMemory[i]) {
             printf("MEM x%04x: %d\n", i, emulatorState.memory[i].parsedNumber);
@@ -103,7 +130,7 @@ void printExpectations(char* expectFile, LC3EmulatorState emulatorState) {
     fclose(expect);
 }
 
-void injectExpectations(char* expectFile, LC3EmulatorState* emulatorState) {
+void injectExpectations(LC3Context context, char* expectFile, LC3EmulatorState* emulatorState) {
     if (expectFile == NULL) {
         return;
     }
@@ -120,14 +147,285 @@ void injectExpectations(char* expectFile, LC3EmulatorState* emulatorState) {
     for (int i = 0; i < 8; i++) {
         if (expectations.input.replaceRegisters[i]) {
             emulatorState->registers[i] = expectations.input.registerReplacements[i];
+            if (context.shadow != NULL) {
+                shadowDefineRegister(context.shadow, i);
+            }
         }
     }
 
     for (int i = 0; i < 65536; i++) {
         if (expectations.input.replaceMemory[i]) {
-            emulatorState->memory[i].parsedNumber = expectations.input.memoryReplacements[i];
+            emulatorWriteMemory(emulatorState, i, expectations.input.memoryReplacements[i]);
+            if (context.shadow != NULL) {
+                shadowDefineWord(context.shadow, i);
+            }
+        }
+    }
+}
+
+unsigned char* readWholeStream(FILE* stream, size_t* length) {
+    size_t capacity = 4096;
+    unsigned char* buffer = malloc(capacity);
+    *length = 0;
+
+    size_t read;
+    while ((read = fread(buffer + *length, 1, capacity - *length, stream)) > 0) {
+        *length += read;
+        if (*length == capacity) {
+            capacity *= 2;
+            buffer = realloc(buffer, capacity);
+        }
+    }
+
+    return buffer;
+}
+
+void runEmulator(LC3Context context, LC3EmulatorState* emulatorState, char* expectFile) {
+    if (context.cores > 0) {
+        runCores(context, emulatorState);
+        return;
+    }
+
+    // The verdict cache needs the whole input and output streams, debug mode output is not captured.
+    // A profiled, measured or debugged run has to execute.
+    if (context.verdictCacheDirectory == NULL || context.debugMode || context.pairProfile != NULL || context.callProfile != NULL ||
+        context.coverage != NULL || context.shadow != NULL || context.hostCounters != NULL || context.observer != NULL ||
+        context.timing != NULL || context.debugger != NULL) {
+        emulate(context, emulatorState);
+        exitOnStop(&context, emulatorState);
+        return;
+    }
+
+    short* selectedMemory = NULL;
+    EmulatorExpectations* expectations = NULL;
+    if (expectFile != NULL) {
+        FILE* expect = fopen(expectFile, "r");
+        if (expect == NULL) {
+            fprintf(stderr, "Could not open expectations file: %s\n", expectFile);
+            exit(1);
+        }
+
+        expectations = malloc(sizeof(EmulatorExpectations));
+        *expectations = loadExpectationFromFile(expect);
+        selectedMemory = expectations->output.expectedMemory;
+        fclose(expect);
+    }
+
+    unsigned char* inputBuffer = readWholeStream(stdin, &emulatorState->io.inputLength);
+    emulatorState->io.input = inputBuffer;
+    emulatorState->io.inputPosition = 0;
+
+    Hash64 key = verdictKey(context, emulatorState, selectedMemory);
+
+    Verdict verdict = {0};
+    if (verdictCacheLoad(context.verdictCacheDirectory, key, &verdict)) {
+        // Replay the run without emulating it
+        fwrite(verdict.output, 1, verdict.outputLength, stdout);
+        fflush(stdout);
+        applyVerdict(&verdict, emulatorState);
+
+        if (context.benchmarkMode) {
+            printBenchmarkReport(emulatorState);
         }
+    } else {
+        emulatorState->io.captureOutput = 1;
+        emulate(context, emulatorState);
+        exitOnStop(&context, emulatorState);
+
+        verdict = createVerdict(emulatorState, selectedMemory);
+        verdictCacheStore(context.verdictCacheDirectory, key, &verdict);
     }
+
+    destroyVerdict(&verdict);
+    free(emulatorState->io.output);
+    emulatorState->io = (LC3IO){0};
+    free(inputBuffer);
+    free(expectations);
+}
+
+unsigned char* readWholeFile(const char* path, size_t* length) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Could not open batch input file: %s\n", path);
+        exit(1);
+    }
+
+    unsigned char* buffer = readWholeStream(file, length);
+    fclose(file);
+
+    return buffer;
+}
+
+void writeCaseOutput(const char* inputPath, LC3IO* io) {
+    char outputPath[4096];
+    snprintf(outputPath, sizeof(outputPath), "%s.out", inputPath);
+
+    FILE* caseOutput = fopen(outputPath, "wb");
+    if (caseOutput == NULL) {
+        fprintf(stderr, "Could not open batch output file: %s\n", outputPath);
+        exit(1);
+    }
+
+    fwrite(io->output, 1, io->outputLength, caseOutput);
+    fclose(caseOutput);
+}
+
+void prepareCase(LC3Context context, LC3Snapshot* pristine, LC3EmulatorState* lane, char* expectFile, const char* path) {
+    restoreSnapshot(pristine, lane);
+    if (context.shadow != NULL) {
+        shadowBegin(context.shadow, lane);
+    }
+    injectExpectations(context, expectFile, lane);
+
+    lane->io.input = readWholeFile(path, &lane->io.inputLength);
+    lane->io.inputPosition = 0;
+    lane->io.captureOutput = 1;
+    lane->io.suppressStdout = 1;
+}
+
+void finishCase(LC3Context context, LC3EmulatorState* lane, char* expectFile, const char* path) {
+    printf("Case %s\n", path);
+    if (lane->loop.detected) {
+        printLoopReport(lane, stdout);
+    } else if (lane->fault != LC3_FAULT_NONE) {
+        printFault(lane, stdout);
+    } else if (lane->haltSignal == LC3_STOP_SIGNAL) {
+        printf("Exceeded maximum cycle count of %d\n", context.maxCycleCount);
+    } else if (context.benchmarkMode) {
+        printBenchmarkReport(lane);
+    }
+    if (context.shadow != NULL) {
+        shadowPrintReports(context.shadow, stdout);
+    }
+    printExpectations(expectFile, *lane);
+
+    writeCaseOutput(path, &lane->io);
+
+    free(lane->io.output);
+    free((unsigned char*)lane->io.input);
+    lane->io = (LC3IO){0};
+}
+
+/**
+ * Runs the same program once for every input file listed in the batch file (one path per line).
+ * Each case gets the listed file as its input stream, and its output is written next to it as <file>.out.
+ *
+ * Cases are run LOCKSTEP_LANES at a time by the lockstep engine, each lane owns a copy of the program
+ * memory and only the pages written by its previous case are restored. Debug mode, profiling, memoization
+ * and fast loops run cases one by one, memoized calls and profiles are shared between cases.
+ */
+void runBatch(LC3Context context, LC3EmulatorState* emulatorState, char* expectFile, char* batchFile) {
+    FILE* batch = fopen(batchFile, "r");
+    if (batch == NULL) {
+        fprintf(stderr, "Could not open batch file: %s\n", batchFile);
+        exit(1);
+    }
+
+    LC3Snapshot* pristine = createSnapshot(emulatorState);
+    int serial = context.debugMode || context.pairProfile != NULL || context.callProfile != NULL || context.coverage != NULL ||
+                 context.shadow != NULL || context.memo != NULL || context.observer != NULL || context.timing != NULL ||
+                 context.interrupts || context.protect || context.fastLoops;
+    int laneCount = serial ? 1 : LOCKSTEP_LANES;
+
+    LC3EmulatorState lanes[LOCKSTEP_LANES];
+    LC3EmulatorState* lanePointers[LOCKSTEP_LANES];
+    for (int i = 0; i < laneCount; i++) {
+        lanes[i] = *emulatorState;
+        lanes[i].memory = malloc(65536 * sizeof(MemoryCell));
+        memcpy(lanes[i].memory, pristine->memory, 65536 * sizeof(MemoryCell));
+        lanePointers[i] = &lanes[i];
+    }
+
+    LockstepStats totals = {0};
+    char paths[LOCKSTEP_LANES][4096];
+    int done = 0;
+
+    while (!done) {
+        int count = 0;
+        while (count < laneCount && fgets(paths[count], sizeof(paths[count]), batch) != NULL) {
+            paths[count][strcspn(paths[count], "\r\n")] = '\0';
+            if (paths[count][0] != '\0') {
+                prepareCase(context, pristine, &lanes[count], expectFile, paths[count]);
+                count++;
+            }
+        }
+
+        done = count < laneCount;
+        if (count == 0) {
+            break;
+        }
+
+        if (serial) {
+            // The benchmark report is printed per case below
+            LC3Context caseContext = context;
+            caseContext.benchmarkMode = 0;
+            emulate(caseContext, &lanes[0]);
+        } else {
+            if (context.hostCounters != NULL) {
+                hostCountersStart(context.hostCounters);
+            }
+
+            LockstepStats stats = runLockstep(context, lanePointers, count);
+
+            if (context.hostCounters != NULL) {
+                unsigned long long emulated = 0;
+                for (int i = 0; i < count; i++) {
+                    emulated += lanes[i].cycleCount;
+                }
+                hostCountersStop(context.hostCounters, emulated);
+            }
+            totals.groupInstructions += stats.groupInstructions;
+            totals.laneInstructions += stats.laneInstructions;
+            totals.scalarInstructions += stats.scalarInstructions;
+            totals.divergedLanes += stats.divergedLanes;
+        }
+
+        for (int i = 0; i < count; i++) {
+            finishCase(context, &lanes[i], expectFile, paths[i]);
+        }
+    }
+
+    if (context.benchmarkMode && !serial) {
+        printLockstepStats(totals, stdout);
+    }
+
+    for (int i = 0; i < laneCount; i++) {
+        free(lanes[i].memory);
+    }
+
+    destroySnapshot(pristine);
+    fclose(batch);
+}
+
+// Names subroutines by the labels of the image, so it has to be called before the image is destroyed
+void reportCallProfile(LC3Context context, const char* foldedFile) {
+    if (context.callProfile == NULL) {
+        return;
+    }
+
+    callProfileReport(context.callProfile, stdout);
+
+    FILE* folded = fopen(foldedFile, "w");
+    if (folded == NULL) {
+        fprintf(stderr, "Could not write call profile: %s\n", foldedFile);
+        return;
+    }
+
+    callProfileWriteFolded(context.callProfile, folded);
+    fclose(folded);
+}
+
+// Reports the coverage merged over every run recorded in the file
+void reportCoverage(LC3Context context, const char* coverageFile, const LC3Image* image) {
+    if (context.coverage == NULL) {
+        return;
+    }
+
+    if (!coverageMerge(context.coverage, coverageFile)) {
+        fprintf(stderr, "Could not write coverage: %s\n", coverageFile);
+    }
+
+    coverageReport(context.coverage, image, stdout);
 }
 
 int main(int argc, char** argv) {
@@ -166,43 +464,294 @@ int main(int argc, char** argv) {
 
     int debugMode = stringMapGet(result.flags, "debug") != NULL;
     int benchmarkMode = stringMapGet(result.flags, "benchmark") != NULL;
+    int detectLoops = stringMapGet(result.flags, "detect-loops") != NULL;
+    int fastLoops = stringMapGet(result.flags, "fast-loops") != NULL;
+    int interrupts = stringMapGet(result.flags, "interrupts") != NULL;
+    int protect = stringMapGet(result.flags, "protect") != NULL;
+
+    char* coresStr = (char*)stringMapGet(result.flags, "cores");
+    int cores = coresStr != NULL ? atoi(coresStr) : 0;
+    char* interleaveStr = (char*)stringMapGet(result.flags, "interleave");
+    int interleave = interleaveStr != NULL ? atoi(interleaveStr) : 0;
+
+    LC3Context context = {input, output, randomized, seed, maxCycles, debugMode, benchmarkMode, detectLoops, fastLoops, interrupts, protect, cores, interleave,
+                          NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL};
+    context.cacheDirectory = (char*)stringMapGet(result.flags, "cache");
+    context.verdictCacheDirectory = (char*)stringMapGet(result.flags, "verdict-cache");
+
+    char* pairProfileFile = (char*)stringMapGet(result.flags, "pair-profile");
+    if (pairProfileFile != NULL) {
+        context.pairProfile = createPairProfile();
+    }
+
+    if (stringMapGet(result.flags, "host-counters") != NULL) {
+        context.hostCounters = createHostCounters();
+    }
 
-    LC3Context context = {input, output, randomized, seed, maxCycles, debugMode, benchmarkMode};
-    if (onlyAssemble) {
+    char* callProfileFile = (char*)stringMapGet(result.flags, "call-profile");
+    if (callProfileFile != NULL) {
+        context.callProfile = createCallProfile();
+    }
+
+    char* coverageFile = (char*)stringMapGet(result.flags, "coverage");
+    if (coverageFile != NULL) {
+        context.coverage = createCoverage();
+    }
+
+    if (stringMapGet(result.flags, "check-uninitialized") != NULL) {
+        // Batch cases print their reports after the case, single runs as they happen
+        context.shadow = createShadowMemory(stringMapGet(result.flags, "batch") != NULL ? NULL : stderr);
+    }
+
+    char* instructionCache = (char*)stringMapGet(result.flags, "icache");
+    char* dataCache = (char*)stringMapGet(result.flags, "dcache");
+    CacheModel* cacheModel = NULL;
+    if (instructionCache != NULL || dataCache != NULL) {
+        CacheConfig instructionConfig;
+        CacheConfig dataConfig;
+        if ((instructionCache != NULL && !parseCacheConfig(instructionCache, &instructionConfig)) ||
+            (dataCache != NULL && !parseCacheConfig(dataCache, &dataConfig))) {
+            exit(1);
+        }
+
+        cacheModel = createCacheModel(instructionCache != NULL ? &instructionConfig : NULL, dataCache != NULL ? &dataConfig : NULL);
+        context.observer = &cacheModel->observer;
+    }
+
+    char* timingFile = (char*)stringMapGet(result.flags, "timing");
+    if (timingFile != NULL) {
+        context.timing = loadTimingModel(timingFile);
+        if (context.timing == NULL) {
+            exit(1);
+        }
+    }
+
+    if (stringMapGet(result.flags, "memoize") != NULL) {
+        // A replayed call is not executed, it could neither be profiled nor covered (nor checked, nor cached),
+        // and memoized runs do not record pairs
+        if (context.pairProfile != NULL || context.callProfile != NULL || context.coverage != NULL || context.shadow != NULL ||
+            context.observer != NULL || context.timing != NULL) {
+            fprintf(stderr, "The pair profile, call profile, coverage, --check-uninitialized, the cache model and --timing cannot be combined with --memoize.\n");
+            exit(1);
+        }
+
+        context.memo = createMemoTable();
+    }
+
+    char* gdbAddress = (char*)stringMapGet(result.flags, "gdb");
+
+    // The timer state is neither hashed by the loop detector nor replayed by memoized calls, a counted
+    // loop would delay ticks past its last iteration and the debugger steps outside of emulate()
+    if (interrupts && (detectLoops || fastLoops || stringMapGet(result.flags, "memoize") != NULL ||
+                       stringMapGet(result.flags, "debugger") != NULL || gdbAddress != NULL)) {
+        fprintf(stderr, "--interrupts cannot be combined with --detect-loops, --fast-loops, --memoize or the debugger.\n");
+        exit(1);
+    }
+
+    // Accesses are only checked by the stepped engine, which memoized calls and the debugger bypass
+    if (protect && (stringMapGet(result.flags, "memoize") != NULL || stringMapGet(result.flags, "debugger") != NULL || gdbAddress != NULL)) {
+        fprintf(stderr, "--protect cannot be combined with --memoize or the debugger.\n");
+        exit(1);
+    }
+    if (coresStr != NULL || interleaveStr != NULL) {
+        if (cores < 1 || cores > LC3_MAX_CORES || (interleaveStr != NULL && interleave < 1)) {
+            fprintf(stderr, "--cores needs between 1 and %d cores, --interleave a positive number of instructions and --cores.\n", LC3_MAX_CORES);
+            exit(1);
+        }
+
+        // These follow a single stream of instructions (or a single timer) through context objects the cores would share
+        if (debugMode || detectLoops || interrupts || protect || context.pairProfile != NULL || context.callProfile != NULL ||
+            context.coverage != NULL || context.shadow != NULL || context.hostCounters != NULL || context.memo != NULL || context.observer != NULL ||
+            context.timing != NULL || stringMapGet(result.flags, "debugger") != NULL || gdbAddress != NULL || stringMapGet(result.flags, "batch") != NULL ||
+            stringMapGet(result.flags, "fuzz") != NULL) {
+            fprintf(stderr, "--cores cannot be combined with --debug, --detect-loops, --interrupts, --protect, the profiles, --coverage, --check-uninitialized, --host-counters, --memoize, the cache model, --timing, the debugger, --batch or --fuzz.\n");
+            exit(1);
+        }
+    }
+
+    // The fuzzer steps every execution on its own, without the timer, the access checks or the per-run reports
+    if (stringMapGet(result.flags, "fuzz") != NULL &&
+        (debugMode || interrupts || protect || context.pairProfile != NULL || context.callProfile != NULL || context.coverage != NULL ||
+         context.shadow != NULL || context.memo != NULL || context.observer != NULL || context.timing != NULL ||
+         stringMapGet(result.flags, "debugger") != NULL || gdbAddress != NULL || stringMapGet(result.flags, "batch") != NULL)) {
+        fprintf(stderr, "--fuzz cannot be combined with --debug, --interrupts, --protect, the profiles, --coverage, --check-uninitialized, --memoize, the cache model, --timing, the debugger or --batch.\n");
+        exit(1);
+    }
+
+    if (stringMapGet(result.flags, "debugger") != NULL || gdbAddress != NULL) {
+        // The debugger stops inside the fused dispatch, which these modes replace
+        if (debugMode || context.pairProfile != NULL || context.callProfile != NULL || context.coverage != NULL ||
+            context.shadow != NULL || context.memo != NULL || context.observer != NULL || context.timing != NULL ||
+            stringMapGet(result.flags, "batch") != NULL) {
+            fprintf(stderr, "The debugger cannot be combined with --debug, --pair-profile, --call-profile, --coverage, --check-uninitialized, --memoize, the cache model, --timing or --batch.\n");
+            exit(1);
+        }
+
+        context.debugger = createDebugger(stdin, stdout);
+
+        char* timeTravelBudget = (char*)stringMapGet(result.flags, "time-travel");
+        if (timeTravelBudget != NULL) {
+            // Rewinding would leave the loop detector's memory digest behind
+            if (detectLoops || atoi(timeTravelBudget) <= 0) {
+                fprintf(stderr, "Time travel needs a budget in MiB and cannot be combined with --detect-loops.\n");
+                exit(1);
+            }
+
+            context.debugger->timeTravel = createTimeTravel((size_t)atoi(timeTravelBudget) << 20);
+        }
+
+        if (gdbAddress != NULL) {
+            context.debugger->gdb = gdbAccept(gdbAddress);
+            if (context.debugger->gdb == NULL) {
+                fprintf(stderr, "Could not accept a GDB connection on %s\n", gdbAddress);
+                exit(1);
+            }
+        }
+    }
+
+    char* fuzzDirectory = (char*)stringMapGet(result.flags, "fuzz");
+
+    int translateC = stringMapGet(result.flags, "translate-c") != NULL;
+    if (fuzzDirectory != NULL) {
+        LC3EmulatorState emulatorState = onlyEmulate ? loadFromFile(input) : assemble(context);
+        injectExpectations(context, (char*)stringMapGet(result.flags, "expect"), &emulatorState);
+
+        char* executions = (char*)stringMapGet(result.flags, "fuzz-executions");
+        if (!runFuzzer(context, &emulatorState, fuzzDirectory, executions != NULL ? strtoull(executions, NULL, 10) : 100000)) {
+            fprintf(stderr, "The program ends without reading input, there is nothing to fuzz.\n");
+        }
+
+        destroyImage(emulatorState.image);
+        free(emulatorState.memory);
+    } else if (translateC) {
+        LC3EmulatorState emulatorState = onlyEmulate ? loadFromFile(input) : assemble(context);
+
+        translateToC(&emulatorState, output);
+
+        destroyImage(emulatorState.image);
+        free(emulatorState.memory);
+    } else if (onlyAssemble) {
         LC3EmulatorState emulatorState = assemble(context);
 
         // Dump the memory to the output file.
         dumpToFile(&emulatorState, output);
+
+        destroyImage(emulatorState.image);
+        free(emulatorState.memory);
     } else if (onlyEmulate) {
         LC3EmulatorState emulatorState = loadFromFile(input);
+        if (interrupts) {
+            interruptsEnable(&emulatorState);
+        }
 
         // If there's an expect file, load it and inject state
         char* expectFile = (char*)stringMapGet(result.flags, "expect");
-        injectExpectations(expectFile, &emulatorState);
+        if (context.shadow != NULL) {
+            shadowBegin(context.shadow, &emulatorState);
+        }
+        injectExpectations(context, expectFile, &emulatorState);
 
-        emulate(context, &emulatorState);
+        runEmulator(context, &emulatorState, expectFile);
 
         // Print the expectations
         printExpectations(expectFile, emulatorState);
+        free(emulatorState.io.inputLog);
+
+        reportCallProfile(context, callProfileFile);
+        reportCoverage(context, coverageFile, NULL);
     } else {
         LC3EmulatorState emulatorState = assemble(context);
+        if (interrupts) {
+            interruptsEnable(&emulatorState);
+        }
 
         // If there's an expect file, load it and inject state
         char* expectFile = (char*)stringMapGet(result.flags, "expect");
 
-        injectExpectations(expectFile, &emulatorState);
+        if (context.shadow != NULL) {
+            shadowBegin(context.shadow, &emulatorState);
+        }
+        injectExpectations(context, expectFile, &emulatorState);
+
+        // Run the emulator, once per case in batch mode
+        char* batchFile = (char*)stringMapGet(result.flags, "batch");
+        if (batchFile != NULL) {
+            runBatch(context, &emulatorState, expectFile, batchFile);
+        } else {
+            runEmulator(context, &emulatorState, expectFile);
+
+            // Print the expectations
+            printExpectations(expectFile, emulatorState);
+            free(emulatorState.io.inputLog);
+        }
 
-        // Run the emulator
-        emulate(context, &emulatorState);
-
-        // Print the expectations
-        printExpectations(expectFile, emulatorState);
+        reportCallProfile(context, callProfileFile);
+        reportCoverage(context, coverageFile, emulatorState.image);
 
         // Free the memory
+        destroyImage(emulatorState.image);
         free(emulatorState.memory);
         emulatorState.memory = NULL;
     }
 
+    if (benchmarkMode && context.cacheDirectory != NULL) {
+        printAssemblyCacheStats(stdout);
+    }
+
+    if (context.pairProfile != NULL) {
+        if (!pairProfileMerge(context.pairProfile, pairProfileFile)) {
+            fprintf(stderr, "Could not write pair profile: %s\n", pairProfileFile);
+        }
+        destroyPairProfile(context.pairProfile);
+    }
+
+    if (context.callProfile != NULL) {
+        destroyCallProfile(context.callProfile);
+    }
+
+    if (context.coverage != NULL) {
+        destroyCoverage(context.coverage);
+    }
+
+    if (context.shadow != NULL) {
+        destroyShadowMemory(context.shadow);
+    }
+
+    if (context.timing != NULL) {
+        // The caches stall on top of the modeled latencies
+        unsigned long long stallCycles = 0;
+        if (cacheModel != NULL && cacheModel->instruction != NULL) {
+            stallCycles += cacheStallCycles(cacheModel->instruction);
+        }
+        if (cacheModel != NULL && cacheModel->data != NULL) {
+            stallCycles += cacheStallCycles(cacheModel->data);
+        }
+
+        printTimingModel(context.timing, stallCycles, stdout);
+        destroyTimingModel(context.timing);
+    }
+
+    if (cacheModel != NULL) {
+        printCacheModel(cacheModel, stdout);
+        destroyCacheModel(cacheModel);
+    }
+
+    if (context.hostCounters != NULL) {
+        printHostCounters(context.hostCounters, stdout);
+        destroyHostCounters(context.hostCounters);
+    }
+
+    if (context.memo != NULL) {
+        if (benchmarkMode) {
+            printMemoStats(context.memo, stdout);
+        }
+        destroyMemoTable(context.memo);
+    }
+
+    if (context.debugger != NULL) {
+        destroyDebugger(context.debugger);
+    }
+
     // Close the files
     if (input != stdin) {
         fclose(input);
@@ -0,0 +1,23 @@
+; Clears, counted ADD; BR loops and read-modify-write of variables
+        .ORIG x3000
+        LEA R5, DATA
+        AND R3, R3, #0
+        ADD R3, R3, #5
+        AND R4, R4, #0
+        ADD R4, R4, #-3
+        ADD R2, R1, #0
+        BRnz DONE
+LOOP    LDR R0, R5, #0
+        ADD R0, R0, R3
+        STR R0, R5, #0
+        LDR R0, R5, #1
+        ADD R0, R0, R4
+        STR R0, R5, #1
+        ADD R2, R2, #-1
+        BRp LOOP
+DONE    AND R0, R0, #0
+        ADD R0, R0, #-7
+        HALT
+DATA    .FILL #100
+        .FILL #-100
+        .END
@@ -0,0 +1,32 @@
+; Recursive sum of 1..R1 with pushes (ADD R6, R6, #-1; STR R7, R6, #0) and another ADD; STR
+        .ORIG x3000
+        LD R6, STACK
+        LEA R5, DATA
+        ADD R0, R1, #0
+        BRn DONE
+        JSR SUM
+        ADD R2, R2, #1
+        STR R2, R5, #0
+DONE    HALT
+; R3 = R0 + (R0-1) + ... + 1, R2 counts the calls
+SUM     ADD R6, R6, #-1
+        STR R7, R6, #0
+        ADD R6, R6, #-1
+        STR R0, R6, #0
+        ADD R2, R2, #1
+        STR R2, R5, #1
+        AND R3, R3, #0
+        ADD R0, R0, #0
+        BRz SDONE
+        ADD R0, R0, #-1
+        JSR SUM
+        LDR R0, R6, #0
+        ADD R3, R3, R0
+SDONE   LDR R0, R6, #0
+        ADD R6, R6, #1
+        LDR R7, R6, #0
+        ADD R6, R6, #1
+        RET
+STACK   .FILL xF000
+DATA    .BLKW #2
+        .END
@@ -0,0 +1,25 @@
+; Stores over instructions that already ran as part of fused groups, with other opcodes
+        .ORIG x3000
+        LEA R5, BODY
+        AND R3, R3, #0
+        ADD R2, R1, #0
+        BRnz DONE
+LOOP    JSR BODY
+        ADD R2, R2, #-1
+        BRz DONE
+        LD R0, ALT
+        STR R0, R5, #1
+        LD R0, ALT2
+        ST R0, PATCH
+        ADD R2, R2, #-1
+        BRp LOOP
+DONE    HALT
+BODY    AND R4, R4, #0
+        ADD R4, R4, #1
+PATCH   ADD R3, R3, R4
+        STR R3, R5, #8
+        RET
+ALT     NOT R4, R4
+ALT2    NOT R3, R3
+        .BLKW #2
+        .END
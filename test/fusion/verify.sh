@@ -0,0 +1,37 @@
+#!/bin/bash
+
+# Runs every program in this directory for a range of inputs with superinstructions (the default) and
+# stepped one at a time (--pair-profile turns fusion off), the registers, cc, memory and cycle counts
+# must be identical. With a cycle limit the programs run as a batch of one empty input, which reports the
+# state the run stopped in (--interrupts runs the case serially, the programs leave the timer off).
+
+source ../harness.sh
+
+VALUES="0 1 2 3 7 100 1000 -1"
+LIMITS="5 6 7 8 9 10 11 12 13 20 21 22 50 51 52"
+
+for f in *.asm
+do
+  startProgram "${f%.asm}"
+
+  for r1 in $VALUES
+  do
+    echo "put R1 $r1" > "$dir/expect"
+    expectState "$dir/expect" 12288 12352
+
+    fused=$( $LC3 -b -i "$f" -x "$dir/expect" 2>&1 )
+    stepped=$( $LC3 -b --pair-profile="$dir/profile" -i "$f" -x "$dir/expect" 2>&1 )
+    compare "R1=$r1" "$fused" "$stepped"
+
+    for limit in $LIMITS
+    do
+      fused=$( $LC3 --interrupts -m $limit -i "$f" -x "$dir/expect" --batch="$dir/empty.batch" 2>&1 )
+      stepped=$( $LC3 --interrupts -m $limit --pair-profile="$dir/profile" -i "$f" -x "$dir/expect" --batch="$dir/empty.batch" 2>&1 )
+      compare "R1=$r1 -m $limit" "$fused" "$stepped"
+    done
+  done
+
+  endProgram
+done
+
+exit $err
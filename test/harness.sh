@@ -0,0 +1,58 @@
+#!/bin/bash
+
+# Shared by the differential tests in the subdirectories, sourced from their own directory. Each of them
+# runs its programs two or more ways and the outputs of every way must be identical.
+#
+#   startProgram <name> [suffix]         prints the program, its runs follow
+#   compare <what> <output> <output>     marks the program failed and shows the diff when they differ
+#   endProgram                           prints whether the program passed
+#   expectState <file> [first last]      appends the pc, cc, registers and the words first-last to the expectations
+#
+# $dir is a scratch directory removed on exit. $dir/empty.batch lists one empty input, a run with a cycle
+# limit only reports the state it stopped in as a batch case. The script ends with exit $err.
+
+RED="\e[31m"
+GREEN="\e[32m"
+YELLOW="\e[33m"
+END="\e[0m"
+
+LC3=${LC3:-../../target/lc3}
+
+err=0
+failed=0
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+: > "$dir/empty"
+echo "$dir/empty" > "$dir/empty.batch"
+
+startProgram() {
+  printf "Program $YELLOW$1$END$2: "
+  failed=0
+}
+
+compare() {
+  if [[ "$2" != "$3" ]]; then
+    failed=1
+    echo
+    echo "$1"
+    diff <(echo "$2") <(echo "$3")
+  fi
+}
+
+endProgram() {
+  if [[ $failed == 1 ]]; then
+    err=1
+    printf "${RED}Failed$END\n"
+  else
+    printf "${GREEN}Passed$END\n"
+  fi
+}
+
+expectState() {
+  printf "expect pc\nexpect cc\n" >> "$1"
+  for r in 0 1 2 3 4 5 6 7; do echo "expect R$r" >> "$1"; done
+  if [[ -n $2 ]]; then
+    for a in $(seq $2 $3); do printf "expect x%04x\n" $a >> "$1"; done
+  fi
+}
@@ -0,0 +1,31 @@
+; Every core adds 1 to a shared counter 20 times with a plain load and store, so increments are lost when
+; the cores interleave between them, and prints its number each time. CAS adds to a second counter that
+; never loses one.
+        .ORIG x3000
+        TRAP x30
+        LD R3, DIGIT
+        ADD R4, R0, R3
+        AND R5, R5, #0
+        ADD R5, R5, #10
+        ADD R5, R5, #10
+LOOP    LD R1, COUNT
+        ADD R1, R1, #1
+        ST R1, COUNT
+        ADD R0, R4, #0
+        OUT
+RETRY   LEA R0, SAFE
+        LDR R1, R0, #0
+        ADD R2, R1, #1
+        TRAP x31
+        NOT R1, R1
+        ADD R1, R1, #1
+        ADD R1, R1, R2
+        ADD R1, R1, #-1
+        BRnp RETRY
+        ADD R5, R5, #-1
+        BRp LOOP
+        HALT
+DIGIT   .FILL x30
+COUNT   .FILL #0
+SAFE    .FILL #0
+        .END
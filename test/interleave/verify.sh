@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# Runs every program in this directory twice for each number of cores and --interleave, the outputs,
+# shared counters and exit status must be the same both times. The counters at x3018-x3019 of race.asm
+# may lose increments to the interleaving, the CAS one never does.
+
+source ../harness.sh
+
+printf "expect x3018\nexpect x3019\n" > "$dir/expect"
+
+for f in *.asm
+do
+  startProgram "${f%.asm}"
+
+  for cores in 2 3 4
+  do
+    for interleave in 1 2 3 5 8
+    do
+      first=$( $LC3 --cores=$cores --interleave=$interleave -i "$f" -x "$dir/expect" 2>&1; echo "Exit status $?" )
+      second=$( $LC3 --cores=$cores --interleave=$interleave -i "$f" -x "$dir/expect" 2>&1; echo "Exit status $?" )
+      compare "--cores=$cores --interleave=$interleave" "$first" "$second"
+      compare "CAS with --cores=$cores --interleave=$interleave" "MEM x3019: $((cores * 20))" "$(grep "x3019" <<< "$first")"
+    done
+  done
+
+  endProgram
+done
+
+exit $err
@@ -0,0 +1,50 @@
+; Drops to user mode, which loads from system space (access violation), runs the reserved opcode and
+; then RTI. The first two handlers print a letter and return past the instruction, the last one halts
+        .ORIG x3000
+        LD R6, STACK
+        LEA R0, ACV
+        STI R0, ACVV
+        LEA R0, ILLEGAL
+        STI R0, ILLEGALV
+        LEA R0, PRIV
+        STI R0, PRIVV
+        LD R0, USERPSR
+        ADD R6, R6, #-1
+        STR R0, R6, #0
+        LEA R0, USER
+        ADD R6, R6, #-1
+        STR R0, R6, #0
+        RTI
+; User mode
+USER    AND R1, R1, #0
+        LD R2, SYSTEM
+        LDR R3, R2, #0
+        ADD R1, R1, #1
+        .FILL xD000
+        ADD R1, R1, #1
+        RTI
+; Access control violation
+ACV     LD R0, ACHAR
+        OUT
+        RTI
+; Illegal opcode
+ILLEGAL LD R0, ICHAR
+        OUT
+        RTI
+; Privilege mode exception
+PRIV    LD R0, PCHAR
+        OUT
+        AND R0, R0, #0
+        ADD R0, R0, #10
+        OUT
+        HALT
+STACK   .FILL x3000
+ACVV    .FILL x0102
+ILLEGALV .FILL x0101
+PRIVV   .FILL x0100
+USERPSR .FILL x8002
+SYSTEM  .FILL x0200
+ACHAR   .FILL x41
+ICHAR   .FILL x49
+PCHAR   .FILL x50
+        .END
@@ -0,0 +1,57 @@
+; Installs the timer and privilege handlers, starts the timer and drops to user mode with RTI. The user
+; code counts in R1 until the timer handler has run three times, then runs RTI itself, which is privileged
+        .ORIG x3000
+        LD R6, STACK
+        LEA R0, TIMER
+        STI R0, TIMERV
+        LEA R0, PRIV
+        STI R0, PRIVV
+        LD R0, INTERVAL
+        STI R0, TIR
+        LD R0, ENABLE
+        STI R0, TSR
+        LD R0, USERPSR
+        ADD R6, R6, #-1
+        STR R0, R6, #0
+        LEA R0, USER
+        ADD R6, R6, #-1
+        STR R0, R6, #0
+        RTI
+; User mode
+USER    AND R1, R1, #0
+ULOOP   ADD R1, R1, #1
+        LD R2, TICKS
+        ADD R2, R2, #-3
+        BRn ULOOP
+        RTI
+; Timer interrupt, prints a T and clears the ready bit
+TIMER   ST R0, SAVED
+        LD R0, TICKS
+        ADD R0, R0, #1
+        ST R0, TICKS
+        LD R0, TCHAR
+        OUT
+        LD R0, ENABLE
+        STI R0, TSR
+        LD R0, SAVED
+        RTI
+; Privilege mode exception, the saved pc and PSR stay on the supervisor stack
+PRIV    LEA R0, PMSG
+        PUTS
+        AND R0, R0, #0
+        ADD R0, R0, #10
+        OUT
+        HALT
+STACK   .FILL x3000
+TIMERV  .FILL x0181
+PRIVV   .FILL x0100
+TIR     .FILL xFE0A
+TSR     .FILL xFE08
+INTERVAL .FILL #50
+ENABLE  .FILL x4000
+USERPSR .FILL x8002
+TICKS   .FILL #0
+SAVED   .FILL #0
+TCHAR   .FILL x54
+PMSG    .STRINGZ " privilege mode exception"
+        .END
@@ -0,0 +1,21 @@
+#!/bin/bash
+
+# Runs every program in this directory with --interrupts and --protect, the output, registers, the pc and
+# PSR the last exception saved on the supervisor stack and the exit status must match <program>.expected
+
+source ../harness.sh
+
+expectState "$dir/expect"
+printf "expect x2ffe\nexpect x2fff\n" >> "$dir/expect"
+
+for f in *.asm
+do
+  startProgram "${f%.asm}"
+
+  output=$( $LC3 --interrupts --protect -i "$f" -x "$dir/expect" 2>&1; echo "Exit status $?" )
+  compare "Expected" "$(cat "${f%.asm}.expected")" "$output"
+
+  endProgram
+done
+
+exit $err
@@ -0,0 +1,35 @@
+; Reads characters up to a '.', echoing them and adding each one to a running total, one per loop
+; iteration, and to a slot per character class. 'q' gets stuck, 'h' halts early.
+        .ORIG x3000
+        LEA R5, SLOTS
+        AND R3, R3, #0
+NEXT    GETC
+        LD R1, DOT
+        ADD R1, R0, R1
+        BRz DONE
+        LD R1, QUIT
+        ADD R1, R0, R1
+        BRz STUCK
+        LD R1, STOP
+        ADD R1, R0, R1
+        BRz DONE
+        OUT
+        ADD R2, R0, #0
+SUM     ADD R3, R3, #1
+        ADD R2, R2, #-1
+        BRp SUM
+        AND R1, R0, #7
+        ADD R1, R1, R5
+        LDR R2, R1, #0
+        ADD R2, R2, R0
+        STR R2, R1, #0
+        BRnzp NEXT
+STUCK   BRnzp STUCK
+DONE    ST R3, TOTAL
+        HALT
+DOT     .FILL #-46
+QUIT    .FILL #-113
+STOP    .FILL #-104
+TOTAL   .FILL #0
+SLOTS   .BLKW #8
+        .END
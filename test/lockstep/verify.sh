@@ -0,0 +1,51 @@
+#!/bin/bash
+
+# Runs a batch of generated inputs through the lockstep engine and one case at a time, stepped (with
+# --pair-profile) and with superinstructions (--interrupts also runs cases serially, the programs leave the
+# timer off). The reports, registers, memory and outputs of every case must be identical.
+
+source ../harness.sh
+
+CASES=40
+CHARACTERS="abcxyz01hq."
+
+# The same inputs on every run, some of them empty, stuck or cut off before the '.'. "." halts on the
+# 8th instruction, right at the smallest limit.
+printf "." > "$dir/0.in"
+echo "$dir/0.in" > "$dir/batch"
+
+RANDOM=1
+for i in $(seq $CASES)
+do
+  input=""
+  for j in $(seq $((RANDOM % 12)))
+  do
+    input+=${CHARACTERS:$((RANDOM % ${#CHARACTERS})):1}
+  done
+  printf "%s" "$input" > "$dir/$i.in"
+  echo "$dir/$i.in" >> "$dir/batch"
+done
+
+expectState "$dir/expect" 12288 12330
+
+for f in *.asm
+do
+  for flags in "-m 100000" "-m 200" "-m 201" "-m 202" "-m 37" "-m 8" "-L -m 100000"
+  do
+    startProgram "${f%.asm}" " ($flags)"
+
+    lockstep=$( $LC3 -b $flags -i "$f" -x "$dir/expect" --batch="$dir/batch" 2>&1 | grep -v "^Lockstep:"; cat "$dir"/*.out )
+    stepped=$( $LC3 -b $flags --pair-profile="$dir/profile" -i "$f" -x "$dir/expect" --batch="$dir/batch" 2>&1; cat "$dir"/*.out )
+    compare "Stepped" "$lockstep" "$stepped"
+
+    # --interrupts does not detect loops
+    if [[ $flags != *-L* ]]; then
+      fused=$( $LC3 -b $flags --interrupts -i "$f" -x "$dir/expect" --batch="$dir/batch" 2>&1; cat "$dir"/*.out )
+      compare "Superinstructions" "$lockstep" "$fused"
+    fi
+
+    endProgram
+  done
+done
+
+exit $err
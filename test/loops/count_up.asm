@@ -0,0 +1,9 @@
+; Counts up to 0 with BRn
+        .ORIG x3000
+        AND R3, R3, #0
+        AND R4, R4, #0
+LOOP    ADD R3, R3, R1
+        ADD R2, R2, #1
+        BRn LOOP
+        HALT
+        .END
@@ -0,0 +1,9 @@
+; Counts up by 3 with BRnz
+        .ORIG x3000
+        AND R3, R3, #0
+        AND R4, R4, #0
+LOOP    ADD R4, R4, #-5
+        ADD R2, R2, #3
+        BRnz LOOP
+        HALT
+        .END
@@ -0,0 +1,9 @@
+; The back-edge tests the accumulator, not a counted loop
+        .ORIG x3000
+        AND R3, R3, #0
+        AND R4, R4, #0
+LOOP    ADD R2, R2, #-1
+        ADD R3, R3, R1
+        BRp LOOP
+        HALT
+        .END
@@ -0,0 +1,8 @@
+; A delay loop without accumulators
+        .ORIG x3000
+        AND R3, R3, #0
+        AND R4, R4, #0
+LOOP    ADD R2, R2, #-1
+        BRp LOOP
+        HALT
+        .END
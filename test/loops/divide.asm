@@ -0,0 +1,12 @@
+; R4 = R2 / R1 by repeated subtraction, the counter is not stepped by an immediate
+        .ORIG x3000
+        AND R3, R3, #0
+        AND R4, R4, #0
+        NOT R1, R1
+        ADD R1, R1, #1
+        ADD R4, R4, #-1
+LOOP    ADD R4, R4, #1
+        ADD R2, R2, R1
+        BRzp LOOP
+        HALT
+        .END
@@ -0,0 +1,12 @@
+; The body loads from memory, not a counted loop
+        .ORIG x3000
+        AND R3, R3, #0
+        AND R4, R4, #0
+        LEA R5, DATA
+LOOP    LDR R0, R5, #0
+        ADD R3, R3, R0
+        ADD R2, R2, #-1
+        BRp LOOP
+        HALT
+DATA    .FILL #7
+        .END
@@ -0,0 +1,9 @@
+; R3 = R1 * R2 by repeated addition
+        .ORIG x3000
+        AND R3, R3, #0
+        AND R4, R4, #0
+LOOP    ADD R3, R3, R1
+        ADD R2, R2, #-1
+        BRp LOOP
+        HALT
+        .END
@@ -0,0 +1,9 @@
+; Counts down to -1 with BRzp
+        .ORIG x3000
+        AND R3, R3, #0
+        AND R4, R4, #0
+LOOP    ADD R3, R3, R1
+        ADD R2, R2, #-1
+        BRzp LOOP
+        HALT
+        .END
@@ -0,0 +1,10 @@
+; Two accumulators and a counter stepped by 2
+        .ORIG x3000
+        AND R3, R3, #0
+        AND R4, R4, #0
+LOOP    ADD R3, R3, R1
+        ADD R4, R4, #3
+        ADD R2, R2, #-2
+        BRp LOOP
+        HALT
+        .END
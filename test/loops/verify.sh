@@ -0,0 +1,39 @@
+#!/bin/bash
+
+# Runs every loop shape in this directory for a range of inputs with and without --fast-loops,
+# the registers and cycle counts must be identical. With a cycle limit the loops run as a batch of one
+# empty input, which reports the pc and registers the run stopped with.
+
+source ../harness.sh
+
+VALUES="0 1 2 3 7 100 4097 32767 -1 -2 -3 -100 -32767 -32768"
+LIMITS="4 7 51 1000"
+
+for f in *.asm
+do
+  startProgram "${f%.asm}"
+
+  for r1 in 3 -5 1000
+  do
+    for r2 in $VALUES
+    do
+      printf "put R1 $r1\nput R2 $r2\n" > "$dir/expect"
+      expectState "$dir/expect"
+
+      plain=$( $LC3 -b -i "$f" -x "$dir/expect" 2>&1 )
+      fast=$( $LC3 -b --fast-loops -i "$f" -x "$dir/expect" 2>&1 )
+      compare "R1=$r1 R2=$r2" "$plain" "$fast"
+
+      for limit in $LIMITS
+      do
+        plain=$( $LC3 -m $limit -i "$f" -x "$dir/expect" --batch="$dir/empty.batch" 2>&1 )
+        fast=$( $LC3 -m $limit --fast-loops -i "$f" -x "$dir/expect" --batch="$dir/empty.batch" 2>&1 )
+        compare "R1=$r1 R2=$r2 -m $limit" "$plain" "$fast"
+      done
+    done
+  done
+
+  endProgram
+done
+
+exit $err
@@ -0,0 +1,39 @@
+; Recursive fib(R1), called twice so the second call replays
+        .ORIG x3000
+        LD R6, STACK
+        ADD R0, R1, #0
+        BRn DONE
+        JSR FIB
+        ST R1, FIRST
+        ADD R0, R0, #0
+        JSR FIB
+        ST R1, SECOND
+DONE    HALT
+; R1 = fib(R0)
+FIB     ADD R6, R6, #-1
+        STR R7, R6, #0
+        ADD R6, R6, #-1
+        STR R0, R6, #0
+        ADD R1, R0, #-2
+        BRn BASE
+        ADD R0, R0, #-1
+        JSR FIB
+        ADD R6, R6, #-1
+        STR R1, R6, #0
+        LDR R0, R6, #1
+        ADD R0, R0, #-2
+        JSR FIB
+        LDR R0, R6, #0
+        ADD R1, R1, R0
+        ADD R6, R6, #1
+        BRnzp FDONE
+BASE    ADD R1, R0, #0
+FDONE   LDR R0, R6, #0
+        ADD R6, R6, #1
+        LDR R7, R6, #0
+        ADD R6, R6, #1
+        RET
+STACK   .FILL xF000
+FIRST   .FILL #0
+SECOND  .FILL #0
+        .END
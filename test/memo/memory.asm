@@ -0,0 +1,35 @@
+; Calls that read memory the caller changes between them, and code the caller patches
+        .ORIG x3000
+        AND R3, R3, #0
+        ADD R2, R1, #0
+        BRnz PATCH
+LOOP    JSR SCALE
+        ADD R3, R3, R0
+        JSR SCALE
+        ADD R3, R3, R0
+        AND R5, R2, #1
+        BRp NEXT
+        LD R0, FACTOR
+        ADD R0, R0, #1
+        ST R0, FACTOR
+NEXT    ADD R2, R2, #-1
+        BRp LOOP
+PATCH   LD R0, ALT
+        ST R0, STEP
+        JSR SCALE
+        ADD R3, R3, R0
+        JSR SCALE
+        ADD R3, R3, R0
+        ST R3, TOTAL
+        HALT
+; R0 = FACTOR * 3, with STEP as the last ADD
+SCALE   LD R4, FACTOR
+        AND R0, R0, #0
+        ADD R0, R0, R4
+        ADD R0, R0, R4
+STEP    ADD R0, R0, R4
+        RET
+FACTOR  .FILL #2
+ALT     ADD R0, R0, #-1
+TOTAL   .FILL #0
+        .END
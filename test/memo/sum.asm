@@ -0,0 +1,43 @@
+; Recursive sum of 1..R1 on top of a variable the caller changes, nested deeper than the memoized calls
+; are tracked for large inputs
+        .ORIG x3000
+        LD R6, STACK
+        ADD R0, R1, #0
+        BRn DONE
+        JSR SUM
+        ST R1, FIRST
+        LD R0, BASE
+        ADD R0, R0, #1
+        ST R0, BASE
+        ADD R0, R2, #0
+        JSR SUM
+        ST R1, SECOND
+        ADD R0, R2, #0
+        JSR SUM
+        ST R1, THIRD
+DONE    HALT
+; R1 = BASE + R0 + (R0-1) + ... + 1, R2 = R0
+SUM     ADD R6, R6, #-1
+        STR R7, R6, #0
+        ADD R6, R6, #-1
+        STR R0, R6, #0
+        ADD R0, R0, #0
+        BRz SBASE
+        ADD R0, R0, #-1
+        JSR SUM
+        LDR R0, R6, #0
+        ADD R1, R1, R0
+        BRnzp SDONE
+SBASE   LD R1, BASE
+SDONE   LDR R0, R6, #0
+        ADD R2, R0, #0
+        ADD R6, R6, #1
+        LDR R7, R6, #0
+        ADD R6, R6, #1
+        RET
+STACK   .FILL xF000
+BASE    .FILL #0
+FIRST   .FILL #0
+SECOND  .FILL #0
+THIRD   .FILL #0
+        .END
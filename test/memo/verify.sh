@@ -0,0 +1,41 @@
+#!/bin/bash
+
+# Runs every program in this directory for a range of inputs with and without --memoize, the registers,
+# memory and cycle counts must be identical. With a cycle limit the programs run as a batch of one empty
+# input, which reports the state the run stopped in.
+
+source ../harness.sh
+
+VALUES="0 1 2 3 10 20 4095 4096 4097 5000 -1"
+LIMITS="20 100 333 1000 5000"
+
+for f in *.asm
+do
+  startProgram "${f%.asm}"
+
+  for r1 in $VALUES
+  do
+    # fib grows too fast for the deep inputs
+    if [[ $f == fib.asm && $r1 -gt 20 ]]; then
+      continue
+    fi
+
+    echo "put R1 $r1" > "$dir/expect"
+    expectState "$dir/expect" 12288 12352
+
+    plain=$( $LC3 -b -i "$f" -x "$dir/expect" 2>&1 )
+    memoized=$( $LC3 -b --memoize -i "$f" -x "$dir/expect" 2>&1 | grep -v "^Memoization:" )
+    compare "R1=$r1" "$plain" "$memoized"
+
+    for limit in $LIMITS
+    do
+      plain=$( $LC3 -m $limit -i "$f" -x "$dir/expect" --batch="$dir/empty.batch" 2>&1 )
+      memoized=$( $LC3 -m $limit --memoize -i "$f" -x "$dir/expect" --batch="$dir/empty.batch" 2>&1 | grep -v "^Memoization:" )
+      compare "R1=$r1 -m $limit" "$plain" "$memoized"
+    done
+  done
+
+  endProgram
+done
+
+exit $err
@@ -0,0 +1,26 @@
+; Echoes the input up to a '.' with lowercase letters in uppercase, then prints the strings
+        .ORIG x3000
+NEXT    GETC
+        LD R1, DOT
+        ADD R1, R0, R1
+        BRz DONE
+        LD R1, LOWER
+        ADD R1, R0, R1
+        BRn PRINT
+        ADD R0, R0, #-16
+        ADD R0, R0, #-16
+PRINT   OUT
+        BRnzp NEXT
+DONE    LEA R0, PLAIN
+        PUTS
+        LEA R0, PACKED
+        PUTSP
+        HALT
+DOT     .FILL #-46
+LOWER   .FILL #-97
+PLAIN   .STRINGZ " plain "
+PACKED  .FILL x6170
+        .FILL x6b63
+        .FILL x6465
+        .FILL x000a
+        .END
@@ -0,0 +1,73 @@
+; Prints fib(2n) in decimal for every digit n read, up to any other character, with recursive calls that return through RET
+        .ORIG x3000
+        LD R6, STACK
+NEXT    GETC
+        LD R1, ZERO
+        ADD R0, R0, R1
+        BRn DONE
+        ADD R1, R0, #-10
+        BRzp DONE
+        ADD R0, R0, R0
+        JSR FIB
+        ADD R0, R1, #0
+        JSR PRINT
+        BRnzp NEXT
+DONE    HALT
+; R1 = fib(R0)
+FIB     ADD R6, R6, #-1
+        STR R7, R6, #0
+        ADD R6, R6, #-1
+        STR R0, R6, #0
+        ADD R1, R0, #-2
+        BRn BASE
+        ADD R0, R0, #-1
+        JSR FIB
+        ADD R6, R6, #-1
+        STR R1, R6, #0
+        LDR R0, R6, #1
+        ADD R0, R0, #-2
+        JSR FIB
+        LDR R0, R6, #0
+        ADD R1, R1, R0
+        ADD R6, R6, #1
+        BRnzp FDONE
+BASE    ADD R1, R0, #0
+FDONE   LDR R0, R6, #0
+        ADD R6, R6, #1
+        LDR R7, R6, #0
+        ADD R6, R6, #1
+        RET
+; Prints R0 (0 to 9999) in decimal and a space
+PRINT   ADD R6, R6, #-1
+        STR R7, R6, #0
+        LEA R3, POWERS
+PDIGIT  LDR R4, R3, #0
+        BRz PEND
+        LD R2, ZERO
+        NOT R2, R2
+PSUB    ADD R2, R2, #1
+        ADD R0, R0, R4
+        BRzp PSUB
+        NOT R4, R4
+        ADD R4, R4, #1
+        ADD R0, R0, R4
+        ADD R5, R0, #0
+        ADD R0, R2, #0
+        OUT
+        ADD R0, R5, #0
+        ADD R3, R3, #1
+        BRnzp PDIGIT
+PEND    LD R0, SPACE
+        OUT
+        LDR R7, R6, #0
+        ADD R6, R6, #1
+        RET
+STACK   .FILL xF000
+ZERO    .FILL #-48
+SPACE   .FILL #32
+POWERS  .FILL #-1000
+        .FILL #-100
+        .FILL #-10
+        .FILL #-1
+        .FILL #0
+        .END
@@ -0,0 +1,15 @@
+; Patches a translated instruction after every character read, so the rest runs in the interpreter
+        .ORIG x3000
+NEXT    GETC
+        LD R1, DOT
+        ADD R1, R0, R1
+        BRz DONE
+PATCH   ADD R0, R0, #0
+        OUT
+        LD R2, PATCH
+        ADD R2, R2, #1
+        ST R2, PATCH
+        BRnzp NEXT
+DONE    HALT
+DOT     .FILL #-46
+        .END
@@ -0,0 +1,32 @@
+#!/bin/bash
+
+# Translates every program in this directory with --translate-c, compiles it and runs it for a range of
+# inputs next to the emulator, the output, error messages and exit status must be identical
+
+source ../harness.sh
+
+CC=${CC:-cc}
+INPUTS=("abc." "Hello, World." "0123456789." "42x" "" "abc")
+
+for f in *.asm
+do
+  startProgram "${f%.asm}"
+
+  binary="$dir/${f%.asm}"
+  if ! $LC3 -i "$f" --translate-c -o "$binary.c" || ! $CC -O1 -o "$binary" "$binary.c"; then
+    err=1
+    printf "${RED}Failed to translate$END\n"
+    continue
+  fi
+
+  for input in "${INPUTS[@]}"
+  do
+    emulated=$( printf "%s" "$input" | $LC3 -i "$f" 2>&1; echo "Exit status $?" )
+    translated=$( printf "%s" "$input" | "$binary" 2>&1; echo "Exit status $?" )
+    compare "Input \"$input\"" "$emulated" "$translated"
+  done
+
+  endProgram
+done
+
+exit $err